@@ -0,0 +1,8 @@
+# Writes a SPIR-V binary as a C array, the same layout glslangValidator --vn produces.
+# cmake -DSPIRV=<file.spv> -DHEADER=<file.h> -DVARIABLE=<name> -P spirv_to_header.cmake
+file(READ ${SPIRV} SPIRV_HEX HEX)
+# SPIR-V words are little-endian
+string(REGEX REPLACE "([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])([0-9a-f][0-9a-f])"
+    "0x\\4\\3\\2\\1," SPIRV_WORDS ${SPIRV_HEX})
+file(WRITE ${HEADER}
+    "#pragma once\n#include <cstdint>\n\nconst uint32_t ${VARIABLE}[] = {${SPIRV_WORDS}};\n")
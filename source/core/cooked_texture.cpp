@@ -0,0 +1,188 @@
+#include "cooked_texture.hpp"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+
+#include "core/file_utils.hpp"
+#include "core/log_assert.hpp"
+
+namespace ez::CookedTexture
+{
+namespace
+{
+bool ReadHeader(std::ifstream& file, Header& header)
+{
+    file.read(reinterpret_cast<char*>(&header), sizeof(Header));
+    return file.good() && header.magic == Magic && header.version == Version;
+}
+
+// opens the file and reads header and mip table, every mip is checked against file bounds
+bool OpenMipTable(const std::string& cookedPath,
+                  std::ifstream& file,
+                  Image& image,
+                  uint64_t& dataOffset)
+{
+    file.open(cookedPath, std::ios::ate | std::ios::binary);
+    if (!file.is_open())
+    {
+        EZLOG("failed to open cooked texture:", cookedPath);
+        return false;
+    }
+    const uint64_t fileSize = static_cast<uint64_t>(file.tellg());
+    file.seekg(0);
+
+    if (!ReadHeader(file, image.header))
+    {
+        EZLOG("invalid cooked texture header:", cookedPath);
+        return false;
+    }
+
+    image.mipLevels.resize(image.header.mipLevelsCount);
+    file.read(reinterpret_cast<char*>(image.mipLevels.data()),
+              sizeof(MipLevel) * image.mipLevels.size());
+
+    dataOffset = sizeof(Header) + sizeof(MipLevel) * image.mipLevels.size();
+    if (!file.good() || image.mipLevels.empty() || dataOffset > fileSize)
+    {
+        EZLOG("invalid cooked texture mip table:", cookedPath);
+        return false;
+    }
+
+    const uint64_t dataSize = fileSize - dataOffset;
+    for (const MipLevel& mip : image.mipLevels)
+    {
+        if (mip.offset + mip.size > dataSize)
+        {
+            EZLOG("cooked texture mip is out of file bounds:", cookedPath);
+            return false;
+        }
+    }
+    return true;
+}
+
+// reads the data of mips [firstMip, firstMip + mipsCount) and drops the rest of the mip table
+bool ReadMips(std::ifstream& file,
+              const std::string& cookedPath,
+              uint64_t dataOffset,
+              uint32_t firstMip,
+              uint32_t mipsCount,
+              Image& image)
+{
+    image.mipLevels.erase(image.mipLevels.begin() + firstMip + mipsCount,
+                          image.mipLevels.end());
+    image.mipLevels.erase(image.mipLevels.begin(), image.mipLevels.begin() + firstMip);
+    image.firstMip = firstMip;
+
+    uint64_t rangeBegin = std::numeric_limits<uint64_t>::max();
+    uint64_t rangeEnd = 0;
+    for (const MipLevel& mip : image.mipLevels)
+    {
+        rangeBegin = std::min(rangeBegin, mip.offset);
+        rangeEnd = std::max(rangeEnd, mip.offset + mip.size);
+    }
+    for (MipLevel& mip : image.mipLevels) { mip.offset -= rangeBegin; }
+
+    image.data.resize(rangeEnd - rangeBegin);
+    file.seekg(static_cast<std::streamoff>(dataOffset + rangeBegin));
+    file.read(reinterpret_cast<char*>(image.data.data()),
+              static_cast<std::streamsize>(image.data.size()));
+    if (!file.good())
+    {
+        EZLOG("failed to read cooked texture data:", cookedPath);
+        return false;
+    }
+    return true;
+}
+}  // namespace
+
+std::string GetCookedPath(const std::string& sourcePath) { return sourcePath + FileExtension; }
+
+std::optional<SourceStamp> GetSourceStamp(const std::string& sourcePath)
+{
+    std::error_code ec;
+    const uint64_t fileSize = std::filesystem::file_size(sourcePath, ec);
+    if (ec) { return {}; }
+    const std::filesystem::file_time_type writeTime =
+        std::filesystem::last_write_time(sourcePath, ec);
+    if (ec) { return {}; }
+
+    return SourceStamp{ fileSize, static_cast<int64_t>(writeTime.time_since_epoch().count()) };
+}
+
+bool IsUpToDate(const std::string& sourcePath)
+{
+    const std::optional<SourceStamp> stamp = GetSourceStamp(sourcePath);
+    if (!stamp.has_value()) { return false; }
+
+    std::ifstream file(GetCookedPath(sourcePath), std::ios::binary);
+    if (!file.is_open()) { return false; }
+
+    Header header;
+    if (!ReadHeader(file, header)) { return false; }
+
+    return header.sourceFileSize == stamp->fileSize &&
+           header.sourceWriteTime == stamp->writeTime;
+}
+
+std::optional<Image> Load(const std::string& cookedPath)
+{
+    return LoadMipRange(cookedPath, 0, std::numeric_limits<uint32_t>::max());
+}
+
+std::optional<Image> LoadMipRange(const std::string& cookedPath,
+                                  uint32_t firstMip,
+                                  uint32_t mipsCount)
+{
+    std::ifstream file;
+    Image image;
+    uint64_t dataOffset = 0;
+    if (!OpenMipTable(cookedPath, file, image, dataOffset)) { return {}; }
+
+    if (firstMip >= image.mipLevels.size())
+    {
+        EZLOG("cooked texture has no mip", firstMip, cookedPath);
+        return {};
+    }
+    mipsCount = std::min(mipsCount, static_cast<uint32_t>(image.mipLevels.size()) - firstMip);
+
+    if (!ReadMips(file, cookedPath, dataOffset, firstMip, mipsCount, image)) { return {}; }
+    return image;
+}
+
+std::optional<Image> LoadMipTail(const std::string& cookedPath, uint32_t maxTailSize)
+{
+    std::ifstream file;
+    Image image;
+    uint64_t dataOffset = 0;
+    if (!OpenMipTable(cookedPath, file, image, dataOffset)) { return {}; }
+
+    // the last mip is always part of the tail, even if it is bigger than maxTailSize
+    uint32_t firstMip = static_cast<uint32_t>(image.mipLevels.size()) - 1;
+    while (firstMip > 0 && std::max(image.mipLevels[firstMip - 1].width,
+                                    image.mipLevels[firstMip - 1].height) <= maxTailSize)
+    {
+        --firstMip;
+    }
+    const uint32_t mipsCount = static_cast<uint32_t>(image.mipLevels.size()) - firstMip;
+
+    if (!ReadMips(file, cookedPath, dataOffset, firstMip, mipsCount, image)) { return {}; }
+    return image;
+}
+
+bool Save(const std::string& cookedPath, const Image& image)
+{
+    EZASSERT((image.header.mipLevelsCount == image.mipLevels.size()),
+             "Cooked texture header doesn't match its mip table");
+
+    return FileUtils::WriteFileAtomically(cookedPath, [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&image.header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(image.mipLevels.data()),
+                   sizeof(MipLevel) * image.mipLevels.size());
+        file.write(reinterpret_cast<const char*>(image.data.data()),
+                   static_cast<std::streamsize>(image.data.size()));
+    });
+}
+
+}  // namespace ez::CookedTexture
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Offline-cooked texture cache (.ezt), written by ez_cook and loaded by Texture as is:
+// the whole mip chain is precomputed, so the runtime only uploads it.
+namespace ez::CookedTexture
+{
+constexpr uint32_t Magic = 0x58545A45;  // "EZTX"
+constexpr uint32_t Version = 1;
+constexpr const char* FileExtension = ".ezt";
+
+enum class Format : uint32_t
+{
+    eRGBA8Unorm = 0,
+    eBC1RgbUnorm = 1,
+    eBC3Unorm = 2,
+};
+
+struct Header final
+{
+    uint32_t magic = Magic;
+    uint32_t version = Version;
+    Format format = Format::eRGBA8Unorm;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevelsCount = 0;
+    // stamp of the source image the file was cooked from, used for staleness checks
+    uint64_t sourceFileSize = 0;
+    int64_t sourceWriteTime = 0;
+};
+static_assert(sizeof(Header) == 40);
+
+struct MipLevel final
+{
+    uint64_t offset = 0;  // from the start of Image::data
+    uint64_t size = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+};
+static_assert(sizeof(MipLevel) == 24);
+
+struct Image final
+{
+    Header header;
+    std::vector<MipLevel> mipLevels;
+    std::vector<uint8_t> data;
+    // index of mipLevels[0] in the full chain, > 0 when only the smaller mips were loaded
+    uint32_t firstMip = 0;
+};
+
+struct SourceStamp final
+{
+    uint64_t fileSize = 0;
+    int64_t writeTime = 0;
+};
+
+std::string GetCookedPath(const std::string& sourcePath);
+std::optional<SourceStamp> GetSourceStamp(const std::string& sourcePath);
+
+// true if a cooked file exists for sourcePath and was cooked from its current version
+bool IsUpToDate(const std::string& sourcePath);
+
+std::optional<Image> Load(const std::string& cookedPath);
+// loads mips [firstMip, firstMip + mipsCount) only, offsets in mipLevels are relative to data
+std::optional<Image> LoadMipRange(const std::string& cookedPath,
+                                  uint32_t firstMip,
+                                  uint32_t mipsCount);
+// loads the smallest mips, starting from the first one that fits into maxTailSize
+std::optional<Image> LoadMipTail(const std::string& cookedPath, uint32_t maxTailSize);
+bool Save(const std::string& cookedPath, const Image& image);
+
+}  // namespace ez::CookedTexture
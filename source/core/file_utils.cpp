@@ -1,7 +1,10 @@
 #include "file_utils.hpp"
 
+#include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <sstream>
+#include <thread>
 
 #include "core/log_assert.hpp"
 
@@ -28,4 +31,76 @@ std::vector<char> ReadFile(const std::string& filename)
     return buffer;
 }
 
+std::string GetCanonicalPath(const std::string& path)
+{
+    std::error_code ec;
+    const std::filesystem::path canonicalPath = std::filesystem::weakly_canonical(path, ec);
+    return ec ? path : canonicalPath.string();
+}
+
+uint64_t Hash(const void* data, size_t size, uint64_t seed)
+{
+    constexpr uint64_t FnvPrime = 0x100000001b3ull;
+    uint64_t hash = seed;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; ++i)
+    {
+        hash ^= bytes[i];
+        hash *= FnvPrime;
+    }
+    return hash;
+}
+
+uint64_t Hash(const std::string& str, uint64_t seed)
+{
+    return Hash(str.data(), str.size(), seed);
+}
+
+std::optional<uint64_t> HashFile(const std::string& path, uint64_t seed)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) { return {}; }
+
+    uint64_t hash = seed;
+    std::vector<char> chunk(1 << 20);
+    while (file)
+    {
+        file.read(chunk.data(), static_cast<std::streamsize>(chunk.size()));
+        hash = Hash(chunk.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+    if (file.bad()) { return {}; }
+    return hash;
+}
+
+bool WriteFileAtomically(const std::string& path,
+                         const std::function<void(std::ostream&)>& write)
+{
+    std::ostringstream tmpPath;
+    tmpPath << path << ".tmp" << std::this_thread::get_id();
+    {
+        std::ofstream file(tmpPath.str(), std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            EZLOG("failed to open file for writing:", tmpPath.str());
+            return false;
+        }
+        write(file);
+        if (!file.good())
+        {
+            EZLOG("failed to write file:", tmpPath.str());
+            return false;
+        }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmpPath.str(), path, ec);
+    if (ec)
+    {
+        EZLOG("failed to move file into place:", path, ec.message());
+        std::filesystem::remove(tmpPath.str(), ec);
+        return false;
+    }
+    return true;
+}
+
 }  // namespace ez::FileUtils
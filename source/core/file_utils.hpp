@@ -1,9 +1,30 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <ostream>
 #include <string>
 #include <vector>
 
 namespace ez::FileUtils
 {
+constexpr uint64_t HashSeed = 0xcbf29ce484222325ull;  // FNV-1a offset basis
+
 std::vector<char> ReadFile(const std::string& filename);
-}
+
+// absolute path without . and .., symlinks resolved where they exist; path itself on failure
+std::string GetCanonicalPath(const std::string& path);
+
+// FNV-1a, seed chains hashes of several pieces of data
+uint64_t Hash(const void* data, size_t size, uint64_t seed = HashSeed);
+uint64_t Hash(const std::string& str, uint64_t seed = HashSeed);
+// FNV-1a of the file contents, continues from seed like Hash
+std::optional<uint64_t> HashFile(const std::string& path, uint64_t seed = HashSeed);
+
+// write fills a temporary file that is then moved to path, so that a reader never sees a
+// half-written file; the temporary name is unique per thread, several may write one path
+bool WriteFileAtomically(const std::string& path,
+                         const std::function<void(std::ostream&)>& write);
+}  // namespace ez::FileUtils
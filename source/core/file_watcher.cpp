@@ -0,0 +1,114 @@
+#include "file_watcher.hpp"
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#include <cerrno>
+#include <cstring>
+
+#include "core/file_utils.hpp"
+#include "core/log_assert.hpp"
+
+namespace ez
+{
+FileWatcher::FileWatcher()
+{
+#ifdef __linux__
+    inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) { EZLOG("inotify is not available, polling files:", strerror(errno)); }
+#endif
+}
+
+FileWatcher::~FileWatcher()
+{
+#ifdef __linux__
+    if (inotifyFd >= 0) { close(inotifyFd); }
+#endif
+}
+
+void FileWatcher::Watch(const std::vector<std::string>& paths)
+{
+    for (const std::string& path : paths)
+    {
+        const std::string canonicalPath = FileUtils::GetCanonicalPath(path);
+        if (files.count(canonicalPath) != 0) { continue; }
+
+        std::error_code ec;
+        files[canonicalPath] = std::filesystem::last_write_time(canonicalPath, ec);
+
+#ifdef __linux__
+        if (inotifyFd < 0) { continue; }
+
+        const std::string directory =
+            std::filesystem::path(canonicalPath).parent_path().string();
+        // the same directory gives the same descriptor
+        const int wd = inotify_add_watch(
+            inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+        if (wd < 0) { EZLOG("failed to watch directory:", directory, strerror(errno)); }
+        else { directories[wd] = directory; }
+#endif
+    }
+}
+
+std::vector<std::string> FileWatcher::PollChangedFiles()
+{
+    // editors often write a file in several steps, each path is reported once
+    std::unordered_set<std::string> changed;
+    if (UsesNotifications()) { PollNotifications(changed); }
+    else { PollWriteTimes(changed); }
+    return { changed.begin(), changed.end() };
+}
+
+void FileWatcher::PollNotifications(std::unordered_set<std::string>& changed)
+{
+#ifdef __linux__
+    alignas(inotify_event) char buffer[4096];
+    while (true)
+    {
+        const ssize_t length = read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+        {
+            if (length < 0 && errno != EAGAIN && errno != EINTR)
+            {
+                EZLOG("failed to read file notifications:", strerror(errno));
+            }
+            return;
+        }
+
+        for (ssize_t offset = 0; offset < length;)
+        {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            offset += sizeof(inotify_event) + event->len;
+
+            const auto directory = directories.find(event->wd);
+            if (event->len == 0 || directory == directories.end()) { continue; }
+
+            const std::string path =
+                (std::filesystem::path(directory->second) / event->name).string();
+            if (files.count(path) != 0) { changed.insert(path); }
+        }
+    }
+#endif
+}
+
+void FileWatcher::PollWriteTimes(std::unordered_set<std::string>& changed)
+{
+    const auto now = std::chrono::steady_clock::now();
+    if (now - lastPollTime < PollInterval) { return; }
+    lastPollTime = now;
+
+    for (auto& [path, writeTime] : files)
+    {
+        std::error_code ec;
+        const std::filesystem::file_time_type newWriteTime =
+            std::filesystem::last_write_time(path, ec);
+        // a file that is being replaced may be missing for a moment
+        if (ec || newWriteTime == writeTime) { continue; }
+
+        writeTime = newWriteTime;
+        changed.insert(path);
+    }
+}
+}  // namespace ez
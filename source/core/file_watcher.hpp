@@ -0,0 +1,47 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace ez
+{
+// Reports files that were written since the last poll, never blocks.
+// Uses inotify on Linux, watching the directories of the files so that editors that save by
+// renaming a temporary file over the original are noticed too. Elsewhere, or if inotify is not
+// available, modification times are polled at most every PollInterval.
+class FileWatcher final
+{
+   public:
+    static constexpr std::chrono::milliseconds PollInterval{ 250 };
+
+    FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    ~FileWatcher();
+
+    // files that are already watched are skipped, so the same list may be passed every time
+    void Watch(const std::vector<std::string>& paths);
+
+    // canonical paths of the watched files changed since the previous call
+    std::vector<std::string> PollChangedFiles();
+
+    bool UsesNotifications() const { return inotifyFd >= 0; }
+    uint32_t GetWatchedFilesCount() const { return static_cast<uint32_t>(files.size()); }
+
+   private:
+    void PollNotifications(std::unordered_set<std::string>& changed);
+    void PollWriteTimes(std::unordered_set<std::string>& changed);
+
+    // by canonical path, write time is only used when polling
+    std::unordered_map<std::string, std::filesystem::file_time_type> files;
+
+    int inotifyFd = -1;
+    // canonical directory by watch descriptor
+    std::unordered_map<int, std::string> directories;
+
+    std::chrono::steady_clock::time_point lastPollTime;
+};
+}  // namespace ez
@@ -0,0 +1,99 @@
+#include "ibl_cache.hpp"
+
+#include <algorithm>
+#include <fstream>
+
+#include "core/cooked_texture.hpp"
+#include "core/file_utils.hpp"
+#include "core/log_assert.hpp"
+
+namespace ez::IblCache
+{
+namespace
+{
+uint64_t GetSpecularSize(const Header& header)
+{
+    uint64_t size = 0;
+    for (uint32_t mip = 0; mip < header.specularMipLevelsCount; ++mip)
+    {
+        const uint64_t mipSize = std::max(header.specularSize >> mip, 1u);
+        size += mipSize * mipSize * 6 * 8;
+    }
+    return size;
+}
+
+uint64_t GetBrdfLutSize(const Header& header)
+{
+    return static_cast<uint64_t>(header.brdfLutSize) * header.brdfLutSize * 8;
+}
+}  // namespace
+
+std::string GetCachePath(const std::string& panoramaPath)
+{
+    return panoramaPath + FileExtension;
+}
+
+std::optional<uint64_t> HashPanorama(const std::string& panoramaPath)
+{
+    // the same stamp cooked textures are checked with
+    const std::optional<CookedTexture::SourceStamp> stamp =
+        CookedTexture::GetSourceStamp(panoramaPath);
+    if (!stamp.has_value()) { return {}; }
+
+    const uint64_t hash = FileUtils::Hash(FileUtils::GetCanonicalPath(panoramaPath));
+    return FileUtils::Hash(&*stamp, sizeof(CookedTexture::SourceStamp), hash);
+}
+
+std::optional<Data> Load(const std::string& cachePath, const Header& expectedHeader)
+{
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open()) { return {}; }
+
+    Data data;
+    file.read(reinterpret_cast<char*>(&data.header), sizeof(Header));
+    const Header& header = data.header;
+    if (!file.good() || header.magic != Magic || header.version != Version ||
+        header.panoramaHash != expectedHeader.panoramaHash ||
+        header.bakeSettingsHash != expectedHeader.bakeSettingsHash ||
+        header.specularSize != expectedHeader.specularSize ||
+        header.specularMipLevelsCount != expectedHeader.specularMipLevelsCount ||
+        header.brdfLutSize != expectedHeader.brdfLutSize)
+    {
+        EZLOG("ibl cache is stale or invalid:", cachePath);
+        return {};
+    }
+
+    data.specular.resize(GetSpecularSize(header));
+    data.brdfLut.resize(GetBrdfLutSize(header));
+    file.read(reinterpret_cast<char*>(data.irradianceSH.data()), sizeof(data.irradianceSH));
+    file.read(reinterpret_cast<char*>(data.specular.data()),
+              static_cast<std::streamsize>(data.specular.size()));
+    file.read(reinterpret_cast<char*>(data.brdfLut.data()),
+              static_cast<std::streamsize>(data.brdfLut.size()));
+    if (!file.good())
+    {
+        EZLOG("failed to read ibl cache data:", cachePath);
+        return {};
+    }
+
+    return data;
+}
+
+bool Save(const std::string& cachePath, const Data& data)
+{
+    EZASSERT((data.specular.size() == GetSpecularSize(data.header) &&
+              data.brdfLut.size() == GetBrdfLutSize(data.header)),
+             "Ibl cache header doesn't match its data");
+
+    return FileUtils::WriteFileAtomically(cachePath, [&](std::ostream& file) {
+        file.write(reinterpret_cast<const char*>(&data.header), sizeof(Header));
+        file.write(reinterpret_cast<const char*>(data.irradianceSH.data()),
+                   sizeof(data.irradianceSH));
+        file.write(reinterpret_cast<const char*>(data.specular.data()),
+                   static_cast<std::streamsize>(data.specular.size()));
+        file.write(reinterpret_cast<const char*>(data.brdfLut.data()),
+                   static_cast<std::streamsize>(data.brdfLut.size()));
+    });
+}
+
+}  // namespace ez::IblCache
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Disk cache of image based lighting data baked from an environment panorama (.ezibl).
+// The file lives next to the panorama and is valid only for the panorama file and the bake
+// settings it was baked with, both are identified by hashes.
+namespace ez::IblCache
+{
+constexpr uint32_t Magic = 0x4C42495A;  // "ZIBL"
+constexpr uint32_t Version = 3;
+constexpr const char* FileExtension = ".ezibl";
+
+constexpr uint32_t ShCoefficientsCount = 9;
+
+struct Header final
+{
+    uint32_t magic = Magic;
+    uint32_t version = Version;
+    // see HashPanorama
+    uint64_t panoramaHash = 0;
+    // sample counts, sizes and IBL shader sources the data was baked with
+    uint64_t bakeSettingsHash = 0;
+    // RGBA16F cubemap, full mip chain, six faces per mip
+    uint32_t specularSize = 0;
+    uint32_t specularMipLevelsCount = 0;
+    // RGBA16F, scale and bias of the split-sum approximation in RG
+    uint32_t brdfLutSize = 0;
+    uint32_t reserved = 0;
+};
+static_assert(sizeof(Header) == 40);
+
+struct Data final
+{
+    Header header;
+    // irradiance (cosine convolved) L2 SH, rgb + padding per coefficient
+    std::array<std::array<float, 4>, ShCoefficientsCount> irradianceSH{};
+    std::vector<uint8_t> specular;
+    std::vector<uint8_t> brdfLut;
+};
+
+std::string GetCachePath(const std::string& panoramaPath);
+
+// hash of the panorama path, size and modification time; hashing the contents would read the
+// whole HDR on every start just to find the cache
+std::optional<uint64_t> HashPanorama(const std::string& panoramaPath);
+
+// fails if the file is missing, broken, or was baked for other hashes or sizes
+std::optional<Data> Load(const std::string& cachePath, const Header& expectedHeader);
+bool Save(const std::string& cachePath, const Data& data);
+
+}  // namespace ez::IblCache
@@ -0,0 +1,50 @@
+#include "thread_pool.hpp"
+
+#include <algorithm>
+
+namespace ez
+{
+ThreadPool::ThreadPool(uint32_t threadsCount)
+{
+    threadsCount = std::max(threadsCount, 1u);
+    workers.reserve(threadsCount);
+    for (uint32_t i = 0; i < threadsCount; ++i)
+    {
+        workers.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+
+    for (std::thread& worker : workers) { worker.join(); }
+}
+
+uint32_t ThreadPool::GetDefaultThreadsCount()
+{
+    return std::max(std::thread::hardware_concurrency(), 1u);
+}
+
+void ThreadPool::WorkerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this]() { return stopping || !tasks.empty(); });
+            if (stopping && tasks.empty()) { return; }
+
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
+
+}  // namespace ez
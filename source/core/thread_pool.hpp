@@ -0,0 +1,52 @@
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+namespace ez
+{
+class ThreadPool final
+{
+   public:
+    ThreadPool() = delete;
+    ThreadPool(const ThreadPool&) = delete;
+
+    explicit ThreadPool(uint32_t threadsCount);
+    ~ThreadPool();
+
+    static uint32_t GetDefaultThreadsCount();
+
+    uint32_t GetThreadsCount() const { return static_cast<uint32_t>(workers.size()); }
+
+    template <typename Func>
+    auto Enqueue(Func&& func) -> std::future<decltype(func())>
+    {
+        using ReturnType = decltype(func());
+        auto task =
+            std::make_shared<std::packaged_task<ReturnType()>>(std::forward<Func>(func));
+        std::future<ReturnType> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace([task]() { (*task)(); });
+        }
+        condition.notify_one();
+        return result;
+    }
+
+   private:
+    void WorkerLoop();
+
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool stopping = false;
+};
+}  // namespace ez
@@ -12,9 +12,31 @@ constexpr int WindowWidth = 1024;
 constexpr int WindowHeight = 768;
 
 constexpr uint32_t EnvCubemapSize = 1024;
+// prefiltered specular cubemap (mip 0) and split-sum BRDF LUT baked from the env cubemap
+constexpr uint32_t IblSpecularSize = 256;
+constexpr uint32_t BrdfLutSize = 256;
+
+// cooked textures start with mips up to this size, finer ones are streamed in when seen
+constexpr bool TextureStreamingEnabled = true;
+constexpr uint32_t TextureStreamingMipTailSize = 128;
+constexpr uint64_t TextureStreamingUploadBudget = 8 * 1024 * 1024;  // bytes per frame
+
+// scene textures in one descriptor array indexed through a material table, if the device
+// supports descriptor indexing; per-material descriptor sets otherwise
+constexpr bool BindlessTexturesEnabled = true;
+constexpr uint32_t MaxBindlessTextures = 4096;
+constexpr uint32_t MaxBindlessMaterials = 1024;
 
 constexpr uint32_t MaxDescriptorSetsCount = 1000;
 
+// scene descriptor sets come from pools of this size, more pools are created when one is full
+constexpr uint32_t SceneDescriptorPoolMaxSets = 256;
+const std::map<vk::DescriptorType, uint32_t> SceneDescriptorPoolSizes = {
+    { vk::DescriptorType::eCombinedImageSampler, 5 * SceneDescriptorPoolMaxSets },
+    { vk::DescriptorType::eUniformBuffer, SceneDescriptorPoolMaxSets },
+    { vk::DescriptorType::eStorageBuffer, SceneDescriptorPoolMaxSets },
+};
+
 const std::map<vk::DescriptorType, uint32_t> VulkanDescriptorPoolSizes = {
     { vk::DescriptorType::eUniformBuffer, 32 },
     { vk::DescriptorType::eSampler, 1000 },
@@ -31,6 +53,39 @@ constexpr vk::Format DepthAttachmentFormat = vk::Format::eD32Sfloat;
 
 constexpr bool dumpGlslSources = false;
 
+// SPIRV-Tools passes run on compiled shaders, only when SPIRV-Tools is built (EZ_SPIRV_OPT)
+enum class ShaderOptimization
+{
+    eNone,
+    ePerformance,
+    eSize
+};
+constexpr ShaderOptimization ShaderOptimizationLevel = ShaderOptimization::ePerformance;
+// drops names and other debug instructions, keep them when debugging shaders in RenderDoc
+constexpr bool ShaderStripDebugInfo = true;
+
+// shaders embedded at build time (EZ_EMBED_SHADERS) are used when present, set this to compile
+// GLSL at runtime anyway, e.g. to iterate on shaders with hot reload
+constexpr bool ForceRuntimeShaderCompilation = false;
+
+// compiled SPIR-V is kept here between runs, relative to the working directory
+constexpr bool ShaderCacheEnabled = true;
+constexpr const char* ShaderCacheDirectory = "shader_cache";
+// driver pipeline cache, saved on exit
+constexpr const char* PipelineCachePath = "pipeline_cache.bin";
+
+// shaders and their includes are watched, pipelines using edited ones are rebuilt while running
+constexpr bool ShaderHotReloadEnabled = true;
+
+// pipelines of a new scene are created on workers without blocking the frame, until a material
+// pipeline is ready its primitives are drawn with a flat fallback pipeline or skipped
+enum class PendingPipelinePolicy
+{
+    eDrawFallback,
+    eSkip
+};
+constexpr PendingPipelinePolicy PendingPipelinesPolicy = PendingPipelinePolicy::eDrawFallback;
+
 // /////////////////// RUNTIME //////////////////////
 
 extern bool msaa8xEnabled;
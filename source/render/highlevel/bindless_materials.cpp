@@ -0,0 +1,272 @@
+#include "bindless_materials.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#include "core/log_assert.hpp"
+#include "render/config.hpp"
+#include "render/vulkan/vulkan_buffer.hpp"
+
+namespace ez
+{
+namespace
+{
+constexpr uint32_t MaterialTableBinding = 0;
+constexpr uint32_t TexturesBinding = 1;
+
+constexpr uint32_t DefaultWhiteTextureIndex = 0;
+constexpr uint32_t DefaultBlackTextureIndex = 1;
+
+uint32_t PackTexCoordSets(const Material::TexCoordSets& texCoordSets)
+{
+    const std::array<uint8_t, 5> sets = { texCoordSets.baseColor,
+                                          texCoordSets.metallicRoughness,
+                                          texCoordSets.normal,
+                                          texCoordSets.occlusion,
+                                          texCoordSets.emissive };
+    uint32_t packed = 0;
+    for (uint32_t i = 0; i < sets.size(); ++i)
+    {
+        if (sets[i] != 0) { packed |= 1u << i; }
+    }
+    return packed;
+}
+}  // namespace
+
+BindlessMaterials::BindlessMaterials(vk::Device aLogicalDevice) : logicalDevice(aLogicalDevice)
+{
+}
+
+BindlessMaterials::~BindlessMaterials()
+{
+    defaultWhiteTexture.reset();
+    defaultBlackTexture.reset();
+    if (materialTableMapped) { logicalDevice.unmapMemory(materialTableMemory); }
+    logicalDevice.destroyBuffer(materialTableBuffer);
+    logicalDevice.freeMemory(materialTableMemory);
+    logicalDevice.destroyDescriptorPool(descriptorPool);
+    logicalDevice.destroyDescriptorSetLayout(descriptorSetLayout);
+}
+
+ResultValue<std::unique_ptr<BindlessMaterials>> BindlessMaterials::Create(
+    vk::Device logicalDevice,
+    vk::PhysicalDevice physicalDevice,
+    vk::Queue graphicsQueue,
+    vk::CommandPool graphicsCommandPool,
+    VulkanSamplerCache& samplerCache)
+{
+    const vk::PhysicalDeviceLimits limits = physicalDevice.getProperties().limits;
+    vk::PhysicalDeviceVulkan12Properties properties12 = {};
+    vk::PhysicalDeviceProperties2 properties2 = {};
+    properties2.pNext = &properties12;
+    physicalDevice.getProperties2(&properties2);
+    const uint32_t maxSampledImages =
+        std::min(properties12.maxDescriptorSetUpdateAfterBindSampledImages,
+                 properties12.maxPerStageDescriptorUpdateAfterBindSampledImages);
+    if (maxSampledImages < Config::MaxBindlessTextures ||
+        limits.maxStorageBufferRange < sizeof(MaterialEntry) * Config::MaxBindlessMaterials)
+    {
+        EZLOG("Device descriptor limits are too low for bindless materials");
+        return GraphicsResult::Error;
+    }
+
+    auto bindlessMaterials = std::make_unique<BindlessMaterials>(logicalDevice);
+    if (!bindlessMaterials->Initialize(
+            physicalDevice, graphicsQueue, graphicsCommandPool, samplerCache))
+    {
+        EZLOG("Failed to create BindlessMaterials");
+        return GraphicsResult::Error;
+    }
+    return { GraphicsResult::Ok, std::move(bindlessMaterials) };
+}
+
+bool BindlessMaterials::Initialize(vk::PhysicalDevice physicalDevice,
+                                   vk::Queue graphicsQueue,
+                                   vk::CommandPool graphicsCommandPool,
+                                   VulkanSamplerCache& samplerCache)
+{
+    // clang-format off
+    const std::array<vk::DescriptorSetLayoutBinding, 2> setLayoutBindings = { {
+        { MaterialTableBinding, vk::DescriptorType::eStorageBuffer, 1, vk::ShaderStageFlagBits::eFragment, nullptr },
+        { TexturesBinding, vk::DescriptorType::eCombinedImageSampler, Config::MaxBindlessTextures, vk::ShaderStageFlagBits::eFragment, nullptr },
+    } };
+    // clang-format on
+    // slots past the scene textures are never written, views change while the set is bound
+    const std::array<vk::DescriptorBindingFlags, 2> bindingFlags = {
+        vk::DescriptorBindingFlags{},
+        vk::DescriptorBindingFlagBits::ePartiallyBound |
+            vk::DescriptorBindingFlagBits::eUpdateAfterBind |
+            vk::DescriptorBindingFlagBits::eUpdateUnusedWhilePending,
+    };
+    vk::DescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsCI{};
+    bindingFlagsCI.bindingCount = static_cast<uint32_t>(bindingFlags.size());
+    bindingFlagsCI.pBindingFlags = bindingFlags.data();
+
+    vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
+    descriptorSetLayoutCI.flags = vk::DescriptorSetLayoutCreateFlagBits::eUpdateAfterBindPool;
+    descriptorSetLayoutCI.pNext = &bindingFlagsCI;
+    descriptorSetLayoutCI.pBindings = setLayoutBindings.data();
+    descriptorSetLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
+    auto layoutRV = logicalDevice.createDescriptorSetLayout(descriptorSetLayoutCI, nullptr);
+    if (layoutRV.result != vk::Result::eSuccess) { return false; }
+    descriptorSetLayout = layoutRV.value;
+
+    const std::vector<vk::DescriptorPoolSize> poolSizes = {
+        { vk::DescriptorType::eStorageBuffer, 1 },
+        { vk::DescriptorType::eCombinedImageSampler, Config::MaxBindlessTextures },
+    };
+    vk::DescriptorPoolCreateInfo poolCI{};
+    poolCI.flags = vk::DescriptorPoolCreateFlagBits::eUpdateAfterBind;
+    poolCI.maxSets = 1;
+    poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCI.pPoolSizes = poolSizes.data();
+    if (logicalDevice.createDescriptorPool(&poolCI, nullptr, &descriptorPool) !=
+        vk::Result::eSuccess)
+    {
+        return false;
+    }
+
+    vk::DescriptorSetAllocateInfo descriptorSetAllocInfo{};
+    descriptorSetAllocInfo.descriptorPool = descriptorPool;
+    descriptorSetAllocInfo.descriptorSetCount = 1;
+    descriptorSetAllocInfo.pSetLayouts = &descriptorSetLayout;
+    if (logicalDevice.allocateDescriptorSets(&descriptorSetAllocInfo, &descriptorSet) !=
+        vk::Result::eSuccess)
+    {
+        return false;
+    }
+
+    // the table is rewritten only between frames, host visible memory is enough
+    const vk::DeviceSize tableSize = sizeof(MaterialEntry) * Config::MaxBindlessMaterials;
+    if (!VulkanBuffer::createBuffer(logicalDevice,
+                                    physicalDevice,
+                                    tableSize,
+                                    vk::BufferUsageFlagBits::eStorageBuffer,
+                                    vk::MemoryPropertyFlagBits::eHostVisible |
+                                        vk::MemoryPropertyFlagBits::eHostCoherent,
+                                    materialTableBuffer,
+                                    materialTableMemory))
+    {
+        return false;
+    }
+    CheckVkResult(logicalDevice.mapMemory(
+        materialTableMemory, 0, tableSize, vk::MemoryMapFlags(), &materialTableMapped));
+
+    const vk::DescriptorBufferInfo materialTableInfo{ materialTableBuffer, 0, VK_WHOLE_SIZE };
+    vk::WriteDescriptorSet write{};
+    write.dstSet = descriptorSet;
+    write.dstBinding = MaterialTableBinding;
+    write.descriptorType = vk::DescriptorType::eStorageBuffer;
+    write.descriptorCount = 1;
+    write.pBufferInfo = &materialTableInfo;
+    logicalDevice.updateDescriptorSets(1, &write, 0, nullptr);
+
+    defaultWhiteTexture = Texture::CreateDefault(
+        255, logicalDevice, physicalDevice, graphicsQueue, graphicsCommandPool, samplerCache);
+    defaultBlackTexture = Texture::CreateDefault(
+        0, logicalDevice, physicalDevice, graphicsQueue, graphicsCommandPool, samplerCache);
+    if (!defaultWhiteTexture || !defaultBlackTexture) { return false; }
+
+    Reset();
+    Update();
+    return true;
+}
+
+void BindlessMaterials::Reset()
+{
+    textures.clear();
+    textureIndices.clear();
+    materials.clear();
+    writtenTexturesCount = 0;
+
+    AddTexture(defaultWhiteTexture.get(), DefaultWhiteTextureIndex);
+    AddTexture(defaultBlackTexture.get(), DefaultBlackTextureIndex);
+    // material 0 is used when the table is full
+    AddMaterial(Material{});
+}
+
+uint32_t BindlessMaterials::AddTexture(const Texture* texture, uint32_t defaultIndex)
+{
+    if (texture == nullptr) { return defaultIndex; }
+    if (!texture->IsLoadedToGPU())
+    {
+        EZASSERT(false, "Bindless texture is not loaded to GPU");
+        return defaultIndex;
+    }
+
+    const auto it = textureIndices.find(texture);
+    if (it != textureIndices.end()) { return it->second; }
+
+    if (textures.size() >= Config::MaxBindlessTextures)
+    {
+        EZASSERT(false, "Too many bindless textures");
+        return defaultIndex;
+    }
+    const uint32_t index = static_cast<uint32_t>(textures.size());
+    textures.push_back(texture);
+    textureIndices.emplace(texture, index);
+    return index;
+}
+
+uint32_t BindlessMaterials::AddMaterial(const Material& material)
+{
+    if (materials.size() >= Config::MaxBindlessMaterials)
+    {
+        EZASSERT(false, "Too many bindless materials");
+        return 0;
+    }
+
+    MaterialEntry& entry = materials.emplace_back();
+    entry.baseColorFactor = material.baseColorFactor;
+    entry.emissiveFactor = material.emissiveFactor;
+    entry.alphaCutoff =
+        material.blendMode == BlendMode::eAlphaMask ? material.alphaCutoff : 0.0f;
+    entry.metallicFactor = material.metallicFactor;
+    entry.roughnessFactor = material.roughnessFactor;
+    entry.blendMode = static_cast<uint32_t>(material.blendMode);
+    entry.texCoordSets = PackTexCoordSets(material.texCoordSets);
+
+    // same defaults as the per-material descriptor sets
+    entry.baseColor = AddTexture(material.textures.baseColor, DefaultWhiteTextureIndex);
+    entry.metallicRoughness =
+        AddTexture(material.textures.metallicRoughness, DefaultBlackTextureIndex);
+    entry.normal = AddTexture(material.textures.normal, DefaultWhiteTextureIndex);
+    entry.occlusion = AddTexture(material.textures.occlusion, DefaultWhiteTextureIndex);
+    // white unlike the descriptor sets, emission is scaled by emissiveFactor (0 by default)
+    entry.emission = AddTexture(material.textures.emission, DefaultWhiteTextureIndex);
+    return static_cast<uint32_t>(materials.size() - 1);
+}
+
+void BindlessMaterials::Update()
+{
+    memcpy(materialTableMapped, materials.data(), materials.size() * sizeof(MaterialEntry));
+    WriteTextureDescriptors(writtenTexturesCount);
+}
+
+void BindlessMaterials::RewriteTextureDescriptors() { WriteTextureDescriptors(0); }
+
+void BindlessMaterials::WriteTextureDescriptors(uint32_t firstIndex)
+{
+    const uint32_t texturesCount = static_cast<uint32_t>(textures.size());
+    if (firstIndex >= texturesCount) { return; }
+
+    std::vector<vk::DescriptorImageInfo> imageInfos;
+    imageInfos.reserve(texturesCount - firstIndex);
+    for (uint32_t i = firstIndex; i < texturesCount; ++i)
+    {
+        imageInfos.push_back(textures[i]->descriptor);
+    }
+
+    vk::WriteDescriptorSet write{};
+    write.dstSet = descriptorSet;
+    write.dstBinding = TexturesBinding;
+    write.dstArrayElement = firstIndex;
+    write.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    write.descriptorCount = static_cast<uint32_t>(imageInfos.size());
+    write.pImageInfo = imageInfos.data();
+    logicalDevice.updateDescriptorSets(1, &write, 0, nullptr);
+
+    writtenTexturesCount = texturesCount;
+}
+}  // namespace ez
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "render/graphics_result.hpp"
+#include "render/highlevel/material.hpp"
+#include "render/highlevel/texture.hpp"
+#include "render/vulkan_include.hpp"
+
+namespace ez
+{
+class VulkanSamplerCache;
+
+// All material textures of the scene in one update-after-bind, partially bound descriptor
+// array, materials are entries of a storage buffer table with indices into it. Draws bind
+// the set once and push Material::bindlessIndex (see shaders/shader_bindless.frag).
+class BindlessMaterials
+{
+   public:
+    // std430 layout of a material table entry, see Material in shaders/shader_bindless.frag
+    struct MaterialEntry final
+    {
+        glm::vec4 baseColorFactor = glm::vec4(1.0f);
+        glm::vec3 emissiveFactor = glm::vec3(0.0f);
+        float alphaCutoff = 0.0f;
+        float metallicFactor = 1.0f;
+        float roughnessFactor = 1.0f;
+        uint32_t blendMode = 0;
+        // bit per texture in the order of the indices below, set if it uses UV set 1
+        uint32_t texCoordSets = 0;
+
+        // indices into the texture array
+        uint32_t baseColor = 0;
+        uint32_t metallicRoughness = 0;
+        uint32_t normal = 0;
+        uint32_t occlusion = 0;
+        uint32_t emission = 0;
+        uint32_t padding[3] = {};
+    };
+    static_assert(sizeof(MaterialEntry) == 80 && alignof(MaterialEntry) <= 16);
+
+    BindlessMaterials(vk::Device aLogicalDevice);
+    BindlessMaterials(const BindlessMaterials&) = delete;
+    ~BindlessMaterials();
+
+    static ResultValue<std::unique_ptr<BindlessMaterials>> Create(
+        vk::Device logicalDevice,
+        vk::PhysicalDevice physicalDevice,
+        vk::Queue graphicsQueue,
+        vk::CommandPool graphicsCommandPool,
+        VulkanSamplerCache& samplerCache);
+
+    vk::DescriptorSetLayout GetDescriptorSetLayout() const { return descriptorSetLayout; }
+    vk::DescriptorSet GetDescriptorSet() const { return descriptorSet; }
+
+    // forgets scene textures and materials, e.g. on scene reload
+    void Reset();
+
+    // registers material textures, they must be loaded to GPU; returns the table index
+    uint32_t AddMaterial(const Material& material);
+
+    // writes the material table and descriptors of textures added since the last call
+    void Update();
+
+    // streaming replaced image views, all texture descriptors are rewritten
+    void RewriteTextureDescriptors();
+
+    uint32_t GetTexturesCount() const { return static_cast<uint32_t>(textures.size()); }
+    uint32_t GetMaterialsCount() const { return static_cast<uint32_t>(materials.size()); }
+
+   private:
+    bool Initialize(vk::PhysicalDevice physicalDevice,
+                    vk::Queue graphicsQueue,
+                    vk::CommandPool graphicsCommandPool,
+                    VulkanSamplerCache& samplerCache);
+
+    uint32_t AddTexture(const Texture* texture, uint32_t defaultIndex);
+    void WriteTextureDescriptors(uint32_t firstIndex);
+
+    vk::Device logicalDevice;
+
+    vk::DescriptorSetLayout descriptorSetLayout;
+    vk::DescriptorPool descriptorPool;
+    vk::DescriptorSet descriptorSet;
+
+    vk::Buffer materialTableBuffer;
+    vk::DeviceMemory materialTableMemory;
+    void* materialTableMapped = nullptr;
+
+    // missing material textures point here, always the first two entries of the array
+    std::unique_ptr<Texture> defaultWhiteTexture;
+    std::unique_ptr<Texture> defaultBlackTexture;
+
+    std::vector<const Texture*> textures;
+    std::unordered_map<const Texture*, uint32_t> textureIndices;
+    uint32_t writtenTexturesCount = 0;
+
+    std::vector<MaterialEntry> materials;
+};
+}  // namespace ez
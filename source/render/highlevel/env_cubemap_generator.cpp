@@ -0,0 +1,288 @@
+#include "env_cubemap_generator.hpp"
+
+#include <algorithm>
+
+#include "core/log_assert.hpp"
+#include "render/highlevel/texture.hpp"
+#include "render/vulkan/vulkan_image.hpp"
+#include "render/vulkan/vulkan_pipeline_manager.hpp"
+
+namespace ez
+{
+namespace
+{
+struct PushConstants final
+{
+    uint32_t mipSize;
+    uint32_t samplesPerAxis;
+};
+
+struct DownsamplePushConstants final
+{
+    uint32_t mipSize;
+    uint32_t sourceMipSize;
+};
+
+constexpr uint32_t GroupSize = 8;
+constexpr uint32_t MaxSamplesPerAxis = 8;
+}  // namespace
+
+EnvCubemapGenerator::EnvCubemapGenerator(
+    vk::Device aLogicalDevice,
+    std::unique_ptr<VulkanAsyncSubmission> aAsyncCompute,
+    vk::DescriptorPool aDescriptorPool,
+    std::shared_ptr<VulkanComputePipeline> aPipeline,
+    std::shared_ptr<VulkanComputePipeline> aDownsamplePipeline)
+    : logicalDevice(aLogicalDevice)
+    , asyncCompute(std::move(aAsyncCompute))
+    , descriptorPool(aDescriptorPool)
+    , pipeline(std::move(aPipeline))
+    , downsamplePipeline(std::move(aDownsamplePipeline))
+{
+}
+
+EnvCubemapGenerator::~EnvCubemapGenerator()
+{
+    WaitIdle();
+
+    asyncCompute.reset();
+    pipeline.reset();
+    downsamplePipeline.reset();
+    logicalDevice.destroyDescriptorPool(descriptorPool);
+}
+
+ResultValue<std::unique_ptr<EnvCubemapGenerator>> EnvCubemapGenerator::Create(
+    vk::Device logicalDevice,
+    vk::Queue computeQueue,
+    vk::CommandPool computeCommandPool,
+    VulkanPipelineManager& pipelineManager)
+{
+    // one set per cubemap mip, mip 0 samples the panorama and the others read the previous mip
+    const std::vector<vk::DescriptorPoolSize> poolSizes = {
+        { vk::DescriptorType::eCombinedImageSampler, 1 },
+        { vk::DescriptorType::eStorageImage, 2 * MaxMipLevels },
+    };
+    vk::DescriptorPoolCreateInfo poolCI{};
+    poolCI.maxSets = MaxMipLevels;
+    poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCI.pPoolSizes = poolSizes.data();
+    vk::DescriptorPool descriptorPool;
+    CheckVkResult(logicalDevice.createDescriptorPool(&poolCI, nullptr, &descriptorPool));
+
+    auto asyncComputeRV =
+        VulkanAsyncSubmission::Create(logicalDevice, computeQueue, computeCommandPool);
+    // both shaders are compiled in parallel
+    auto pipeline = pipelineManager.CreateComputePipelineAsync(
+        sizeof(PushConstants), "../source/shaders/equirect_to_cubemap.comp");
+    auto downsamplePipeline = pipelineManager.CreateComputePipelineAsync(
+        sizeof(DownsamplePushConstants), "../source/shaders/cubemap_downsample.comp");
+    if (asyncComputeRV.result != GraphicsResult::Ok || !pipeline.get() ||
+        !downsamplePipeline.get())
+    {
+        EZLOG("Failed to create env cubemap generation pipelines");
+        logicalDevice.destroyDescriptorPool(descriptorPool);
+        return GraphicsResult::Error;
+    }
+
+    return { GraphicsResult::Ok,
+             std::make_unique<EnvCubemapGenerator>(logicalDevice,
+                                                   std::move(asyncComputeRV.value),
+                                                   descriptorPool,
+                                                   pipeline.get(),
+                                                   downsamplePipeline.get()) };
+}
+
+bool EnvCubemapGenerator::Dispatch(const Texture& panorama, const Texture& cubemap)
+{
+    if (!panorama.IsLoadedToGPU() || !cubemap.IsLoadedToGPU())
+    {
+        EZLOG("Env cubemap textures are not loaded to GPU");
+        return false;
+    }
+    EZASSERT(cubemap.imageLayersCount == 6 && cubemap.width == cubemap.height);
+    if (cubemap.mipLevels > MaxMipLevels)
+    {
+        EZASSERT(false, "Too many env cubemap mips", cubemap.mipLevels);
+        return false;
+    }
+
+    // one generator serves all cubemaps of the scene, they are processed one by one
+    WaitIdle();
+
+    std::vector<vk::DescriptorSetLayout> setLayouts(
+        cubemap.mipLevels, downsamplePipeline->GetDescriptorSetLayout(0));
+    setLayouts[0] = pipeline->GetDescriptorSetLayout(0);
+    std::vector<vk::DescriptorSet> descriptorSets(cubemap.mipLevels);
+    vk::DescriptorSetAllocateInfo descriptorSetAllocInfo{};
+    descriptorSetAllocInfo.descriptorPool = descriptorPool;
+    descriptorSetAllocInfo.descriptorSetCount = cubemap.mipLevels;
+    descriptorSetAllocInfo.pSetLayouts = setLayouts.data();
+    CheckVkResult(
+        logicalDevice.allocateDescriptorSets(&descriptorSetAllocInfo, descriptorSets.data()));
+
+    std::vector<vk::DescriptorImageInfo> storageImageInfos(cubemap.mipLevels);
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
+    for (uint32_t mip = 0; mip < cubemap.mipLevels; ++mip)
+    {
+        vk::ImageViewCreateInfo viewCI{};
+        viewCI.image = cubemap.image;
+        viewCI.viewType = vk::ImageViewType::e2DArray;
+        viewCI.format = cubemap.format;
+        viewCI.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        viewCI.subresourceRange.baseMipLevel = mip;
+        viewCI.subresourceRange.levelCount = 1;
+        viewCI.subresourceRange.baseArrayLayer = 0;
+        viewCI.subresourceRange.layerCount = cubemap.imageLayersCount;
+        vk::ImageView& mipView = mipViews.emplace_back();
+        CheckVkResult(logicalDevice.createImageView(&viewCI, nullptr, &mipView));
+
+        storageImageInfos[mip].imageView = mipView;
+        storageImageInfos[mip].imageLayout = vk::ImageLayout::eGeneral;
+
+        // mips past 0 read the previous one through its storage image info set above
+        writeDescriptorSets.emplace_back();
+        writeDescriptorSets.back().dstSet = descriptorSets[mip];
+        writeDescriptorSets.back().dstBinding = 0;
+        writeDescriptorSets.back().descriptorCount = 1;
+        if (mip == 0)
+        {
+            writeDescriptorSets.back().descriptorType =
+                vk::DescriptorType::eCombinedImageSampler;
+            writeDescriptorSets.back().pImageInfo = &panorama.descriptor;
+        }
+        else
+        {
+            writeDescriptorSets.back().descriptorType = vk::DescriptorType::eStorageImage;
+            writeDescriptorSets.back().pImageInfo = &storageImageInfos[mip - 1];
+        }
+
+        writeDescriptorSets.emplace_back();
+        writeDescriptorSets.back().dstSet = descriptorSets[mip];
+        writeDescriptorSets.back().dstBinding = 1;
+        writeDescriptorSets.back().descriptorType = vk::DescriptorType::eStorageImage;
+        writeDescriptorSets.back().descriptorCount = 1;
+        writeDescriptorSets.back().pImageInfo = &storageImageInfos[mip];
+    }
+    logicalDevice.updateDescriptorSets(static_cast<uint32_t>(writeDescriptorSets.size()),
+                                       writeDescriptorSets.data(),
+                                       0,
+                                       nullptr);
+
+    vk::CommandBuffer commandBuffer = asyncCompute->Begin();
+
+    vk::ImageSubresourceRange subresourceRange = {};
+    subresourceRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
+    subresourceRange.setLevelCount(cubemap.mipLevels);
+    subresourceRange.setLayerCount(cubemap.imageLayersCount);
+
+    Image::SubmitChangeImageLayout(commandBuffer,
+                                   vk::PipelineStageFlagBits::eTopOfPipe,
+                                   vk::PipelineStageFlagBits::eComputeShader,
+                                   cubemap.image,
+                                   subresourceRange,
+                                   vk::ImageLayout::eUndefined,
+                                   vk::ImageLayout::eGeneral,
+                                   vk::AccessFlags{},
+                                   vk::AccessFlagBits::eShaderWrite);
+
+    // mip 0 is projected from the panorama, sampled densely enough to average the panorama
+    // texels a face texel covers
+    PushConstants pushConstants;
+    pushConstants.mipSize = cubemap.width;
+    const uint32_t panoramaTexelsPerFaceTexel =
+        (std::max(panorama.width, 1u) + 4 * cubemap.width - 1) / (4 * cubemap.width);
+    pushConstants.samplesPerAxis =
+        std::clamp(panoramaTexelsPerFaceTexel, 1u, MaxSamplesPerAxis);
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline->GetPipeline());
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                     pipeline->GetPipelineLayout(),
+                                     0,
+                                     { descriptorSets[0] },
+                                     {});
+    commandBuffer.pushConstants(pipeline->GetPipelineLayout(),
+                                vk::ShaderStageFlagBits::eCompute,
+                                0,
+                                sizeof(PushConstants),
+                                &pushConstants);
+    const uint32_t groupsCount = (cubemap.width + GroupSize - 1) / GroupSize;
+    commandBuffer.dispatch(groupsCount, groupsCount, cubemap.imageLayersCount);
+
+    // the smaller mips would need more samples per texel than a dispatch can afford to avoid
+    // aliasing, each of them is reduced from the previous one instead
+    if (cubemap.mipLevels > 1)
+    {
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                                   downsamplePipeline->GetPipeline());
+    }
+    for (uint32_t mip = 1; mip < cubemap.mipLevels; ++mip)
+    {
+        vk::ImageSubresourceRange sourceMipRange = subresourceRange;
+        sourceMipRange.setBaseMipLevel(mip - 1);
+        sourceMipRange.setLevelCount(1);
+        Image::SubmitChangeImageLayout(commandBuffer,
+                                       vk::PipelineStageFlagBits::eComputeShader,
+                                       vk::PipelineStageFlagBits::eComputeShader,
+                                       cubemap.image,
+                                       sourceMipRange,
+                                       vk::ImageLayout::eGeneral,
+                                       vk::ImageLayout::eGeneral,
+                                       vk::AccessFlagBits::eShaderWrite,
+                                       vk::AccessFlagBits::eShaderRead);
+
+        DownsamplePushConstants downsamplePushConstants;
+        downsamplePushConstants.mipSize = std::max(cubemap.width >> mip, 1u);
+        downsamplePushConstants.sourceMipSize = std::max(cubemap.width >> (mip - 1), 1u);
+
+        commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                         downsamplePipeline->GetPipelineLayout(),
+                                         0,
+                                         { descriptorSets[mip] },
+                                         {});
+        commandBuffer.pushConstants(downsamplePipeline->GetPipelineLayout(),
+                                    vk::ShaderStageFlagBits::eCompute,
+                                    0,
+                                    sizeof(DownsamplePushConstants),
+                                    &downsamplePushConstants);
+
+        const uint32_t mipGroupsCount =
+            (downsamplePushConstants.mipSize + GroupSize - 1) / GroupSize;
+        commandBuffer.dispatch(mipGroupsCount, mipGroupsCount, cubemap.imageLayersCount);
+    }
+
+    Image::SubmitChangeImageLayout(commandBuffer,
+                                   vk::PipelineStageFlagBits::eComputeShader,
+                                   vk::PipelineStageFlagBits::eBottomOfPipe,
+                                   cubemap.image,
+                                   subresourceRange,
+                                   vk::ImageLayout::eGeneral,
+                                   vk::ImageLayout::eShaderReadOnlyOptimal,
+                                   vk::AccessFlagBits::eShaderWrite,
+                                   vk::AccessFlags{});
+
+    if (!asyncCompute->Submit())
+    {
+        ReleaseDispatchResources();
+        return false;
+    }
+    return true;
+}
+
+void EnvCubemapGenerator::Update()
+{
+    if (asyncCompute->Poll()) { ReleaseDispatchResources(); }
+}
+
+void EnvCubemapGenerator::WaitIdle()
+{
+    asyncCompute->WaitIdle();
+    Update();
+}
+
+void EnvCubemapGenerator::ReleaseDispatchResources()
+{
+    for (vk::ImageView mipView : mipViews) { logicalDevice.destroyImageView(mipView); }
+    mipViews.clear();
+    logicalDevice.resetDescriptorPool(descriptorPool);
+}
+}  // namespace ez
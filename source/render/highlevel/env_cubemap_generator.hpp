@@ -0,0 +1,64 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "render/graphics_result.hpp"
+#include "render/vulkan/vulkan_async_submission.hpp"
+#include "render/vulkan/vulkan_compute_pipeline.hpp"
+#include "render/vulkan_include.hpp"
+
+namespace ez
+{
+class Texture;
+class VulkanPipelineManager;
+
+// Fills a cubemap texture from an equirectangular panorama with compute passes on the compute
+// queue, mip 0 is projected from the panorama and each smaller mip is reduced from the previous
+// one. Work is submitted asynchronously, the graphics queue must wait on the semaphore
+// returned by TakeFinishedSemaphore before sampling the cubemap.
+class EnvCubemapGenerator
+{
+   public:
+    EnvCubemapGenerator(vk::Device aLogicalDevice,
+                        std::unique_ptr<VulkanAsyncSubmission> aAsyncCompute,
+                        vk::DescriptorPool aDescriptorPool,
+                        std::shared_ptr<VulkanComputePipeline> aPipeline,
+                        std::shared_ptr<VulkanComputePipeline> aDownsamplePipeline);
+    ~EnvCubemapGenerator();
+
+    static ResultValue<std::unique_ptr<EnvCubemapGenerator>> Create(
+        vk::Device logicalDevice,
+        vk::Queue computeQueue,
+        vk::CommandPool computeCommandPool,
+        VulkanPipelineManager& pipelineManager);
+
+    // cubemap must be a GPU-only RGBA16F cubemap texture with storage usage
+    bool Dispatch(const Texture& panorama, const Texture& cubemap);
+
+    // polls the submitted work and releases per-dispatch resources once it is done
+    void Update();
+    void WaitIdle();
+    bool IsBusy() const { return asyncCompute->IsBusy(); }
+
+    // returns the semaphore signaled by the last finished dispatch once, null otherwise
+    vk::Semaphore TakeFinishedSemaphore() { return asyncCompute->TakeFinishedSemaphore(); }
+
+   private:
+    static constexpr uint32_t MaxMipLevels = 16;
+
+    void ReleaseDispatchResources();
+
+    vk::Device logicalDevice;
+    std::unique_ptr<VulkanAsyncSubmission> asyncCompute;
+
+    vk::DescriptorPool descriptorPool;
+    // projects mip 0 from the panorama
+    std::shared_ptr<VulkanComputePipeline> pipeline;
+    // reduces every other mip from the previous one
+    std::shared_ptr<VulkanComputePipeline> downsamplePipeline;
+
+    // alive while the dispatch is in flight
+    std::vector<vk::ImageView> mipViews;
+};
+}  // namespace ez
@@ -0,0 +1,216 @@
+#include "hdr_decoder.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <future>
+
+#include "core/file_utils.hpp"
+#include "core/log_assert.hpp"
+#include "core/thread_pool.hpp"
+#include "render/highlevel/pixel_conversion.hpp"
+
+namespace ez::HdrDecoder
+{
+namespace
+{
+constexpr size_t RgbeSize = 4;
+constexpr size_t RgbaHalfSize = 4 * sizeof(uint16_t);
+// new-style RLE scanlines are only written for widths in this range
+constexpr uint32_t MinRleWidth = 8;
+constexpr uint32_t MaxRleWidth = 0x7FFF;
+// several chunks per thread so that slow (less compressible) rows even out
+constexpr uint32_t ChunksPerThread = 4;
+
+struct Header final
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    size_t dataOffset = 0;
+};
+
+struct Scanline final
+{
+    size_t offset = 0;
+    bool isRle = false;
+};
+
+bool ReadLine(const std::vector<char>& file, size_t& offset, std::string& line)
+{
+    const auto begin = file.begin() + static_cast<std::ptrdiff_t>(offset);
+    const auto end = std::find(begin, file.end(), '\n');
+    if (end == file.end()) { return false; }
+
+    line.assign(begin, end);
+    offset = static_cast<size_t>(end - file.begin()) + 1;
+    return true;
+}
+
+std::optional<Header> ReadHeader(const std::vector<char>& file, const std::string& path)
+{
+    size_t offset = 0;
+    std::string line;
+    if (!ReadLine(file, offset, line) || (line != "#?RADIANCE" && line != "#?RGBE"))
+    {
+        EZLOG("not a radiance hdr file:", path);
+        return {};
+    }
+
+    // header ends with an empty line, files without FORMAT are rgbe by default
+    while (ReadLine(file, offset, line) && !line.empty())
+    {
+        if (line.rfind("FORMAT=", 0) == 0 && line != "FORMAT=32-bit_rle_rgbe")
+        {
+            EZLOG("unsupported hdr format:", line, path);
+            return {};
+        }
+    }
+
+    int height = 0;
+    int width = 0;
+    if (!ReadLine(file, offset, line) ||
+        std::sscanf(line.c_str(), "-Y %d +X %d", &height, &width) != 2 || height <= 0 ||
+        width <= 0)
+    {
+        EZLOG("unsupported hdr resolution line:", line, path);
+        return {};
+    }
+
+    return Header{ static_cast<uint32_t>(width), static_cast<uint32_t>(height), offset };
+}
+
+bool IsRleScanline(const uint8_t* data, size_t size, size_t offset, uint32_t width)
+{
+    if (width < MinRleWidth || width > MaxRleWidth || offset + 4 > size) { return false; }
+    const uint8_t* marker = data + offset;
+    const uint32_t markerWidth = (static_cast<uint32_t>(marker[2]) << 8) | marker[3];
+    return marker[0] == 2 && marker[1] == 2 && markerWidth == width;
+}
+
+// walks the run headers of every channel, returns the offset of the next scanline
+std::optional<size_t> SkipRleScanline(const uint8_t* data,
+                                      size_t size,
+                                      size_t offset,
+                                      uint32_t width)
+{
+    offset += 4;
+    for (size_t channel = 0; channel < RgbeSize; ++channel)
+    {
+        uint32_t x = 0;
+        while (x < width)
+        {
+            if (offset >= size) { return {}; }
+            uint32_t count = data[offset++];
+            if (count > 128)
+            {
+                count -= 128;
+                offset += 1;
+            }
+            else { offset += count; }
+
+            x += count;
+            if (count == 0 || x > width) { return {}; }
+        }
+    }
+    if (offset > size) { return {}; }
+    return offset;
+}
+
+// scanline was validated by SkipRleScanline, channels are stored one after another
+void DecodeRleScanline(const uint8_t* data, size_t offset, uint32_t width, uint8_t* rgbe)
+{
+    offset += 4;
+    for (size_t channel = 0; channel < RgbeSize; ++channel)
+    {
+        uint32_t x = 0;
+        while (x < width)
+        {
+            uint32_t count = data[offset++];
+            if (count > 128)
+            {
+                count -= 128;
+                const uint8_t value = data[offset++];
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    rgbe[(x + i) * RgbeSize + channel] = value;
+                }
+            }
+            else
+            {
+                for (uint32_t i = 0; i < count; ++i)
+                {
+                    rgbe[(x + i) * RgbeSize + channel] = data[offset++];
+                }
+            }
+            x += count;
+        }
+    }
+}
+}  // namespace
+
+std::optional<Image> LoadRgbaHalf(const std::string& path)
+{
+    const std::vector<char> file = FileUtils::ReadFile(path);
+    if (file.empty()) { return {}; }
+
+    const std::optional<Header> header = ReadHeader(file, path);
+    if (!header.has_value()) { return {}; }
+    const uint32_t width = header->width;
+    const uint32_t height = header->height;
+
+    // the only sequential part: compressed scanline sizes are known after walking their runs
+    const uint8_t* data = reinterpret_cast<const uint8_t*>(file.data());
+    const size_t size = file.size();
+    std::vector<Scanline> scanlines(height);
+    size_t offset = header->dataOffset;
+    for (Scanline& scanline : scanlines)
+    {
+        scanline.offset = offset;
+        scanline.isRle = IsRleScanline(data, size, offset, width);
+        const std::optional<size_t> next =
+            scanline.isRle ? SkipRleScanline(data, size, offset, width)
+                           : std::optional<size_t>(offset + width * RgbeSize);
+        if (!next.has_value() || next.value() > size)
+        {
+            EZLOG("truncated or corrupted hdr file:", path);
+            return {};
+        }
+        offset = next.value();
+    }
+
+    Image image;
+    image.width = width;
+    image.height = height;
+    image.rgbaHalf.resize(static_cast<size_t>(width) * height * RgbaHalfSize);
+
+    const uint32_t threadsCount = ThreadPool::GetDefaultThreadsCount();
+    const uint32_t rowsPerChunk = std::max(height / (threadsCount * ChunksPerThread), 1u);
+    {
+        ThreadPool threadPool(std::min(threadsCount, height));
+        std::vector<std::future<void>> jobs;
+        for (uint32_t firstRow = 0; firstRow < height; firstRow += rowsPerChunk)
+        {
+            const uint32_t lastRow = std::min(firstRow + rowsPerChunk, height);
+            jobs.push_back(threadPool.Enqueue([&, firstRow, lastRow]() {
+                std::vector<uint8_t> rgbe(width * RgbeSize);
+                for (uint32_t y = firstRow; y < lastRow; ++y)
+                {
+                    const Scanline& scanline = scanlines[y];
+                    const uint8_t* src = data + scanline.offset;
+                    if (scanline.isRle)
+                    {
+                        DecodeRleScanline(data, scanline.offset, width, rgbe.data());
+                        src = rgbe.data();
+                    }
+                    uint16_t* dst = reinterpret_cast<uint16_t*>(image.rgbaHalf.data() +
+                                                                y * width * RgbaHalfSize);
+                    PixelConversion::RgbeToRgbaHalf(src, dst, width);
+                }
+            }));
+        }
+        for (std::future<void>& job : jobs) { job.get(); }
+    }
+
+    return image;
+}
+
+}  // namespace ez::HdrDecoder
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Radiance .hdr (RGBE) decoder. Scanline starts are found with a quick pass over the RLE run
+// headers, then chunks of scanlines are decoded in parallel straight into RGBA16F.
+namespace ez::HdrDecoder
+{
+struct Image final
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    // RGBA16F, top row first, alpha is 1
+    std::vector<uint8_t> rgbaHalf;
+};
+
+// only the common "-Y height +X width" orientation is supported
+std::optional<Image> LoadRgbaHalf(const std::string& path);
+
+}  // namespace ez::HdrDecoder
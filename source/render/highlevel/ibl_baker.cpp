@@ -0,0 +1,711 @@
+#include "ibl_baker.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "core/file_utils.hpp"
+#include "core/log_assert.hpp"
+#include "render/config.hpp"
+#include "render/highlevel/texture.hpp"
+#include "render/vulkan/vulkan_buffer.hpp"
+#include "render/vulkan/vulkan_image.hpp"
+#include "render/vulkan/vulkan_pipeline_manager.hpp"
+#include "render/vulkan/vulkan_shader_compiler.hpp"
+
+namespace ez
+{
+namespace
+{
+struct IrradiancePushConstants final
+{
+    uint32_t faceSize;
+    float lod;
+};
+
+struct PrefilterPushConstants final
+{
+    uint32_t mipSize;
+    uint32_t envSize;
+    uint32_t samplesCount;
+    float roughness;
+};
+
+struct BrdfLutPushConstants final
+{
+    uint32_t lutSize;
+    uint32_t samplesCount;
+};
+
+constexpr uint32_t GroupSize = 8;
+constexpr uint32_t MaxSpecularMipLevels = 16;
+// SH projection reads this face size of the env cubemap, low frequencies only need few texels
+constexpr uint32_t IrradianceFaceSize = 32;
+constexpr uint32_t PrefilterSamplesCount = 256;
+constexpr uint32_t BrdfLutSamplesCount = 512;
+constexpr uint32_t Rgba16fTexelSize = 8;
+
+uint32_t GetFullMipChainLength(uint32_t size)
+{
+    return static_cast<uint32_t>(std::floor(std::log2(size))) + 1;
+}
+
+uint32_t GetGroupsCount(uint32_t size) { return (size + GroupSize - 1) / GroupSize; }
+}  // namespace
+
+IblBaker::IblBaker(const IblBakerCreateInfo& aCreateInfo) : createInfo(aCreateInfo) {}
+
+IblBaker::~IblBaker()
+{
+    if (asyncCompute)
+    {
+        WaitIdle();
+        asyncCompute.reset();
+    }
+    ReleaseOutputs();
+
+    createInfo.logicalDevice.destroyDescriptorPool(descriptorPool);
+    for (ComputePass* pass : { &irradiancePass, &prefilterPass, &brdfLutPass })
+    {
+        pass->pipeline.reset();
+    }
+}
+
+ResultValue<std::unique_ptr<IblBaker>> IblBaker::Create(const IblBakerCreateInfo& createInfo,
+                                                        VulkanPipelineManager& pipelineManager)
+{
+    auto iblBaker = std::make_unique<IblBaker>(createInfo);
+    if (!iblBaker->Initialize(pipelineManager))
+    {
+        EZLOG("Failed to initialize IblBaker");
+        return GraphicsResult::Error;
+    }
+    return { GraphicsResult::Ok, std::move(iblBaker) };
+}
+
+bool IblBaker::Initialize(VulkanPipelineManager& pipelineManager)
+{
+    auto asyncComputeRV = VulkanAsyncSubmission::Create(
+        createInfo.logicalDevice, createInfo.computeQueue, createInfo.computeCommandPool);
+    if (asyncComputeRV.result != GraphicsResult::Ok) { return false; }
+    asyncCompute = std::move(asyncComputeRV.value);
+
+    const bool passesCreated =
+        CreatePass(pipelineManager,
+                   sizeof(IrradiancePushConstants),
+                   "../source/shaders/ibl_irradiance_sh.comp",
+                   irradiancePass) &&
+        CreatePass(pipelineManager,
+                   sizeof(PrefilterPushConstants),
+                   "../source/shaders/ibl_specular_prefilter.comp",
+                   prefilterPass) &&
+        CreatePass(pipelineManager,
+                   sizeof(BrdfLutPushConstants),
+                   "../source/shaders/ibl_brdf_lut.comp",
+                   brdfLutPass);
+    if (!passesCreated) { return false; }
+
+    // irradiance + one set per specular mip + brdf lut
+    const uint32_t maxSetsCount = MaxSpecularMipLevels + 2;
+    const std::vector<vk::DescriptorPoolSize> poolSizes = {
+        { vk::DescriptorType::eCombinedImageSampler, MaxSpecularMipLevels + 1 },
+        { vk::DescriptorType::eStorageImage, MaxSpecularMipLevels + 1 },
+        { vk::DescriptorType::eStorageBuffer, 1 },
+    };
+    vk::DescriptorPoolCreateInfo poolCI{};
+    poolCI.maxSets = maxSetsCount;
+    poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCI.pPoolSizes = poolSizes.data();
+    return createInfo.logicalDevice.createDescriptorPool(&poolCI, nullptr, &descriptorPool) ==
+           vk::Result::eSuccess;
+}
+
+bool IblBaker::CreatePass(VulkanPipelineManager& pipelineManager,
+                          uint32_t pushConstantsSize,
+                          const std::string& shaderName,
+                          ComputePass& pass)
+{
+    auto pipelineRV = pipelineManager.CreateComputePipeline(pushConstantsSize, shaderName);
+    if (pipelineRV.result != GraphicsResult::Ok) { return false; }
+    pass.pipeline = std::move(pipelineRV.value);
+    pass.shaderName = shaderName;
+    return true;
+}
+
+uint64_t IblBaker::GetBakeSettingsHash() const
+{
+    const std::array<uint32_t, 6> settings = { Config::EnvCubemapSize,
+                                               Config::IblSpecularSize,
+                                               Config::BrdfLutSize,
+                                               IrradianceFaceSize,
+                                               PrefilterSamplesCount,
+                                               BrdfLutSamplesCount };
+    uint64_t hash = FileUtils::Hash(settings.data(), sizeof(settings));
+
+    // embedded SPIR-V is all that will run, otherwise the sources the passes were compiled from
+    const bool embeddedShaders = SpirVShaderCompiler::UsesEmbeddedShaders();
+    for (const ComputePass* pass : { &irradiancePass, &prefilterPass, &brdfLutPass })
+    {
+        if (embeddedShaders)
+        {
+            const std::vector<uint32_t> spirv =
+                SpirVShaderCompiler::CompileFromGLSL(pass->shaderName);
+            hash = FileUtils::Hash(spirv.data(), spirv.size() * sizeof(uint32_t), hash);
+            continue;
+        }
+        for (const std::string& file : SpirVShaderCompiler::GetSourceFiles(pass->shaderName))
+        {
+            // an unreadable file still keys the cache by its name
+            const std::optional<uint64_t> fileHash = FileUtils::HashFile(file, hash);
+            hash = fileHash.has_value() ? *fileHash : FileUtils::Hash(file, hash);
+        }
+    }
+    return hash;
+}
+
+bool IblBaker::Bake(const std::string& panoramaPath, const Texture& envCubemap)
+{
+    WaitIdle();
+    ReleaseOutputs();
+
+    IblCache::Header header;
+    header.specularSize = Config::IblSpecularSize;
+    header.specularMipLevelsCount = GetFullMipChainLength(Config::IblSpecularSize);
+    header.brdfLutSize = Config::BrdfLutSize;
+    header.bakeSettingsHash = GetBakeSettingsHash();
+
+    const std::optional<uint64_t> panoramaHash = IblCache::HashPanorama(panoramaPath);
+    const std::string cachePath = IblCache::GetCachePath(panoramaPath);
+    if (panoramaHash.has_value())
+    {
+        header.panoramaHash = *panoramaHash;
+        std::optional<IblCache::Data> cachedData = IblCache::Load(cachePath, header);
+        if (cachedData.has_value()) { return LoadFromCache(std::move(*cachedData)); }
+    }
+
+    // without a hash there is nothing to key the cache with, bake without saving
+    pendingHeader = header;
+    pendingCachePath = panoramaHash.has_value() ? cachePath : std::string{};
+    return Dispatch(envCubemap);
+}
+
+bool IblBaker::LoadFromCache(IblCache::Data&& data)
+{
+    const IblCache::Header& header = data.header;
+    for (uint32_t i = 0; i < IblCache::ShCoefficientsCount; ++i)
+    {
+        irradianceSH[i] = glm::vec4(data.irradianceSH[i][0],
+                                    data.irradianceSH[i][1],
+                                    data.irradianceSH[i][2],
+                                    data.irradianceSH[i][3]);
+    }
+
+    TextureSampler specularSampler = {};
+    TextureCreationInfo specularCI =
+        TextureCreationInfo::CreateFromMipChain(vk::Format::eR16G16B16A16Sfloat,
+                                                Rgba16fTexelSize,
+                                                header.specularSize,
+                                                header.specularSize,
+                                                6,
+                                                header.specularMipLevelsCount,
+                                                std::move(data.specular),
+                                                specularSampler);
+    specularCI.SetIsCubemap(true);
+    specularTexture = std::make_unique<Texture>(std::move(specularCI));
+
+    TextureSampler brdfLutSampler = {};
+    brdfLutSampler.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    brdfLutSampler.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    brdfLutTexture = std::make_unique<Texture>(
+        TextureCreationInfo::CreateFromMipChain(vk::Format::eR16G16B16A16Sfloat,
+                                                Rgba16fTexelSize,
+                                                header.brdfLutSize,
+                                                header.brdfLutSize,
+                                                1,
+                                                1,
+                                                std::move(data.brdfLut),
+                                                brdfLutSampler));
+
+    if (!LoadTexture(*specularTexture) || !LoadTexture(*brdfLutTexture))
+    {
+        ReleaseOutputs();
+        return false;
+    }
+
+    EZLOG("ibl loaded from cache");
+    ready = true;
+    loadedFromCache = true;
+    return true;
+}
+
+bool IblBaker::Dispatch(const Texture& envCubemap)
+{
+    vk::Device logicalDevice = createInfo.logicalDevice;
+    const uint32_t specularSize = pendingHeader.specularSize;
+    const uint32_t brdfLutSize = pendingHeader.brdfLutSize;
+    const bool needReadback = !pendingCachePath.empty();
+
+    const vk::ImageUsageFlags outputUsage =
+        vk::ImageUsageFlagBits::eStorage |
+        (needReadback ? vk::ImageUsageFlagBits::eTransferSrc : vk::ImageUsageFlags{});
+
+    TextureSampler specularSampler = {};
+    TextureCreationInfo specularCI =
+        TextureCreationInfo::CreateGpuOnly(vk::Format::eR16G16B16A16Sfloat,
+                                           specularSize,
+                                           specularSize,
+                                           6,
+                                           true,
+                                           outputUsage,
+                                           specularSampler);
+    specularCI.SetIsCubemap(true);
+    specularTexture = std::make_unique<Texture>(std::move(specularCI));
+
+    TextureSampler brdfLutSampler = {};
+    brdfLutSampler.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    brdfLutSampler.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    brdfLutTexture = std::make_unique<Texture>(
+        TextureCreationInfo::CreateGpuOnly(vk::Format::eR16G16B16A16Sfloat,
+                                           brdfLutSize,
+                                           brdfLutSize,
+                                           1,
+                                           false,
+                                           outputUsage,
+                                           brdfLutSampler));
+
+    if (!LoadTexture(*specularTexture) || !LoadTexture(*brdfLutTexture))
+    {
+        ReleaseOutputs();
+        return false;
+    }
+    EZASSERT(specularTexture->mipLevels == pendingHeader.specularMipLevelsCount);
+    if (specularTexture->mipLevels > MaxSpecularMipLevels)
+    {
+        EZASSERT(false, "Too many ibl specular mips", specularTexture->mipLevels);
+        ReleaseOutputs();
+        return false;
+    }
+
+    VulkanBuffer::createBuffer(logicalDevice,
+                               createInfo.physicalDevice,
+                               sizeof(glm::vec4) * IblCache::ShCoefficientsCount,
+                               vk::BufferUsageFlagBits::eStorageBuffer,
+                               vk::MemoryPropertyFlagBits::eHostVisible |
+                                   vk::MemoryPropertyFlagBits::eHostCoherent,
+                               shBuffer,
+                               shBufferMemory);
+
+    // descriptors
+    const vk::DescriptorSet irradianceSet = AllocateDescriptorSet(irradiancePass);
+    const vk::DescriptorSet brdfLutSet = AllocateDescriptorSet(brdfLutPass);
+    std::vector<vk::DescriptorSet> prefilterSets;
+    for (uint32_t mip = 0; mip < specularTexture->mipLevels; ++mip)
+    {
+        prefilterSets.push_back(AllocateDescriptorSet(prefilterPass));
+    }
+
+    const vk::DescriptorBufferInfo shBufferInfo{ shBuffer, 0, VK_WHOLE_SIZE };
+    const vk::DescriptorImageInfo brdfLutImageInfo{ nullptr,
+                                                    brdfLutTexture->descriptor.imageView,
+                                                    vk::ImageLayout::eGeneral };
+    std::vector<vk::DescriptorImageInfo> mipImageInfos(specularTexture->mipLevels);
+
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets;
+    const auto addWrite = [&writeDescriptorSets](vk::DescriptorSet set,
+                                                 uint32_t binding,
+                                                 vk::DescriptorType type,
+                                                 const vk::DescriptorImageInfo* imageInfo,
+                                                 const vk::DescriptorBufferInfo* bufferInfo) {
+        vk::WriteDescriptorSet& write = writeDescriptorSets.emplace_back();
+        write.dstSet = set;
+        write.dstBinding = binding;
+        write.descriptorType = type;
+        write.descriptorCount = 1;
+        write.pImageInfo = imageInfo;
+        write.pBufferInfo = bufferInfo;
+    };
+
+    addWrite(irradianceSet,
+             0,
+             vk::DescriptorType::eCombinedImageSampler,
+             &envCubemap.descriptor,
+             nullptr);
+    addWrite(irradianceSet, 1, vk::DescriptorType::eStorageBuffer, nullptr, &shBufferInfo);
+    addWrite(brdfLutSet, 0, vk::DescriptorType::eStorageImage, &brdfLutImageInfo, nullptr);
+    for (uint32_t mip = 0; mip < specularTexture->mipLevels; ++mip)
+    {
+        vk::ImageViewCreateInfo viewCI{};
+        viewCI.image = specularTexture->image;
+        viewCI.viewType = vk::ImageViewType::e2DArray;
+        viewCI.format = specularTexture->format;
+        viewCI.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        viewCI.subresourceRange.baseMipLevel = mip;
+        viewCI.subresourceRange.levelCount = 1;
+        viewCI.subresourceRange.baseArrayLayer = 0;
+        viewCI.subresourceRange.layerCount = specularTexture->imageLayersCount;
+        vk::ImageView& mipView = mipViews.emplace_back();
+        CheckVkResult(logicalDevice.createImageView(&viewCI, nullptr, &mipView));
+        mipImageInfos[mip] =
+            vk::DescriptorImageInfo{ nullptr, mipView, vk::ImageLayout::eGeneral };
+
+        addWrite(prefilterSets[mip],
+                 0,
+                 vk::DescriptorType::eCombinedImageSampler,
+                 &envCubemap.descriptor,
+                 nullptr);
+        addWrite(prefilterSets[mip],
+                 1,
+                 vk::DescriptorType::eStorageImage,
+                 &mipImageInfos[mip],
+                 nullptr);
+    }
+    logicalDevice.updateDescriptorSets(static_cast<uint32_t>(writeDescriptorSets.size()),
+                                       writeDescriptorSets.data(),
+                                       0,
+                                       nullptr);
+
+    // commands
+    vk::CommandBuffer commandBuffer = asyncCompute->Begin();
+
+    // env cubemap is written by an earlier submission to the same queue
+    vk::ImageSubresourceRange envRange = {};
+    envRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
+    envRange.setLevelCount(envCubemap.mipLevels);
+    envRange.setLayerCount(envCubemap.imageLayersCount);
+    Image::SubmitChangeImageLayout(commandBuffer,
+                                   vk::PipelineStageFlagBits::eComputeShader,
+                                   vk::PipelineStageFlagBits::eComputeShader,
+                                   envCubemap.image,
+                                   envRange,
+                                   vk::ImageLayout::eShaderReadOnlyOptimal,
+                                   vk::ImageLayout::eShaderReadOnlyOptimal,
+                                   vk::AccessFlagBits::eShaderWrite,
+                                   vk::AccessFlagBits::eShaderRead);
+
+    vk::ImageSubresourceRange specularRange = {};
+    specularRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
+    specularRange.setLevelCount(specularTexture->mipLevels);
+    specularRange.setLayerCount(specularTexture->imageLayersCount);
+    vk::ImageSubresourceRange brdfLutRange = {};
+    brdfLutRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
+    brdfLutRange.setLevelCount(1);
+    brdfLutRange.setLayerCount(1);
+    for (const auto& [image, range] : { std::make_pair(specularTexture->image, specularRange),
+                                        std::make_pair(brdfLutTexture->image, brdfLutRange) })
+    {
+        Image::SubmitChangeImageLayout(commandBuffer,
+                                       vk::PipelineStageFlagBits::eTopOfPipe,
+                                       vk::PipelineStageFlagBits::eComputeShader,
+                                       image,
+                                       range,
+                                       vk::ImageLayout::eUndefined,
+                                       vk::ImageLayout::eGeneral,
+                                       vk::AccessFlags{},
+                                       vk::AccessFlagBits::eShaderWrite);
+    }
+
+    // irradiance SH
+    {
+        IrradiancePushConstants pushConstants;
+        pushConstants.faceSize = std::min(IrradianceFaceSize, envCubemap.width);
+        pushConstants.lod = std::log2(static_cast<float>(envCubemap.width) /
+                                      static_cast<float>(pushConstants.faceSize));
+
+        const vk::PipelineLayout layout = irradiancePass.pipeline->GetPipelineLayout();
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                                   irradiancePass.pipeline->GetPipeline());
+        commandBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eCompute, layout, 0, { irradianceSet }, {});
+        commandBuffer.pushConstants(layout,
+                                    vk::ShaderStageFlagBits::eCompute,
+                                    0,
+                                    sizeof(pushConstants),
+                                    &pushConstants);
+        commandBuffer.dispatch(1, 1, 1);
+    }
+
+    // specular prefilter, roughness 0 at mip 0 up to 1 at the last mip
+    {
+        const vk::PipelineLayout layout = prefilterPass.pipeline->GetPipelineLayout();
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                                   prefilterPass.pipeline->GetPipeline());
+        const uint32_t mipLevels = specularTexture->mipLevels;
+        for (uint32_t mip = 0; mip < mipLevels; ++mip)
+        {
+            PrefilterPushConstants pushConstants;
+            pushConstants.mipSize = std::max(specularSize >> mip, 1u);
+            pushConstants.envSize = envCubemap.width;
+            pushConstants.samplesCount = PrefilterSamplesCount;
+            pushConstants.roughness =
+                mipLevels > 1 ? static_cast<float>(mip) / static_cast<float>(mipLevels - 1)
+                              : 0.0f;
+
+            commandBuffer.bindDescriptorSets(
+                vk::PipelineBindPoint::eCompute, layout, 0, { prefilterSets[mip] }, {});
+            commandBuffer.pushConstants(layout,
+                                        vk::ShaderStageFlagBits::eCompute,
+                                        0,
+                                        sizeof(pushConstants),
+                                        &pushConstants);
+            const uint32_t groupsCount = GetGroupsCount(pushConstants.mipSize);
+            commandBuffer.dispatch(groupsCount, groupsCount, 6);
+        }
+    }
+
+    // brdf lut
+    {
+        BrdfLutPushConstants pushConstants;
+        pushConstants.lutSize = brdfLutSize;
+        pushConstants.samplesCount = BrdfLutSamplesCount;
+
+        const vk::PipelineLayout layout = brdfLutPass.pipeline->GetPipelineLayout();
+        commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute,
+                                   brdfLutPass.pipeline->GetPipeline());
+        commandBuffer.bindDescriptorSets(
+            vk::PipelineBindPoint::eCompute, layout, 0, { brdfLutSet }, {});
+        commandBuffer.pushConstants(layout,
+                                    vk::ShaderStageFlagBits::eCompute,
+                                    0,
+                                    sizeof(pushConstants),
+                                    &pushConstants);
+        const uint32_t groupsCount = GetGroupsCount(brdfLutSize);
+        commandBuffer.dispatch(groupsCount, groupsCount, 1);
+    }
+
+    if (needReadback) { RecordReadback(commandBuffer); }
+
+    const vk::ImageLayout srcLayout =
+        needReadback ? vk::ImageLayout::eTransferSrcOptimal : vk::ImageLayout::eGeneral;
+    const vk::AccessFlags srcAccess = needReadback ? vk::AccessFlagBits::eTransferRead
+                                                   : vk::AccessFlagBits::eShaderWrite;
+    const vk::PipelineStageFlags srcStage = needReadback
+                                                ? vk::PipelineStageFlagBits::eTransfer
+                                                : vk::PipelineStageFlagBits::eComputeShader;
+    for (const auto& [image, range] : { std::make_pair(specularTexture->image, specularRange),
+                                        std::make_pair(brdfLutTexture->image, brdfLutRange) })
+    {
+        Image::SubmitChangeImageLayout(commandBuffer,
+                                       srcStage,
+                                       vk::PipelineStageFlagBits::eBottomOfPipe,
+                                       image,
+                                       range,
+                                       srcLayout,
+                                       vk::ImageLayout::eShaderReadOnlyOptimal,
+                                       srcAccess,
+                                       vk::AccessFlags{});
+    }
+
+    // SH and readback buffers are read on host after the fence
+    vk::MemoryBarrier hostReadBarrier{};
+    hostReadBarrier.srcAccessMask =
+        vk::AccessFlagBits::eShaderWrite | vk::AccessFlagBits::eTransferWrite;
+    hostReadBarrier.dstAccessMask = vk::AccessFlagBits::eHostRead;
+    commandBuffer.pipelineBarrier(
+        vk::PipelineStageFlagBits::eComputeShader | vk::PipelineStageFlagBits::eTransfer,
+        vk::PipelineStageFlagBits::eHost,
+        vk::DependencyFlags{},
+        { hostReadBarrier },
+        {},
+        {});
+
+    if (!asyncCompute->Submit())
+    {
+        ReleaseDispatchResources();
+        ReleaseOutputs();
+        return false;
+    }
+    return true;
+}
+
+void IblBaker::RecordReadback(vk::CommandBuffer commandBuffer)
+{
+    const uint32_t specularMipLevels = specularTexture->mipLevels;
+    uint64_t readbackSize = 0;
+    std::vector<vk::BufferImageCopy> specularRegions;
+    for (uint32_t mip = 0; mip < specularMipLevels; ++mip)
+    {
+        const uint32_t mipSize = std::max(specularTexture->width >> mip, 1u);
+        vk::BufferImageCopy& region = specularRegions.emplace_back();
+        region.setBufferOffset(readbackSize);
+        region.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
+        region.imageSubresource.setMipLevel(mip);
+        region.imageSubresource.setBaseArrayLayer(0);
+        region.imageSubresource.setLayerCount(specularTexture->imageLayersCount);
+        region.imageExtent.setWidth(mipSize);
+        region.imageExtent.setHeight(mipSize);
+        region.imageExtent.setDepth(1);
+        readbackSize += static_cast<uint64_t>(mipSize) * mipSize *
+                        specularTexture->imageLayersCount * Rgba16fTexelSize;
+    }
+
+    vk::BufferImageCopy brdfLutRegion{};
+    brdfLutRegion.setBufferOffset(readbackSize);
+    brdfLutRegion.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
+    brdfLutRegion.imageSubresource.setLayerCount(1);
+    brdfLutRegion.imageExtent.setWidth(brdfLutTexture->width);
+    brdfLutRegion.imageExtent.setHeight(brdfLutTexture->height);
+    brdfLutRegion.imageExtent.setDepth(1);
+    readbackSize += static_cast<uint64_t>(brdfLutTexture->width) * brdfLutTexture->height *
+                    Rgba16fTexelSize;
+
+    VulkanBuffer::createBuffer(createInfo.logicalDevice,
+                               createInfo.physicalDevice,
+                               readbackSize,
+                               vk::BufferUsageFlagBits::eTransferDst,
+                               vk::MemoryPropertyFlagBits::eHostVisible |
+                                   vk::MemoryPropertyFlagBits::eHostCoherent,
+                               readbackBuffer,
+                               readbackBufferMemory);
+
+    vk::ImageSubresourceRange specularRange = {};
+    specularRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
+    specularRange.setLevelCount(specularMipLevels);
+    specularRange.setLayerCount(specularTexture->imageLayersCount);
+    vk::ImageSubresourceRange brdfLutRange = {};
+    brdfLutRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
+    brdfLutRange.setLevelCount(1);
+    brdfLutRange.setLayerCount(1);
+    for (const auto& [image, range] : { std::make_pair(specularTexture->image, specularRange),
+                                        std::make_pair(brdfLutTexture->image, brdfLutRange) })
+    {
+        Image::SubmitChangeImageLayout(commandBuffer,
+                                       vk::PipelineStageFlagBits::eComputeShader,
+                                       vk::PipelineStageFlagBits::eTransfer,
+                                       image,
+                                       range,
+                                       vk::ImageLayout::eGeneral,
+                                       vk::ImageLayout::eTransferSrcOptimal,
+                                       vk::AccessFlagBits::eShaderWrite,
+                                       vk::AccessFlagBits::eTransferRead);
+    }
+
+    commandBuffer.copyImageToBuffer(specularTexture->image,
+                                    vk::ImageLayout::eTransferSrcOptimal,
+                                    readbackBuffer,
+                                    static_cast<uint32_t>(specularRegions.size()),
+                                    specularRegions.data());
+    commandBuffer.copyImageToBuffer(brdfLutTexture->image,
+                                    vk::ImageLayout::eTransferSrcOptimal,
+                                    readbackBuffer,
+                                    1,
+                                    &brdfLutRegion);
+}
+
+void IblBaker::Update()
+{
+    if (asyncCompute->Poll()) { FinishBake(); }
+}
+
+void IblBaker::WaitIdle()
+{
+    asyncCompute->WaitIdle();
+    Update();
+}
+
+void IblBaker::FinishBake()
+{
+    vk::Device logicalDevice = createInfo.logicalDevice;
+
+    void* shData = nullptr;
+    CheckVkResult(logicalDevice.mapMemory(
+        shBufferMemory, 0, sizeof(irradianceSH), vk::MemoryMapFlags{}, &shData));
+    memcpy(irradianceSH.data(), shData, sizeof(irradianceSH));
+    logicalDevice.unmapMemory(shBufferMemory);
+
+    if (readbackBuffer)
+    {
+        IblCache::Data data;
+        data.header = pendingHeader;
+        for (uint32_t i = 0; i < IblCache::ShCoefficientsCount; ++i)
+        {
+            data.irradianceSH[i] = { irradianceSH[i].x,
+                                     irradianceSH[i].y,
+                                     irradianceSH[i].z,
+                                     irradianceSH[i].w };
+        }
+
+        const size_t brdfLutBytes = static_cast<size_t>(brdfLutTexture->width) *
+                                    brdfLutTexture->height * Rgba16fTexelSize;
+        const vk::DeviceSize readbackSize =
+            logicalDevice.getBufferMemoryRequirements(readbackBuffer).size;
+        uint8_t* readbackData = nullptr;
+        CheckVkResult(logicalDevice.mapMemory(readbackBufferMemory,
+                                              0,
+                                              readbackSize,
+                                              vk::MemoryMapFlags{},
+                                              reinterpret_cast<void**>(&readbackData)));
+        size_t specularBytes = 0;
+        for (uint32_t mip = 0; mip < specularTexture->mipLevels; ++mip)
+        {
+            const size_t mipSize = std::max(specularTexture->width >> mip, 1u);
+            specularBytes += mipSize * mipSize * specularTexture->imageLayersCount *
+                             Rgba16fTexelSize;
+        }
+        data.specular.assign(readbackData, readbackData + specularBytes);
+        data.brdfLut.assign(readbackData + specularBytes,
+                            readbackData + specularBytes + brdfLutBytes);
+        logicalDevice.unmapMemory(readbackBufferMemory);
+
+        // the render thread doesn't wait for the disk
+        saveThread.Enqueue([cachePath = pendingCachePath, data = std::move(data)]() {
+            if (IblCache::Save(cachePath, data)) { EZLOG("ibl cache saved", cachePath); }
+        });
+    }
+
+    ReleaseDispatchResources();
+    ready = true;
+}
+
+bool IblBaker::LoadTexture(Texture& texture)
+{
+    const QueueFamilyIndices& families = createInfo.queueFamilyIndices;
+    if (families.graphicsFamily != families.computeFamily)
+    {
+        texture.SetSharingQueueFamilies({ families.graphicsFamily, families.computeFamily });
+    }
+    return texture.LoadToGpu(createInfo.logicalDevice,
+                             createInfo.physicalDevice,
+                             createInfo.graphicsQueue,
+                             createInfo.graphicsCommandPool,
+                             *createInfo.samplerCache);
+}
+
+vk::DescriptorSet IblBaker::AllocateDescriptorSet(const ComputePass& pass)
+{
+    const vk::DescriptorSetLayout setLayout = pass.pipeline->GetDescriptorSetLayout(0);
+    vk::DescriptorSetAllocateInfo descriptorSetAllocInfo{};
+    descriptorSetAllocInfo.descriptorPool = descriptorPool;
+    descriptorSetAllocInfo.pSetLayouts = &setLayout;
+    descriptorSetAllocInfo.descriptorSetCount = 1;
+    vk::DescriptorSet descriptorSet;
+    CheckVkResult(createInfo.logicalDevice.allocateDescriptorSets(&descriptorSetAllocInfo,
+                                                                  &descriptorSet));
+    return descriptorSet;
+}
+
+void IblBaker::ReleaseDispatchResources()
+{
+    vk::Device logicalDevice = createInfo.logicalDevice;
+    for (vk::ImageView mipView : mipViews) { logicalDevice.destroyImageView(mipView); }
+    mipViews.clear();
+    logicalDevice.resetDescriptorPool(descriptorPool);
+
+    logicalDevice.destroyBuffer(shBuffer);
+    logicalDevice.freeMemory(shBufferMemory);
+    logicalDevice.destroyBuffer(readbackBuffer);
+    logicalDevice.freeMemory(readbackBufferMemory);
+    shBuffer = nullptr;
+    shBufferMemory = nullptr;
+    readbackBuffer = nullptr;
+    readbackBufferMemory = nullptr;
+    pendingCachePath.clear();
+}
+
+void IblBaker::ReleaseOutputs()
+{
+    specularTexture.reset();
+    brdfLutTexture.reset();
+    ready = false;
+    loadedFromCache = false;
+}
+}  // namespace ez
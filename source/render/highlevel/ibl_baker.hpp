@@ -0,0 +1,120 @@
+#pragma once
+
+#include <array>
+#include <glm/glm.hpp>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/ibl_cache.hpp"
+#include "core/thread_pool.hpp"
+#include "render/graphics_result.hpp"
+#include "render/vulkan/utils.hpp"
+#include "render/vulkan/vulkan_async_submission.hpp"
+#include "render/vulkan/vulkan_compute_pipeline.hpp"
+#include "render/vulkan_include.hpp"
+
+namespace ez
+{
+class Texture;
+class VulkanPipelineManager;
+class VulkanSamplerCache;
+
+struct IblBakerCreateInfo
+{
+    vk::Device logicalDevice;
+    vk::PhysicalDevice physicalDevice;
+    vk::Queue graphicsQueue;
+    vk::CommandPool graphicsCommandPool;
+    vk::Queue computeQueue;
+    vk::CommandPool computeCommandPool;
+    QueueFamilyIndices queueFamilyIndices;
+    // owned by RenderSystem, must outlive the baker
+    VulkanSamplerCache* samplerCache = nullptr;
+};
+
+// Bakes image based lighting from the environment cubemap on the compute queue:
+// L2 SH irradiance, GGX prefiltered specular cubemap (roughness grows with mip) and the
+// split-sum BRDF LUT. Results are cached next to the panorama and reused while neither the
+// panorama file nor the bake settings change.
+class IblBaker
+{
+   public:
+    IblBaker(const IblBakerCreateInfo& aCreateInfo);
+    ~IblBaker();
+
+    static ResultValue<std::unique_ptr<IblBaker>> Create(
+        const IblBakerCreateInfo& createInfo,
+        VulkanPipelineManager& pipelineManager);
+
+    // envCubemap may still be generated by earlier work on the compute queue
+    bool Bake(const std::string& panoramaPath, const Texture& envCubemap);
+
+    void Update();
+    void WaitIdle();
+    bool IsBusy() const { return asyncCompute->IsBusy(); }
+    bool IsReady() const { return ready; }
+    bool IsLoadedFromCache() const { return loadedFromCache; }
+
+    vk::Semaphore TakeFinishedSemaphore() { return asyncCompute->TakeFinishedSemaphore(); }
+
+    // irradiance(n) = sum(irradianceSH[i].rgb * Y_i(n)), basis as in ibl_irradiance_sh.comp
+    const std::array<glm::vec4, IblCache::ShCoefficientsCount>& GetIrradianceSH() const
+    {
+        return irradianceSH;
+    }
+    const Texture* GetSpecularTexture() const { return specularTexture.get(); }
+    const Texture* GetBrdfLutTexture() const { return brdfLutTexture.get(); }
+
+   private:
+    struct ComputePass final
+    {
+        // its set layout is reflected from the shader
+        std::shared_ptr<VulkanComputePipeline> pipeline;
+        std::string shaderName;
+    };
+
+    bool Initialize(VulkanPipelineManager& pipelineManager);
+    bool CreatePass(VulkanPipelineManager& pipelineManager,
+                    uint32_t pushConstantsSize,
+                    const std::string& shaderName,
+                    ComputePass& pass);
+
+    uint64_t GetBakeSettingsHash() const;
+    bool LoadFromCache(IblCache::Data&& data);
+    bool Dispatch(const Texture& envCubemap);
+    void RecordReadback(vk::CommandBuffer commandBuffer);
+    void FinishBake();
+
+    bool LoadTexture(Texture& texture);
+    vk::DescriptorSet AllocateDescriptorSet(const ComputePass& pass);
+    void ReleaseDispatchResources();
+    void ReleaseOutputs();
+
+    IblBakerCreateInfo createInfo;
+    std::unique_ptr<VulkanAsyncSubmission> asyncCompute;
+
+    ComputePass irradiancePass;
+    ComputePass prefilterPass;
+    ComputePass brdfLutPass;
+    vk::DescriptorPool descriptorPool;
+
+    std::array<glm::vec4, IblCache::ShCoefficientsCount> irradianceSH{};
+    std::unique_ptr<Texture> specularTexture;
+    std::unique_ptr<Texture> brdfLutTexture;
+    bool ready = false;
+    bool loadedFromCache = false;
+
+    // alive while the bake is in flight
+    std::vector<vk::ImageView> mipViews;
+    vk::Buffer shBuffer;
+    vk::DeviceMemory shBufferMemory;
+    vk::Buffer readbackBuffer;
+    vk::DeviceMemory readbackBufferMemory;
+    IblCache::Header pendingHeader;
+    std::string pendingCachePath;
+
+    // writes baked data to the cache, saves still queued finish before the baker is gone
+    ThreadPool saveThread{ 1 };
+};
+}  // namespace ez
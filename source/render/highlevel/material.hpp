@@ -1,12 +1,15 @@
 #pragma once
 
 #include <glm/glm.hpp>
+#include <memory>
 
 #include "render/highlevel/texture.hpp"
 #include "render/vulkan_include.hpp"
 
 namespace ez
 {
+class VulkanGraphicsPipeline;
+
 enum class BlendMode
 {
     eOpaque,
@@ -20,15 +23,29 @@ enum class MaterialType
     eCubemap
 };
 
+// Material features that select code paths of one SPIR-V module through specialization
+// constants, the constant_id of a feature is its bit index, see material_features.glsl.
+// Pipelines are created per permutation, so the driver can drop the disabled paths.
+using ShaderPermutation = uint32_t;
+enum eShaderFeature : ShaderPermutation
+{
+    sfNone = 0,
+    sfAlphaMask = 1 << 0,
+    sfEmissiveMap = 1 << 1,
+    sfBaseColorUv1 = 1 << 2,
+    sfEmissiveUv1 = 1 << 3,
+};
+constexpr uint32_t ShaderFeaturesCount = 4;
+
 struct Material
 {
     struct PbrTextures
     {
-        Texture* baseColor;
-        Texture* metallicRoughness;
-        Texture* normal;
-        Texture* occlusion;
-        Texture* emission;
+        Texture* baseColor = nullptr;
+        Texture* metallicRoughness = nullptr;
+        Texture* normal = nullptr;
+        Texture* occlusion = nullptr;
+        Texture* emission = nullptr;
     } textures;
 
     struct TexCoordSets
@@ -41,12 +58,40 @@ struct Material
         uint8_t emissive = 0;
     } texCoordSets;
 
-    Texture* cubemapTexture;
+    Texture* cubemapTexture = nullptr;
+    // source of cubemapTexture, which is generated on GPU
+    Texture* panoramaTexture = nullptr;
+
+    // glTF factors, multiplied with the texture values
+    glm::vec4 baseColorFactor = glm::vec4(1.0f);
+    glm::vec3 emissiveFactor = glm::vec3(0.0f);
+    float metallicFactor = 1.0f;
+    float roughnessFactor = 1.0f;
 
     MaterialType type = MaterialType::eDefault;
     BlendMode blendMode = BlendMode::eOpaque;
     float alphaCutoff = 0.5f;
 
     vk::DescriptorSet descriptorSet;
+    // entry of the BindlessMaterials table, used instead of descriptorSet in bindless mode
+    uint32_t bindlessIndex = 0;
+
+    // model pipeline specialized for GetShaderPermutation, null while it is being created
+    std::shared_ptr<VulkanGraphicsPipeline> graphicsPipeline;
+
+    ShaderPermutation GetShaderPermutation() const
+    {
+        if (type != MaterialType::eDefault) { return sfNone; }
+
+        ShaderPermutation permutation = sfNone;
+        if (blendMode == BlendMode::eAlphaMask) { permutation |= sfAlphaMask; }
+        if (textures.emission != nullptr) { permutation |= sfEmissiveMap; }
+        if (texCoordSets.baseColor == 1) { permutation |= sfBaseColorUv1; }
+        if (textures.emission != nullptr && texCoordSets.emissive == 1)
+        {
+            permutation |= sfEmissiveUv1;
+        }
+        return permutation;
+    }
 };
 }  // namespace ez
@@ -1,7 +1,16 @@
 #include "mesh.hpp"
 
+#include <algorithm>
+#include <filesystem>
+#include <future>
+#include <optional>
+
+#include "core/cooked_texture.hpp"
 #include "core/log_assert.hpp"
+#include "core/thread_pool.hpp"
+#include "render/config.hpp"
 #include "render/graphics_result.hpp"
+#include "render/highlevel/hdr_decoder.hpp"
 #include "render/vulkan/vulkan_buffer.hpp"
 
 #define TINYGLTF_IMPLEMENTATION
@@ -12,7 +21,86 @@
 
 namespace ez
 {
-Model::Model(eType type, const std::string& filePath)
+namespace
+{
+// tinygltf image loader that only keeps the encoded bytes, images are decoded afterwards in
+// parallel instead of one by one inside LoadASCIIFromFile
+bool DeferImageDecoding(tinygltf::Image*,
+                        const int imageIndex,
+                        std::string* err,
+                        std::string*,
+                        int,
+                        int,
+                        const unsigned char* bytes,
+                        int size,
+                        void* userData)
+{
+    if (imageIndex < 0 || bytes == nullptr || size <= 0)
+    {
+        if (err != nullptr) { *err += "empty image data\n"; }
+        return false;
+    }
+
+    auto& encodedImages = *static_cast<std::vector<std::vector<uint8_t>>*>(userData);
+    const size_t index = static_cast<size_t>(imageIndex);
+    if (encodedImages.size() <= index) { encodedImages.resize(index + 1); }
+    encodedImages[index].assign(bytes, bytes + size);
+    return true;
+}
+
+// runs on a worker: prefers the ez_cook output when it was cooked from the current source
+// image, otherwise decodes the encoded bytes; the sampler is set by the caller
+std::optional<TextureCreationInfo> LoadGltfImage(const std::string& imagePath,
+                                                 const std::vector<uint8_t>& encoded)
+{
+    if (!imagePath.empty() && CookedTexture::IsUpToDate(imagePath))
+    {
+        const std::string cookedPath = CookedTexture::GetCookedPath(imagePath);
+        // only the mip tail is read now, the rest is streamed when it is seen
+        std::optional<CookedTexture::Image> cookedImage =
+            Config::TextureStreamingEnabled
+                ? CookedTexture::LoadMipTail(cookedPath, Config::TextureStreamingMipTailSize)
+                : CookedTexture::Load(cookedPath);
+        if (cookedImage.has_value())
+        {
+            TextureCreationInfo ci =
+                TextureCreationInfo::CreateFromCooked(std::move(cookedImage.value()), {});
+            if (ci.firstMip > 0) { ci.streamingSourcePath = cookedPath; }
+            return ci;
+        }
+    }
+    if (encoded.empty()) { return {}; }
+
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_uc* pixels = stbi_load_from_memory(encoded.data(),
+                                            static_cast<int>(encoded.size()),
+                                            &width,
+                                            &height,
+                                            &channels,
+                                            STBI_rgb_alpha);
+    if (pixels == nullptr)
+    {
+        EZLOG("failed to decode gltf image", imagePath, stbi_failure_reason());
+        return {};
+    }
+    std::vector<uint8_t> rgba(pixels, pixels + static_cast<size_t>(width) * height * 4);
+    stbi_image_free(pixels);
+
+    return TextureCreationInfo::CreateFromData(std::move(rgba),
+                                               static_cast<uint32_t>(width),
+                                               static_cast<uint32_t>(height),
+                                               4,
+                                               1,
+                                               true,
+                                               TextureSampler{});
+}
+}  // namespace
+
+Model::Model(eType aType, const std::string& aFilePath)
+    : type(aType)
+    , filePath(aFilePath)
 {
     name = filePath;
 
@@ -26,6 +114,8 @@ Model::Model(eType type, const std::string& filePath)
         std::string err;
         std::string warn;
 
+        std::vector<std::vector<uint8_t>> encodedImages;
+        loader.SetImageLoader(DeferImageDecoding, &encodedImages);
         bool fileLoaded = loader.LoadASCIIFromFile(&gltfModel, &err, &warn, gltfFilePath);
 
         EZASSERT(fileLoaded, "Failed to load file");
@@ -37,25 +127,73 @@ Model::Model(eType type, const std::string& filePath)
                                                                       gltfSampler.wrapS,
                                                                       gltfSampler.wrapT));
         }
-        textures.reserve(12);
-        for (tinygltf::Texture& tex : gltfModel.textures)
+        // materials keep pointers to textures, so the vector must never reallocate
+        textures.reserve(gltfModel.textures.size());
+        const std::filesystem::path gltfDirectory =
+            std::filesystem::path(gltfFilePath).parent_path();
+
+        // an image may be shared by several textures, its pixels are moved into the last one
+        std::vector<uint32_t> imageUsesLeft(gltfModel.images.size(), 0);
+        for (const tinygltf::Texture& tex : gltfModel.textures)
+        {
+            ++imageUsesLeft.at(static_cast<size_t>(tex.source));
+        }
+
+        // every used image is cooked-loaded or decoded on its own worker job
+        std::vector<std::optional<TextureCreationInfo>> images(gltfModel.images.size());
+        {
+            std::vector<std::future<std::optional<TextureCreationInfo>>> imageJobs(
+                gltfModel.images.size());
+            const uint32_t usedImagesCount = static_cast<uint32_t>(
+                std::count_if(imageUsesLeft.begin(), imageUsesLeft.end(), [](uint32_t uses) {
+                    return uses > 0;
+                }));
+            ThreadPool decodePool(
+                std::max(std::min(ThreadPool::GetDefaultThreadsCount(), usedImagesCount), 1u));
+            for (size_t i = 0; i < gltfModel.images.size(); ++i)
+            {
+                if (imageUsesLeft[i] == 0) { continue; }
+                const std::string& uri = gltfModel.images[i].uri;
+                const std::string imagePath =
+                    (uri.empty() || uri.rfind("data:", 0) == 0)
+                        ? std::string{}
+                        : (gltfDirectory / uri).string();
+                std::vector<uint8_t> encoded;
+                if (i < encodedImages.size()) { encoded = std::move(encodedImages[i]); }
+                imageJobs[i] = decodePool.Enqueue(
+                    [imagePath, encoded = std::move(encoded)]() {
+                        return LoadGltfImage(imagePath, encoded);
+                    });
+            }
+            for (size_t i = 0; i < imageJobs.size(); ++i)
+            {
+                if (imageJobs[i].valid()) { images[i] = imageJobs[i].get(); }
+            }
+        }
+
+        for (const tinygltf::Texture& tex : gltfModel.textures)
         {
             const size_t imageIndex = static_cast<size_t>(tex.source);
             const size_t samplerIndex = static_cast<size_t>(tex.sampler);
 
-            tinygltf::Image gltfImage = gltfModel.images.at(imageIndex);
             TextureSampler textureSampler =
                 (tex.sampler >= 0) ? textureSamplers.at(samplerIndex) : TextureSampler{};
 
-            TextureCreationInfo textureCI =
-                TextureCreationInfo::CreateFromData(&gltfImage.image.at(0),
-                                                    static_cast<uint32_t>(gltfImage.width),
-                                                    static_cast<uint32_t>(gltfImage.height),
-                                                    static_cast<uint32_t>(gltfImage.component),
-                                                    1,
-                                                    true,
-                                                    textureSampler);
-            textures.emplace_back(std::move(textureCI));  // textures are loaded to GPU later
+            // materials refer to textures by glTF index, a broken image still gets a texture
+            std::optional<TextureCreationInfo>& image = images.at(imageIndex);
+            if (!image.has_value())
+            {
+                constexpr uint8_t WhitePixel[4] = { 255, 255, 255, 255 };
+                image = TextureCreationInfo::CreateFromData(
+                    WhitePixel, 1, 1, 4, 1, false, TextureSampler{});
+            }
+
+            // textures are loaded to GPU later, the last user of the image takes its pixels
+            TextureCreationInfo ci;
+            if (--imageUsesLeft[imageIndex] == 0) { ci = std::move(image.value()); }
+            else { ci = image.value(); }
+            ci.textureSampler = textureSampler;
+            textures.emplace_back(std::move(ci));
         }
         LoadMaterials(gltfModel);
 
@@ -63,6 +201,7 @@ Model::Model(eType type, const std::string& filePath)
         vertices = {};
         vertexShaderName = "../source/shaders/shader.vert";
         fragmentShaderName = "../source/shaders/shader.frag";
+        bindlessFragmentShaderName = "../source/shaders/shader_bindless.frag";
         vertexLayout = eVertexLayout::vlPosition | eVertexLayout::vlNormal |
                        eVertexLayout::vlTexcoord0 | eVertexLayout::vlTexcoord1;
 
@@ -81,55 +220,43 @@ Model::Model(eType type, const std::string& filePath)
         // tex1 - cubemap
         const std::string hdrPanoramaFilePath = filePath;
         EZLOG("loading hdr panorama file", hdrPanoramaFilePath);
-        StbImageLoader::StbImageWrapper hdrPanoramaWrapper =
-            StbImageLoader::LoadHDRImage(hdrPanoramaFilePath.c_str());
+        // wraps around horizontally only, poles must not blend with each other
         TextureSampler panoramaTexSampler = {};
-        TextureCreationInfo panoramaTexCI = TextureCreationInfo::CreateHdrFromData(
-            hdrPanoramaWrapper.hdrData,
-            static_cast<uint32_t>(hdrPanoramaWrapper.width),
-            static_cast<uint32_t>(hdrPanoramaWrapper.height),
-            static_cast<uint32_t>(hdrPanoramaWrapper.channelsCount),
-            panoramaTexSampler);
-        textures.emplace_back(std::move(panoramaTexCI));
-
-        uint32_t cubemapWidth = 512;
-        uint32_t cubemapHeight = 512;
-        const uint32_t cubemapColorChannelsCount = 4;
-        uint32_t singleFaceSize = cubemapWidth * cubemapWidth * cubemapColorChannelsCount;
-
-        const uint32_t cubemapImageLayersCount = 6;
-
-        std::array<std::array<uint8_t, cubemapColorChannelsCount>, cubemapImageLayersCount>
-            faceColors;
-        faceColors[0] = { 255, 0, 0, 255 };
-        faceColors[1] = { 128, 0, 0, 255 };
-        faceColors[2] = { 0, 255, 0, 255 };
-        faceColors[3] = { 0, 128, 0, 255 };
-        faceColors[4] = { 0, 0, 255, 255 };
-        faceColors[5] = { 0, 0, 128, 255 };
-
-        std::vector<uint8_t> cubemapData;
-        cubemapData.resize(singleFaceSize * cubemapImageLayersCount);
-        for (uint32_t face = 0; face < cubemapImageLayersCount; ++face)
+        panoramaTexSampler.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+
+        // stb_image is kept for the layouts the parallel decoder doesn't handle
+        std::optional<HdrDecoder::Image> hdrPanorama =
+            HdrDecoder::LoadRgbaHalf(hdrPanoramaFilePath);
+        if (hdrPanorama.has_value())
         {
-            for (uint32_t i = 0; i < singleFaceSize; i += cubemapColorChannelsCount)
-            {
-                cubemapData[face * singleFaceSize + i + 0] = faceColors[face][0];
-                cubemapData[face * singleFaceSize + i + 1] = faceColors[face][1];
-                cubemapData[face * singleFaceSize + i + 2] = faceColors[face][2];
-                cubemapData[face * singleFaceSize + i + 3] = faceColors[face][3];
-            }
+            textures.emplace_back(TextureCreationInfo::CreateHdrFromHalf(
+                std::move(hdrPanorama->rgbaHalf),
+                hdrPanorama->width,
+                hdrPanorama->height,
+                panoramaTexSampler));
+        }
+        else
+        {
+            StbImageLoader::StbImageWrapper hdrPanoramaWrapper =
+                StbImageLoader::LoadHDRImage(hdrPanoramaFilePath.c_str());
+            textures.emplace_back(TextureCreationInfo::CreateHdrFromData(
+                hdrPanoramaWrapper.hdrData,
+                static_cast<uint32_t>(hdrPanoramaWrapper.width),
+                static_cast<uint32_t>(hdrPanoramaWrapper.height),
+                static_cast<uint32_t>(hdrPanoramaWrapper.channelsCount),
+                panoramaTexSampler));
         }
 
+        // filled from the panorama by EnvCubemapGenerator after upload
         TextureSampler cubemapTexSampler = {};
         TextureCreationInfo cubemapTexCI =
-            TextureCreationInfo::CreateFromData(cubemapData.data(),
-                                                cubemapWidth,
-                                                cubemapHeight,
-                                                cubemapColorChannelsCount,
-                                                cubemapImageLayersCount,
-                                                false,
-                                                cubemapTexSampler);
+            TextureCreationInfo::CreateGpuOnly(vk::Format::eR16G16B16A16Sfloat,
+                                               Config::EnvCubemapSize,
+                                               Config::EnvCubemapSize,
+                                               6,
+                                               true,
+                                               vk::ImageUsageFlagBits::eStorage,
+                                               cubemapTexSampler);
         cubemapTexCI.SetIsCubemap(true);
         textures.emplace_back(std::move(cubemapTexCI));
 
@@ -159,6 +286,7 @@ Model::Model(eType type, const std::string& filePath)
         materials.emplace_back();
         Material& cubemapMat = materials.back();
         cubemapMat.type = MaterialType::eCubemap;
+        cubemapMat.panoramaTexture = &textures[0];
         cubemapMat.cubemapTexture = &textures[1];
 
         std::unique_ptr<Node> envCubemapNode = std::make_unique<Node>();
@@ -449,6 +577,25 @@ void Model::LoadMaterials(tinygltf::Model& gltfModel)
             material.texCoordSets.occlusion =
                 mat.additionalValues["occlusionTexture"].TextureTexCoord();
         }
+        if (mat.values.find("baseColorFactor") != mat.values.end())
+        {
+            material.baseColorFactor =
+                glm::vec4(glm::make_vec4(mat.values["baseColorFactor"].ColorFactor().data()));
+        }
+        if (mat.values.find("metallicFactor") != mat.values.end())
+        {
+            material.metallicFactor = static_cast<float>(mat.values["metallicFactor"].Factor());
+        }
+        if (mat.values.find("roughnessFactor") != mat.values.end())
+        {
+            material.roughnessFactor =
+                static_cast<float>(mat.values["roughnessFactor"].Factor());
+        }
+        if (mat.additionalValues.find("emissiveFactor") != mat.additionalValues.end())
+        {
+            material.emissiveFactor = glm::vec3(
+                glm::make_vec3(mat.additionalValues["emissiveFactor"].ColorFactor().data()));
+        }
         if (mat.additionalValues.find("alphaMode") != mat.additionalValues.end())
         {
             tinygltf::Parameter param = mat.additionalValues["alphaMode"];
@@ -459,6 +606,11 @@ void Model::LoadMaterials(tinygltf::Model& gltfModel)
                 material.blendMode = BlendMode::eAlphaMask;
             }
         }
+        if (mat.additionalValues.find("alphaCutoff") != mat.additionalValues.end())
+        {
+            material.alphaCutoff =
+                static_cast<float>(mat.additionalValues["alphaCutoff"].Factor());
+        }
         materials.push_back(material);
     }
     materials.push_back(Material{});  // default
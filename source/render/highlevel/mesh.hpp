@@ -35,6 +35,9 @@ struct Mesh
         glm::mat4 modelMatrix = glm::mat4(1.0f);
     } pushConstantsBlock;
     static constexpr uint32_t PushConstantsBlockSize = sizeof(Mesh::PushConstantsBlock);
+    // bindless material table index, pushed per primitive for the fragment stage
+    static constexpr uint32_t MaterialIndexPushConstantOffset = PushConstantsBlockSize;
+    static constexpr uint32_t MaterialIndexPushConstantSize = sizeof(uint32_t);
 
     Mesh(const glm::mat4& matrix) { this->pushConstantsBlock.modelMatrix = matrix; }
 
@@ -46,6 +49,10 @@ struct Mesh
     }
 };
 
+// the push constant ranges are reflected from the shaders, 128 bytes are guaranteed by Vulkan
+static_assert(Mesh::MaterialIndexPushConstantOffset + Mesh::MaterialIndexPushConstantSize <=
+              128);
+
 struct Node
 {
     Node* parent = nullptr;
@@ -108,6 +115,8 @@ struct Model
                              vk::Queue graphicsQueue,
                              vk::CommandPool graphicsCommandPool);
     VertexLayout GetVertexLayout() const { return vertexLayout; }
+    eType GetType() const { return type; }
+    const std::string& GetFilePath() const { return filePath; }
 
     std::string name;
     std::vector<std::unique_ptr<Node>> nodes;
@@ -115,8 +124,6 @@ struct Model
     vk::Buffer vertexBuffer;
     vk::Buffer indexBuffer;
 
-    std::shared_ptr<VulkanGraphicsPipeline> graphicsPipeline;
-
     std::vector<TextureSampler> textureSamplers;
     std::vector<Texture> textures;
     std::vector<Material> materials;
@@ -124,6 +131,8 @@ struct Model
     // todo: move to Material
     std::string vertexShaderName;
     std::string fragmentShaderName;
+    // replaces fragmentShaderName with BindlessMaterials, empty if the model doesn't support it
+    std::string bindlessFragmentShaderName;
 
    private:
     void LoadNodeFromGLTF(Node* parent,
@@ -146,6 +155,7 @@ struct Model
     vk::DeviceMemory indexBufferMemory;
 
     eType type;
+    std::string filePath;
 };
 
 namespace StbImageLoader
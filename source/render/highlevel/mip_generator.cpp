@@ -0,0 +1,333 @@
+#include "mip_generator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <vector>
+
+#include "core/log_assert.hpp"
+#include "render/highlevel/texture_sampler.hpp"
+#include "render/vulkan/vulkan_buffer.hpp"
+#include "render/vulkan/vulkan_command_buffer.hpp"
+#include "render/vulkan/vulkan_image.hpp"
+#include "render/vulkan/vulkan_pipeline_manager.hpp"
+#include "render/vulkan/vulkan_sampler_cache.hpp"
+
+namespace ez
+{
+namespace
+{
+struct PushConstants final
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t mipLevels;
+    uint32_t workGroupsPerLayer;
+};
+
+// mip 0 texels covered by one workgroup along each axis
+constexpr uint32_t WorkGroupTileSize = 64;
+constexpr uint32_t MidMipMaxSize = 64;
+
+constexpr uint32_t SourceBinding = 0;
+constexpr uint32_t MidMipBinding = 1;
+constexpr uint32_t CountersBinding = 2;
+constexpr uint32_t FirstMipBinding = 3;
+}  // namespace
+
+MipGenerator::MipGenerator(vk::Device aLogicalDevice, vk::PhysicalDevice aPhysicalDevice)
+    : logicalDevice(aLogicalDevice), physicalDevice(aPhysicalDevice)
+{
+}
+
+MipGenerator::~MipGenerator()
+{
+    pipelines.clear();
+    logicalDevice.destroyBuffer(midMipBuffer);
+    logicalDevice.freeMemory(midMipBufferMemory);
+    logicalDevice.destroyBuffer(countersBuffer);
+    logicalDevice.freeMemory(countersBufferMemory);
+    logicalDevice.destroyDescriptorPool(descriptorPool);
+}
+
+ResultValue<std::unique_ptr<MipGenerator>> MipGenerator::Create(
+    vk::Device logicalDevice,
+    vk::PhysicalDevice physicalDevice,
+    VulkanPipelineManager& pipelineManager,
+    VulkanSamplerCache& samplerCache)
+{
+    auto mipGenerator = std::make_unique<MipGenerator>(logicalDevice, physicalDevice);
+    if (!mipGenerator->Initialize(pipelineManager, samplerCache))
+    {
+        EZLOG("Failed to create MipGenerator");
+        return GraphicsResult::Error;
+    }
+    return { GraphicsResult::Ok, std::move(mipGenerator) };
+}
+
+bool MipGenerator::Initialize(VulkanPipelineManager& pipelineManager,
+                              VulkanSamplerCache& samplerCache)
+{
+    // one set, images are processed one by one
+    const std::vector<vk::DescriptorPoolSize> poolSizes = {
+        { vk::DescriptorType::eCombinedImageSampler, 1 },
+        { vk::DescriptorType::eStorageBuffer, 2 },
+        { vk::DescriptorType::eStorageImage, MaxMipLevels - 1 },
+    };
+    vk::DescriptorPoolCreateInfo poolCI{};
+    poolCI.maxSets = 1;
+    poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCI.pPoolSizes = poolSizes.data();
+    if (logicalDevice.createDescriptorPool(&poolCI, nullptr, &descriptorPool) !=
+        vk::Result::eSuccess)
+    {
+        return false;
+    }
+
+    TextureSampler textureSampler;
+    textureSampler.addressModeU = vk::SamplerAddressMode::eClampToEdge;
+    textureSampler.addressModeV = vk::SamplerAddressMode::eClampToEdge;
+    textureSampler.addressModeW = vk::SamplerAddressMode::eClampToEdge;
+    textureSampler.mipmapMode = vk::SamplerMipmapMode::eNearest;
+    textureSampler.maxAnisotropy = 1.0f;
+    sampler = samplerCache.GetSampler(textureSampler);
+    if (!sampler) { return false; }
+
+    const vk::DeviceSize midMipSize =
+        sizeof(float) * 4 * MidMipMaxSize * MidMipMaxSize * MaxLayersCount;
+    const vk::DeviceSize countersSize = sizeof(uint32_t) * MaxLayersCount;
+    if (!VulkanBuffer::createBuffer(logicalDevice,
+                                    physicalDevice,
+                                    midMipSize,
+                                    vk::BufferUsageFlagBits::eStorageBuffer,
+                                    vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                    midMipBuffer,
+                                    midMipBufferMemory) ||
+        !VulkanBuffer::createBuffer(logicalDevice,
+                                    physicalDevice,
+                                    countersSize,
+                                    vk::BufferUsageFlagBits::eStorageBuffer |
+                                        vk::BufferUsageFlagBits::eTransferDst,
+                                    vk::MemoryPropertyFlagBits::eDeviceLocal,
+                                    countersBuffer,
+                                    countersBufferMemory))
+    {
+        return false;
+    }
+
+    // storage image writes need the format in the shader, one variant per supported format
+    const std::array<std::pair<vk::Format, const char*>, 2> shaderVariants = { {
+        { vk::Format::eR8G8B8A8Unorm, "../source/shaders/spd_downsample_rgba8.comp" },
+        { vk::Format::eR16G16B16A16Sfloat, "../source/shaders/spd_downsample_rgba16f.comp" },
+    } };
+    // variants are compiled in parallel
+    std::vector<std::pair<vk::Format, VulkanPipelineManager::ComputePipelineFuture>> variants;
+    for (const auto& [format, shaderName] : shaderVariants)
+    {
+        variants.emplace_back(format,
+                              pipelineManager.CreateComputePipelineAsync(sizeof(PushConstants),
+                                                                         shaderName));
+    }
+    for (const auto& [format, pipeline] : variants)
+    {
+        if (!pipeline.get())
+        {
+            EZLOG("Failed to create mip generation pipeline");
+            return false;
+        }
+        pipelines.emplace(format, pipeline.get());
+    }
+    return true;
+}
+
+bool MipGenerator::IsSupported(vk::Format format,
+                               uint32_t width,
+                               uint32_t height,
+                               uint32_t layersCount) const
+{
+    if (pipelines.find(format) == pipelines.end()) { return false; }
+    if (std::max(width, height) > WorkGroupTileSize * MidMipMaxSize ||
+        layersCount > MaxLayersCount)
+    {
+        return false;
+    }
+
+    const vk::FormatFeatureFlags requiredFeatures =
+        vk::FormatFeatureFlagBits::eStorageImage |
+        vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    const vk::FormatProperties formatProperties = physicalDevice.getFormatProperties(format);
+    return (formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
+
+bool MipGenerator::Generate(vk::Queue queue,
+                            vk::CommandPool commandPool,
+                            vk::Image image,
+                            vk::Format format,
+                            uint32_t width,
+                            uint32_t height,
+                            uint32_t layersCount,
+                            uint32_t mipLevels)
+{
+    if (!IsSupported(format, width, height, layersCount) || mipLevels < 2 ||
+        mipLevels > MaxMipLevels)
+    {
+        EZASSERT(false, "Can't generate mips on GPU for the image", vk::to_string(format));
+        return false;
+    }
+    const VulkanComputePipeline& pipeline = *pipelines.at(format);
+
+    // 2D array views serve 2D images and cubemaps alike
+    auto createView = [&](uint32_t mip, vk::ImageView& view) {
+        vk::ImageViewCreateInfo viewCI{};
+        viewCI.image = image;
+        viewCI.viewType = vk::ImageViewType::e2DArray;
+        viewCI.format = format;
+        viewCI.subresourceRange.aspectMask = vk::ImageAspectFlagBits::eColor;
+        viewCI.subresourceRange.baseMipLevel = mip;
+        viewCI.subresourceRange.levelCount = 1;
+        viewCI.subresourceRange.baseArrayLayer = 0;
+        viewCI.subresourceRange.layerCount = layersCount;
+        return logicalDevice.createImageView(&viewCI, nullptr, &view) == vk::Result::eSuccess;
+    };
+    std::vector<vk::ImageView> mipViews(mipLevels);
+    bool viewsCreated = true;
+    for (uint32_t mip = 0; mip < mipLevels; ++mip)
+    {
+        viewsCreated = viewsCreated && createView(mip, mipViews[mip]);
+    }
+    auto destroyViews = [&]() {
+        for (vk::ImageView mipView : mipViews) { logicalDevice.destroyImageView(mipView); }
+    };
+    if (!viewsCreated)
+    {
+        destroyViews();
+        return false;
+    }
+
+    const vk::DescriptorSetLayout setLayout = pipeline.GetDescriptorSetLayout(0);
+    vk::DescriptorSetAllocateInfo descriptorSetAllocInfo{};
+    descriptorSetAllocInfo.descriptorPool = descriptorPool;
+    descriptorSetAllocInfo.descriptorSetCount = 1;
+    descriptorSetAllocInfo.pSetLayouts = &setLayout;
+    vk::DescriptorSet descriptorSet;
+    CheckVkResult(
+        logicalDevice.allocateDescriptorSets(&descriptorSetAllocInfo, &descriptorSet));
+
+    const vk::DescriptorImageInfo sourceInfo{ sampler,
+                                              mipViews[0],
+                                              vk::ImageLayout::eShaderReadOnlyOptimal };
+    const vk::DescriptorBufferInfo midMipInfo{ midMipBuffer, 0, VK_WHOLE_SIZE };
+    const vk::DescriptorBufferInfo countersInfo{ countersBuffer, 0, VK_WHOLE_SIZE };
+    // bindings past the last mip are never written by the shader but must stay valid
+    std::array<vk::DescriptorImageInfo, MaxMipLevels - 1> storageImageInfos;
+    for (uint32_t mip = 1; mip < MaxMipLevels; ++mip)
+    {
+        storageImageInfos[mip - 1].imageView = mipViews[std::min(mip, mipLevels - 1)];
+        storageImageInfos[mip - 1].imageLayout = vk::ImageLayout::eGeneral;
+    }
+
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets(3);
+    writeDescriptorSets[0].dstSet = descriptorSet;
+    writeDescriptorSets[0].dstBinding = SourceBinding;
+    writeDescriptorSets[0].descriptorType = vk::DescriptorType::eCombinedImageSampler;
+    writeDescriptorSets[0].descriptorCount = 1;
+    writeDescriptorSets[0].pImageInfo = &sourceInfo;
+    writeDescriptorSets[1].dstSet = descriptorSet;
+    writeDescriptorSets[1].dstBinding = MidMipBinding;
+    writeDescriptorSets[1].descriptorType = vk::DescriptorType::eStorageBuffer;
+    writeDescriptorSets[1].descriptorCount = 1;
+    writeDescriptorSets[1].pBufferInfo = &midMipInfo;
+    writeDescriptorSets[2].dstSet = descriptorSet;
+    writeDescriptorSets[2].dstBinding = CountersBinding;
+    writeDescriptorSets[2].descriptorType = vk::DescriptorType::eStorageBuffer;
+    writeDescriptorSets[2].descriptorCount = 1;
+    writeDescriptorSets[2].pBufferInfo = &countersInfo;
+    for (uint32_t mip = 1; mip < MaxMipLevels; ++mip)
+    {
+        vk::WriteDescriptorSet& write = writeDescriptorSets.emplace_back();
+        write.dstSet = descriptorSet;
+        write.dstBinding = FirstMipBinding + mip - 1;
+        write.descriptorType = vk::DescriptorType::eStorageImage;
+        write.descriptorCount = 1;
+        write.pImageInfo = &storageImageInfos[mip - 1];
+    }
+    logicalDevice.updateDescriptorSets(static_cast<uint32_t>(writeDescriptorSets.size()),
+                                       writeDescriptorSets.data(),
+                                       0,
+                                       nullptr);
+
+    VulkanOneTimeCommandBuffer oneTimeCB =
+        VulkanOneTimeCommandBuffer::Start(logicalDevice, commandPool);
+    vk::CommandBuffer commandBuffer = oneTimeCB.GetCommandBuffer();
+
+    commandBuffer.fillBuffer(countersBuffer, 0, VK_WHOLE_SIZE, 0);
+    vk::BufferMemoryBarrier countersBarrier{};
+    countersBarrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    countersBarrier.dstAccessMask =
+        vk::AccessFlagBits::eShaderRead | vk::AccessFlagBits::eShaderWrite;
+    countersBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    countersBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    countersBarrier.buffer = countersBuffer;
+    countersBarrier.offset = 0;
+    countersBarrier.size = VK_WHOLE_SIZE;
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eComputeShader,
+                                  vk::DependencyFlags{},
+                                  {},
+                                  { countersBarrier },
+                                  {});
+
+    vk::ImageSubresourceRange mipsRange = {};
+    mipsRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
+    mipsRange.setBaseMipLevel(1);
+    mipsRange.setLevelCount(mipLevels - 1);
+    mipsRange.setLayerCount(layersCount);
+
+    Image::SubmitChangeImageLayout(commandBuffer,
+                                   vk::PipelineStageFlagBits::eTopOfPipe,
+                                   vk::PipelineStageFlagBits::eComputeShader,
+                                   image,
+                                   mipsRange,
+                                   vk::ImageLayout::eUndefined,
+                                   vk::ImageLayout::eGeneral,
+                                   vk::AccessFlags{},
+                                   vk::AccessFlagBits::eShaderWrite);
+
+    PushConstants pushConstants;
+    pushConstants.width = width;
+    pushConstants.height = height;
+    pushConstants.mipLevels = mipLevels;
+    const uint32_t groupsX = (width + WorkGroupTileSize - 1) / WorkGroupTileSize;
+    const uint32_t groupsY = (height + WorkGroupTileSize - 1) / WorkGroupTileSize;
+    pushConstants.workGroupsPerLayer = groupsX * groupsY;
+
+    commandBuffer.bindPipeline(vk::PipelineBindPoint::eCompute, pipeline.GetPipeline());
+    commandBuffer.bindDescriptorSets(vk::PipelineBindPoint::eCompute,
+                                     pipeline.GetPipelineLayout(),
+                                     0,
+                                     { descriptorSet },
+                                     {});
+    commandBuffer.pushConstants(pipeline.GetPipelineLayout(),
+                                vk::ShaderStageFlagBits::eCompute,
+                                0,
+                                sizeof(PushConstants),
+                                &pushConstants);
+    commandBuffer.dispatch(groupsX, groupsY, layersCount);
+
+    Image::SubmitChangeImageLayout(commandBuffer,
+                                   vk::PipelineStageFlagBits::eComputeShader,
+                                   vk::PipelineStageFlagBits::eFragmentShader |
+                                       vk::PipelineStageFlagBits::eComputeShader,
+                                   image,
+                                   mipsRange,
+                                   vk::ImageLayout::eGeneral,
+                                   vk::ImageLayout::eShaderReadOnlyOptimal,
+                                   vk::AccessFlagBits::eShaderWrite,
+                                   vk::AccessFlagBits::eShaderRead);
+
+    oneTimeCB.EndSubmitAndWait(queue);
+
+    destroyViews();
+    logicalDevice.resetDescriptorPool(descriptorPool);
+    return true;
+}
+}  // namespace ez
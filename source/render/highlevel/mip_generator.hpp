@@ -0,0 +1,66 @@
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+
+#include "render/graphics_result.hpp"
+#include "render/vulkan/vulkan_compute_pipeline.hpp"
+#include "render/vulkan_include.hpp"
+
+namespace ez
+{
+class VulkanPipelineManager;
+class VulkanSamplerCache;
+
+// Generates the whole mip chain of all image layers with a single compute dispatch (see
+// shaders/spd_downsample.glsl). Unlike blits it doesn't need blittable formats, only storage
+// image support for the destination format.
+class MipGenerator
+{
+   public:
+    MipGenerator(vk::Device aLogicalDevice, vk::PhysicalDevice aPhysicalDevice);
+    ~MipGenerator();
+
+    static ResultValue<std::unique_ptr<MipGenerator>> Create(
+        vk::Device logicalDevice,
+        vk::PhysicalDevice physicalDevice,
+        VulkanPipelineManager& pipelineManager,
+        VulkanSamplerCache& samplerCache);
+
+    // images have to be created with storage usage to be passed to Generate
+    bool IsSupported(vk::Format format,
+                     uint32_t width,
+                     uint32_t height,
+                     uint32_t layersCount) const;
+
+    // mip 0 of all layers must be in eShaderReadOnlyOptimal, the other mips are discarded;
+    // the whole image ends in eShaderReadOnlyOptimal, waits for the queue to finish
+    bool Generate(vk::Queue queue,
+                  vk::CommandPool commandPool,
+                  vk::Image image,
+                  vk::Format format,
+                  uint32_t width,
+                  uint32_t height,
+                  uint32_t layersCount,
+                  uint32_t mipLevels);
+
+   private:
+    // mip 0 of up to 4096x4096 is reduced to a 64x64 mip 6 by the tiles, then to 1x1
+    static constexpr uint32_t MaxMipLevels = 13;
+    static constexpr uint32_t MaxLayersCount = 6;
+
+    bool Initialize(VulkanPipelineManager& pipelineManager, VulkanSamplerCache& samplerCache);
+
+    vk::Device logicalDevice;
+    vk::PhysicalDevice physicalDevice;
+
+    vk::DescriptorPool descriptorPool;
+    vk::Sampler sampler;
+    std::unordered_map<vk::Format, std::shared_ptr<VulkanComputePipeline>> pipelines;
+
+    vk::Buffer midMipBuffer;
+    vk::DeviceMemory midMipBufferMemory;
+    vk::Buffer countersBuffer;
+    vk::DeviceMemory countersBufferMemory;
+};
+}  // namespace ez
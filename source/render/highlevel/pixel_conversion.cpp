@@ -0,0 +1,504 @@
+#include "pixel_conversion.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EZ_PIXEL_CONVERSION_SSE 1
+#include <emmintrin.h>
+#include <immintrin.h>
+#include <tmmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#endif
+
+namespace ez::PixelConversion
+{
+namespace
+{
+constexpr uint8_t OpaqueAlpha8 = 255;
+constexpr float OpaqueAlpha32F = 1.0f;
+
+void ExpandRgbToRgbaScalar(const uint8_t* src, uint8_t* dst, size_t pixelsCount)
+{
+    for (size_t i = 0; i < pixelsCount; ++i)
+    {
+        dst[0] = src[0];
+        dst[1] = src[1];
+        dst[2] = src[2];
+        dst[3] = OpaqueAlpha8;
+        src += 3;
+        dst += 4;
+    }
+}
+
+constexpr size_t HalfConversionChunkPixelsCount = 256;
+
+// round-to-nearest-even float -> IEEE half, overflow goes to infinity
+uint16_t FloatToHalfScalar(float value)
+{
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t absBits = bits & 0x7FFFFFFFu;
+    if (absBits >= 0x7F800000u)
+    {
+        // inf or nan, keep nan quiet
+        return static_cast<uint16_t>(sign | 0x7C00u | (absBits > 0x7F800000u ? 0x200u : 0u));
+    }
+    if (absBits >= 0x477FF000u) { return static_cast<uint16_t>(sign | 0x7C00u); }
+    if (absBits < 0x38800000u)
+    {
+        // half denormal or zero
+        if (absBits < 0x33000000u) { return static_cast<uint16_t>(sign); }
+        const uint32_t exponent = absBits >> 23;
+        const uint32_t mantissa = (absBits & 0x7FFFFFu) | 0x800000u;
+        const uint32_t shift = 126 - exponent;
+        uint32_t half = mantissa >> shift;
+        const uint32_t remainder = mantissa & ((1u << shift) - 1);
+        const uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1u))) { ++half; }
+        return static_cast<uint16_t>(sign | half);
+    }
+
+    uint32_t half = (absBits - 0x38000000u) >> 13;
+    const uint32_t remainder = absBits & 0x1FFFu;
+    if (remainder > 0x1000u || (remainder == 0x1000u && (half & 1u))) { ++half; }
+    return static_cast<uint16_t>(sign | half);
+}
+
+void ConvertFloatToHalfScalar(const float* src, uint16_t* dst, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) { dst[i] = FloatToHalfScalar(src[i]); }
+}
+
+// Radiance mantissas are scaled by 2^(e - 128 - 8), same as stb_image. Exponents below
+// RgbeMinExponent give values under the smallest half denormal and are flushed to 0.
+constexpr int RgbeExponentBias = 128 + 8;
+constexpr int RgbeMinExponent = 10;
+
+void RgbeToRgbaScalar(const uint8_t* src, float* dst, size_t pixelsCount)
+{
+    for (size_t i = 0; i < pixelsCount; ++i)
+    {
+        const int exponent = src[3];
+        const float scale =
+            exponent >= RgbeMinExponent ? std::ldexp(1.0f, exponent - RgbeExponentBias) : 0.0f;
+        dst[0] = src[0] * scale;
+        dst[1] = src[1] * scale;
+        dst[2] = src[2] * scale;
+        dst[3] = OpaqueAlpha32F;
+        src += 4;
+        dst += 4;
+    }
+}
+
+// Half and the 11/10-bit floats share the exponent bias, so packing only drops mantissa bits
+// (rounded to nearest) and the sign. Negative values and nans become 0.
+uint32_t HalfToSmallFloat(uint16_t half, uint32_t droppedBitsCount, uint32_t maxFinite)
+{
+    if ((half & 0x8000u) != 0) { return 0; }
+    const uint32_t exponent = (half >> 10) & 0x1Fu;
+    if (exponent == 0x1Fu)
+    {
+        // inf stays inf, nan has no unsigned representation worth keeping
+        return (half & 0x3FFu) != 0 ? 0 : (0x1Fu << (10 - droppedBitsCount));
+    }
+
+    const uint32_t rounded = (half + (1u << (droppedBitsCount - 1))) >> droppedBitsCount;
+    return std::min(rounded, maxFinite);
+}
+
+#ifdef EZ_PIXEL_CONVERSION_SSE
+uint32_t GetCpuFeatureFlags()
+{
+#ifdef _MSC_VER
+    int cpuInfo[4];
+    __cpuid(cpuInfo, 1);
+    return static_cast<uint32_t>(cpuInfo[2]);
+#else
+    uint32_t eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx)) { return 0; }
+    return ecx;
+#endif
+}
+
+bool IsSsse3Supported() { return (GetCpuFeatureFlags() & (1u << 9)) != 0; }
+
+// F16C is VEX encoded, so the OS has to save AVX state as well
+bool IsF16cSupported()
+{
+    constexpr uint32_t OsXsaveBit = 1u << 27;
+    constexpr uint32_t AvxBit = 1u << 28;
+    constexpr uint32_t F16cBit = 1u << 29;
+    const uint32_t flags = GetCpuFeatureFlags();
+    if ((flags & (OsXsaveBit | AvxBit | F16cBit)) != (OsXsaveBit | AvxBit | F16cBit))
+    {
+        return false;
+    }
+#ifdef _MSC_VER
+    const uint64_t xcr0 = _xgetbv(0);
+#else
+    uint32_t xcr0Low, xcr0High;
+    __asm__("xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0));
+    const uint64_t xcr0 = (static_cast<uint64_t>(xcr0High) << 32) | xcr0Low;
+#endif
+    constexpr uint64_t SseAndAvxState = 0x6;
+    return (xcr0 & SseAndAvxState) == SseAndAvxState;
+}
+
+#ifndef _MSC_VER
+__attribute__((target("f16c")))
+#endif
+size_t ConvertFloatToHalfF16c(const float* src, uint16_t* dst, size_t count)
+{
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        const __m128i low = _mm_cvtps_ph(_mm_loadu_ps(src + i), _MM_FROUND_TO_NEAREST_INT);
+        const __m128i high = _mm_cvtps_ph(_mm_loadu_ps(src + i + 4), _MM_FROUND_TO_NEAREST_INT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_unpacklo_epi64(low, high));
+    }
+    return i;
+}
+
+// the scale is built directly as float bits: biased exponent e - 136 + 127 with 0 mantissa
+size_t RgbeToRgbaSse2(const uint8_t* src, float* dst, size_t pixelsCount)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i exponentOffset = _mm_set1_epi32(RgbeExponentBias - 127);
+    const __m128i minExponent = _mm_set1_epi32(RgbeMinExponent - 1);
+    const __m128 rgbMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    const __m128 alpha = _mm_setr_ps(0.0f, 0.0f, 0.0f, OpaqueAlpha32F);
+
+    const auto expandPixel = [&](__m128i rgbe, float* out) {
+        const __m128i exponent = _mm_shuffle_epi32(rgbe, _MM_SHUFFLE(3, 3, 3, 3));
+        const __m128i scaleBits =
+            _mm_slli_epi32(_mm_sub_epi32(exponent, exponentOffset), 23);
+        const __m128 scale = _mm_castsi128_ps(
+            _mm_and_si128(scaleBits, _mm_cmpgt_epi32(exponent, minExponent)));
+        const __m128 rgb = _mm_mul_ps(_mm_cvtepi32_ps(rgbe), scale);
+        _mm_storeu_ps(out, _mm_or_ps(_mm_and_ps(rgb, rgbMask), alpha));
+    };
+
+    size_t i = 0;
+    for (; i + 4 <= pixelsCount; i += 4)
+    {
+        const __m128i pixels = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4));
+        const __m128i low = _mm_unpacklo_epi8(pixels, zero);
+        const __m128i high = _mm_unpackhi_epi8(pixels, zero);
+        float* out = dst + i * 4;
+        expandPixel(_mm_unpacklo_epi16(low, zero), out + 0);
+        expandPixel(_mm_unpackhi_epi16(low, zero), out + 4);
+        expandPixel(_mm_unpacklo_epi16(high, zero), out + 8);
+        expandPixel(_mm_unpackhi_epi16(high, zero), out + 12);
+    }
+    return i;
+}
+
+#ifndef _MSC_VER
+__attribute__((target("ssse3")))
+#endif
+size_t ExpandRgbToRgbaSsse3(const uint8_t* src, uint8_t* dst, size_t pixelsCount)
+{
+    const __m128i shuffle =
+        _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+    const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xFF000000u));
+
+    // every 16-byte load consumes 4 pixels (12 bytes), stop before a load gets out of bounds
+    size_t i = 0;
+    for (; i + 6 <= pixelsCount; i += 4)
+    {
+        const __m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 3));
+        const __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i * 4), rgba);
+    }
+    return i;
+}
+#endif
+constexpr uint32_t BlockDim = 4;
+
+// 4 RGBA8 colors of a BC1-style color block; threeColorMode is only allowed for BC1
+void DecodeColorBlockPalette(const uint8_t* block, bool allowThreeColorMode, uint8_t* palette)
+{
+    const uint16_t c0 = static_cast<uint16_t>(block[0] | (block[1] << 8));
+    const uint16_t c1 = static_cast<uint16_t>(block[2] | (block[3] << 8));
+    const auto expand565 = [](uint16_t c, uint8_t* rgba) {
+        const uint32_t r = (c >> 11) & 0x1F;
+        const uint32_t g = (c >> 5) & 0x3F;
+        const uint32_t b = c & 0x1F;
+        rgba[0] = static_cast<uint8_t>((r << 3) | (r >> 2));
+        rgba[1] = static_cast<uint8_t>((g << 2) | (g >> 4));
+        rgba[2] = static_cast<uint8_t>((b << 3) | (b >> 2));
+        rgba[3] = OpaqueAlpha8;
+    };
+    expand565(c0, palette);
+    expand565(c1, palette + 4);
+
+    const bool fourColors = !allowThreeColorMode || c0 > c1;
+    for (uint32_t channel = 0; channel < 3; ++channel)
+    {
+        const uint32_t a = palette[channel];
+        const uint32_t b = palette[4 + channel];
+        if (fourColors)
+        {
+            palette[8 + channel] = static_cast<uint8_t>((2 * a + b + 1) / 3);
+            palette[12 + channel] = static_cast<uint8_t>((a + 2 * b + 1) / 3);
+        }
+        else
+        {
+            palette[8 + channel] = static_cast<uint8_t>((a + b + 1) / 2);
+            // transparent black in BC1 with alpha, the RGB variant reads it as opaque black
+            palette[12 + channel] = 0;
+        }
+    }
+    palette[11] = OpaqueAlpha8;
+    palette[15] = OpaqueAlpha8;
+}
+
+// 8 alpha values of a BC3 alpha block
+void DecodeAlphaBlockPalette(const uint8_t* block, uint8_t* palette)
+{
+    const uint32_t a0 = block[0];
+    const uint32_t a1 = block[1];
+    palette[0] = static_cast<uint8_t>(a0);
+    palette[1] = static_cast<uint8_t>(a1);
+    if (a0 > a1)
+    {
+        for (uint32_t i = 1; i < 7; ++i)
+        {
+            palette[i + 1] = static_cast<uint8_t>(((7 - i) * a0 + i * a1 + 3) / 7);
+        }
+    }
+    else
+    {
+        for (uint32_t i = 1; i < 5; ++i)
+        {
+            palette[i + 1] = static_cast<uint8_t>(((5 - i) * a0 + i * a1 + 2) / 5);
+        }
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+template <typename DecodeBlockFunc>
+void DecodeBlocks(const uint8_t* blocks,
+                  uint32_t blockSize,
+                  uint32_t width,
+                  uint32_t height,
+                  uint8_t* dst,
+                  DecodeBlockFunc&& decodeBlock)
+{
+    const uint32_t blocksX = (width + BlockDim - 1) / BlockDim;
+    const uint32_t blocksY = (height + BlockDim - 1) / BlockDim;
+    uint8_t texels[BlockDim * BlockDim * 4];
+    for (uint32_t by = 0; by < blocksY; ++by)
+    {
+        for (uint32_t bx = 0; bx < blocksX; ++bx)
+        {
+            decodeBlock(blocks, texels);
+            blocks += blockSize;
+
+            // edge blocks of mips smaller than a block are cropped
+            for (uint32_t y = 0; y < BlockDim && by * BlockDim + y < height; ++y)
+            {
+                for (uint32_t x = 0; x < BlockDim && bx * BlockDim + x < width; ++x)
+                {
+                    const size_t dstTexel =
+                        static_cast<size_t>(by * BlockDim + y) * width + bx * BlockDim + x;
+                    memcpy(dst + dstTexel * 4, texels + (y * BlockDim + x) * 4, 4);
+                }
+            }
+        }
+    }
+}
+
+void DecodeColorBlock(const uint8_t* block, bool allowThreeColorMode, uint8_t* texels)
+{
+    uint8_t palette[16];
+    DecodeColorBlockPalette(block, allowThreeColorMode, palette);
+    const uint32_t indices =
+        block[4] | (block[5] << 8) | (block[6] << 16) | (static_cast<uint32_t>(block[7]) << 24);
+    for (uint32_t i = 0; i < BlockDim * BlockDim; ++i)
+    {
+        memcpy(texels + i * 4, palette + ((indices >> (2 * i)) & 0x3) * 4, 4);
+    }
+}
+}  // namespace
+
+void ExpandRgbToRgba(const uint8_t* src, uint8_t* dst, size_t pixelsCount)
+{
+    size_t processed = 0;
+#ifdef EZ_PIXEL_CONVERSION_SSE
+    static const bool ssse3Supported = IsSsse3Supported();
+    if (ssse3Supported) { processed = ExpandRgbToRgbaSsse3(src, dst, pixelsCount); }
+#endif
+    ExpandRgbToRgbaScalar(src + processed * 3, dst + processed * 4, pixelsCount - processed);
+}
+
+void ExpandToRgba(const uint8_t* src,
+                  uint32_t srcChannelsCount,
+                  uint8_t* dst,
+                  size_t pixelsCount)
+{
+    if (srcChannelsCount == 4)
+    {
+        std::memcpy(dst, src, pixelsCount * 4);
+        return;
+    }
+    if (srcChannelsCount == 3)
+    {
+        ExpandRgbToRgba(src, dst, pixelsCount);
+        return;
+    }
+
+    for (size_t i = 0; i < pixelsCount; ++i)
+    {
+        for (uint32_t c = 0; c < 3; ++c) { dst[c] = c < srcChannelsCount ? src[c] : 0; }
+        dst[3] = OpaqueAlpha8;
+        src += srcChannelsCount;
+        dst += 4;
+    }
+}
+
+void ExpandRgbToRgba(const float* src, float* dst, size_t pixelsCount)
+{
+    size_t i = 0;
+#ifdef EZ_PIXEL_CONVERSION_SSE
+    const __m128 rgbMask = _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0));
+    const __m128 alpha = _mm_setr_ps(0.0f, 0.0f, 0.0f, OpaqueAlpha32F);
+
+    // each pixel is an unaligned 4-float load whose 4th lane belongs to the next pixel, so the
+    // last pixel of the source is left to the scalar tail
+    for (; i + 5 <= pixelsCount; i += 4)
+    {
+        const float* pixel = src + i * 3;
+        float* out = dst + i * 4;
+        _mm_storeu_ps(out + 0, _mm_or_ps(_mm_and_ps(_mm_loadu_ps(pixel + 0), rgbMask), alpha));
+        _mm_storeu_ps(out + 4, _mm_or_ps(_mm_and_ps(_mm_loadu_ps(pixel + 3), rgbMask), alpha));
+        _mm_storeu_ps(out + 8, _mm_or_ps(_mm_and_ps(_mm_loadu_ps(pixel + 6), rgbMask), alpha));
+        _mm_storeu_ps(out + 12, _mm_or_ps(_mm_and_ps(_mm_loadu_ps(pixel + 9), rgbMask), alpha));
+    }
+#endif
+    for (; i < pixelsCount; ++i)
+    {
+        dst[i * 4 + 0] = src[i * 3 + 0];
+        dst[i * 4 + 1] = src[i * 3 + 1];
+        dst[i * 4 + 2] = src[i * 3 + 2];
+        dst[i * 4 + 3] = OpaqueAlpha32F;
+    }
+}
+
+void ExpandToRgba(const float* src, uint32_t srcChannelsCount, float* dst, size_t pixelsCount)
+{
+    if (srcChannelsCount == 4)
+    {
+        std::memcpy(dst, src, pixelsCount * 4 * sizeof(float));
+        return;
+    }
+    if (srcChannelsCount == 3)
+    {
+        ExpandRgbToRgba(src, dst, pixelsCount);
+        return;
+    }
+
+    for (size_t i = 0; i < pixelsCount; ++i)
+    {
+        for (uint32_t c = 0; c < 3; ++c) { dst[c] = c < srcChannelsCount ? src[c] : 0.0f; }
+        dst[3] = OpaqueAlpha32F;
+        src += srcChannelsCount;
+        dst += 4;
+    }
+}
+
+void ConvertFloatToHalf(const float* src, uint16_t* dst, size_t count)
+{
+    size_t processed = 0;
+#ifdef EZ_PIXEL_CONVERSION_SSE
+    static const bool f16cSupported = IsF16cSupported();
+    if (f16cSupported) { processed = ConvertFloatToHalfF16c(src, dst, count); }
+#endif
+    ConvertFloatToHalfScalar(src + processed, dst + processed, count - processed);
+}
+
+void ExpandToRgbaHalf(const float* src,
+                      uint32_t srcChannelsCount,
+                      uint16_t* dst,
+                      size_t pixelsCount)
+{
+    // expand a small chunk at a time so that the float RGBA copy stays in L1
+    float chunk[HalfConversionChunkPixelsCount * 4];
+    for (size_t i = 0; i < pixelsCount; i += HalfConversionChunkPixelsCount)
+    {
+        const size_t chunkPixelsCount =
+            std::min(HalfConversionChunkPixelsCount, pixelsCount - i);
+        ExpandToRgba(src + i * srcChannelsCount, srcChannelsCount, chunk, chunkPixelsCount);
+        ConvertFloatToHalf(chunk, dst + i * 4, chunkPixelsCount * 4);
+    }
+}
+
+void RgbeToRgbaHalf(const uint8_t* src, uint16_t* dst, size_t pixelsCount)
+{
+    float chunk[HalfConversionChunkPixelsCount * 4];
+    for (size_t i = 0; i < pixelsCount; i += HalfConversionChunkPixelsCount)
+    {
+        const size_t chunkPixelsCount =
+            std::min(HalfConversionChunkPixelsCount, pixelsCount - i);
+        const uint8_t* chunkSrc = src + i * 4;
+        size_t processed = 0;
+#ifdef EZ_PIXEL_CONVERSION_SSE
+        processed = RgbeToRgbaSse2(chunkSrc, chunk, chunkPixelsCount);
+#endif
+        RgbeToRgbaScalar(
+            chunkSrc + processed * 4, chunk + processed * 4, chunkPixelsCount - processed);
+        ConvertFloatToHalf(chunk, dst + i * 4, chunkPixelsCount * 4);
+    }
+}
+
+void PackRgbaHalfToB10G11R11(const uint16_t* src, uint32_t* dst, size_t pixelsCount)
+{
+    constexpr uint32_t MaxFinite11 = 0x7BFu;
+    constexpr uint32_t MaxFinite10 = 0x3DFu;
+    for (size_t i = 0; i < pixelsCount; ++i)
+    {
+        const uint16_t* pixel = src + i * 4;
+        const uint32_t r = HalfToSmallFloat(pixel[0], 4, MaxFinite11);
+        const uint32_t g = HalfToSmallFloat(pixel[1], 4, MaxFinite11);
+        const uint32_t b = HalfToSmallFloat(pixel[2], 5, MaxFinite10);
+        dst[i] = r | (g << 11) | (b << 22);
+    }
+}
+
+void DecodeBC1ToRgba(const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* dst)
+{
+    DecodeBlocks(blocks, 8, width, height, dst, [](const uint8_t* block, uint8_t* texels) {
+        DecodeColorBlock(block, true, texels);
+    });
+}
+
+void DecodeBC3ToRgba(const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* dst)
+{
+    DecodeBlocks(blocks, 16, width, height, dst, [](const uint8_t* block, uint8_t* texels) {
+        // color block of BC3 always uses the four color mode
+        DecodeColorBlock(block + 8, false, texels);
+
+        uint8_t alphaPalette[8];
+        DecodeAlphaBlockPalette(block, alphaPalette);
+        uint64_t alphaIndices = 0;
+        for (uint32_t i = 0; i < 6; ++i)
+        {
+            alphaIndices |= static_cast<uint64_t>(block[2 + i]) << (8 * i);
+        }
+        for (uint32_t i = 0; i < BlockDim * BlockDim; ++i)
+        {
+            texels[i * 4 + 3] = alphaPalette[(alphaIndices >> (3 * i)) & 0x7];
+        }
+    });
+}
+
+}  // namespace ez::PixelConversion
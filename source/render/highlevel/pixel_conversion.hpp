@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Channel expansion kernels used to bring decoded images to the 4-channel layouts textures are
+// uploaded with. All of them write straight into the destination, missing alpha is opaque.
+namespace ez::PixelConversion
+{
+// RGB8 -> RGBA8, SSSE3 shuffle when the CPU supports it
+void ExpandRgbToRgba(const uint8_t* src, uint8_t* dst, size_t pixelsCount);
+
+// any 1..4 channels 8-bit layout -> RGBA8
+void ExpandToRgba(const uint8_t* src,
+                  uint32_t srcChannelsCount,
+                  uint8_t* dst,
+                  size_t pixelsCount);
+
+// RGB32F -> RGBA32F, SSE2
+void ExpandRgbToRgba(const float* src, float* dst, size_t pixelsCount);
+
+// any 1..4 channels float layout -> RGBA32F
+void ExpandToRgba(const float* src, uint32_t srcChannelsCount, float* dst, size_t pixelsCount);
+
+// float -> IEEE half, F16C when the CPU supports it
+void ConvertFloatToHalf(const float* src, uint16_t* dst, size_t count);
+
+// any 1..4 channels float layout -> RGBA16F
+void ExpandToRgbaHalf(const float* src,
+                      uint32_t srcChannelsCount,
+                      uint16_t* dst,
+                      size_t pixelsCount);
+
+// Radiance RGBE (shared 8-bit exponent) -> RGBA16F, SSE2 exponent expansion
+void RgbeToRgbaHalf(const uint8_t* src, uint16_t* dst, size_t pixelsCount);
+
+// RGBA16F -> B10G11R11 unsigned float, alpha is dropped
+void PackRgbaHalfToB10G11R11(const uint16_t* src, uint32_t* dst, size_t pixelsCount);
+
+// BC1 / BC3 blocks of one width x height image -> RGBA8, for devices that can't sample block
+// compressed formats
+void DecodeBC1ToRgba(const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* dst);
+void DecodeBC3ToRgba(const uint8_t* blocks, uint32_t width, uint32_t height, uint8_t* dst);
+
+}  // namespace ez::PixelConversion
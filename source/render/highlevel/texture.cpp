@@ -1,14 +1,126 @@
 #include "texture.hpp"
 
+#include <algorithm>
+#include <array>
+
 #include "core/log_assert.hpp"
 #include "render/graphics_result.hpp"
+#include "render/highlevel/mip_generator.hpp"
+#include "render/highlevel/pixel_conversion.hpp"
 #include "render/vulkan/vulkan_buffer.hpp"
 #include "render/vulkan/vulkan_command_buffer.hpp"
 #include "render/vulkan/vulkan_image.hpp"
+#include "render/vulkan/vulkan_sampler_cache.hpp"
 
 namespace ez
 {
-TextureCreationInfo TextureCreationInfo::CreateFromData(uint8_t* data,
+namespace
+{
+struct StagingBuffer final
+{
+    vk::Buffer buffer;
+    vk::DeviceMemory memory;
+};
+
+// host visible transfer source of the given size, fill writes the contents to mapped memory
+template <typename FillFunc>
+StagingBuffer CreateStagingBuffer(vk::Device logicalDevice,
+                                  vk::PhysicalDevice physicalDevice,
+                                  vk::DeviceSize size,
+                                  FillFunc&& fill)
+{
+    StagingBuffer staging;
+
+    vk::BufferCreateInfo bufferCI{};
+    bufferCI.setSize(size);
+    bufferCI.setUsage(vk::BufferUsageFlags(vk::BufferUsageFlagBits::eTransferSrc));
+    bufferCI.setSharingMode(vk::SharingMode::eExclusive);
+
+    CheckVkResult(logicalDevice.createBuffer(&bufferCI, nullptr, &staging.buffer));
+
+    vk::MemoryRequirements memReqs{};
+    vk::MemoryAllocateInfo memAllocInfo{};
+    logicalDevice.getBufferMemoryRequirements(staging.buffer, &memReqs);
+
+    const uint32_t memoryTypeIndex = VulkanBuffer::FindMemoryType(
+        physicalDevice,
+        memReqs.memoryTypeBits,
+        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+
+    memAllocInfo.setAllocationSize(memReqs.size);
+    memAllocInfo.setMemoryTypeIndex(memoryTypeIndex);
+
+    CheckVkResult(logicalDevice.allocateMemory(&memAllocInfo, nullptr, &staging.memory));
+    CheckVkResult(logicalDevice.bindBufferMemory(staging.buffer, staging.memory, 0));
+
+    uint8_t* data;
+    CheckVkResult(logicalDevice.mapMemory(staging.memory,
+                                          0,
+                                          memReqs.size,
+                                          vk::MemoryMapFlags{},
+                                          reinterpret_cast<void**>(&data)));
+    fill(data);
+    logicalDevice.unmapMemory(staging.memory);
+
+    return staging;
+}
+
+void DestroyStagingBuffer(vk::Device logicalDevice, const StagingBuffer& staging)
+{
+    logicalDevice.destroyBuffer(staging.buffer);
+    logicalDevice.freeMemory(staging.memory);
+}
+
+bool IsBlockCompressed(vk::Format format)
+{
+    return format == vk::Format::eBc1RgbUnormBlock || format == vk::Format::eBc3UnormBlock;
+}
+
+// block compressed mips of data -> tightly packed RGBA8 mips, regions get their new offsets
+template <typename MipRegion>
+std::vector<uint8_t> DecodeBlockCompressedMips(vk::Format format,
+                                               const std::vector<uint8_t>& data,
+                                               std::vector<MipRegion>& regions)
+{
+    uint64_t decodedSize = 0;
+    for (const MipRegion& region : regions)
+    {
+        decodedSize += static_cast<uint64_t>(region.width) * region.height * 4;
+    }
+
+    std::vector<uint8_t> decoded(decodedSize);
+    uint64_t offset = 0;
+    for (MipRegion& region : regions)
+    {
+        const uint8_t* blocks = data.data() + region.offset;
+        uint8_t* dst = decoded.data() + offset;
+        if (format == vk::Format::eBc1RgbUnormBlock)
+        {
+            PixelConversion::DecodeBC1ToRgba(blocks, region.width, region.height, dst);
+        }
+        else { PixelConversion::DecodeBC3ToRgba(blocks, region.width, region.height, dst); }
+        region.offset = offset;
+        offset += static_cast<uint64_t>(region.width) * region.height * 4;
+    }
+    return decoded;
+}
+}  // namespace
+
+const char* ToString(TextureResidency residency)
+{
+    switch (residency)
+    {
+        case TextureResidency::eCpu:
+            return "CPU";
+        case TextureResidency::eCpuAndGpu:
+            return "CPU+GPU";
+        case TextureResidency::eGpu:
+            return "GPU";
+    }
+    return "Unknown";
+}
+
+TextureCreationInfo TextureCreationInfo::CreateFromData(const uint8_t* data,
                                                         uint32_t width,
                                                         uint32_t height,
                                                         uint32_t colorChannelsCount,
@@ -20,77 +132,234 @@ TextureCreationInfo TextureCreationInfo::CreateFromData(uint8_t* data,
     ci.format = vk::Format::eR8G8B8A8Unorm;
     ci.colorChannelsCount = 4;
 
-    const uint32_t dataSize = width * height * ci.colorChannelsCount * imageLayersCount;
-    ci.buffer.resize(dataSize);
+    const size_t pixelsCount = static_cast<size_t>(width) * height * imageLayersCount;
+    ci.buffer.resize(pixelsCount * ci.colorChannelsCount);
+    PixelConversion::ExpandToRgba(data, colorChannelsCount, ci.buffer.data(), pixelsCount);
+
+    ci.SetDimensions(width, height, imageLayersCount, needMips);
+    ci.textureSampler = textureSampler;
+
+    return ci;
+}
 
-    uint8_t* copyTo = ci.buffer.data();
-    uint8_t* copyFrom = data;
-    for (uint32_t i = 0; i < width * height * imageLayersCount; ++i)
+TextureCreationInfo TextureCreationInfo::CreateFromData(std::vector<uint8_t>&& data,
+                                                        uint32_t width,
+                                                        uint32_t height,
+                                                        uint32_t colorChannelsCount,
+                                                        uint32_t imageLayersCount,
+                                                        bool needMips,
+                                                        const TextureSampler& textureSampler)
+{
+    const size_t pixelsCount = static_cast<size_t>(width) * height * imageLayersCount;
+    if (colorChannelsCount != 4 || data.size() != pixelsCount * 4)
     {
-        for (uint32_t j = 0; j < colorChannelsCount; ++j) { copyTo[j] = copyFrom[j]; }
-        copyTo += ci.colorChannelsCount;
-        copyFrom += colorChannelsCount;
+        return CreateFromData(data.data(),
+                              width,
+                              height,
+                              colorChannelsCount,
+                              imageLayersCount,
+                              needMips,
+                              textureSampler);
     }
 
-    ci.width = width;
-    ci.height = height;
-    ci.imageLayersCount = imageLayersCount;
-    ci.mipLevels =
-        needMips
-            ? static_cast<uint32_t>(std::floor(std::log2(std::max(ci.width, ci.height))) + 1.0)
-            : 1;
+    // already in the upload layout, take the buffer as is
+    TextureCreationInfo ci;
+    ci.format = vk::Format::eR8G8B8A8Unorm;
+    ci.colorChannelsCount = 4;
+    ci.buffer = std::move(data);
 
+    ci.SetDimensions(width, height, imageLayersCount, needMips);
     ci.textureSampler = textureSampler;
 
     return ci;
 }
 
-TextureCreationInfo TextureCreationInfo::CreateHdrFromData(float* data,
+TextureCreationInfo TextureCreationInfo::CreateHdrFromData(const float* data,
                                                            uint32_t width,
                                                            uint32_t height,
                                                            uint32_t dataChannelsCount,
                                                            const TextureSampler& textureSampler)
 {
     TextureCreationInfo ci;
-    ci.format = vk::Format::eR32G32B32A32Sfloat;
+    ci.format = vk::Format::eR16G16B16A16Sfloat;
+    ci.colorChannelsCount = 4;
+    ci.packHdrIfSupported = true;
+
+    const size_t pixelsCount = static_cast<size_t>(width) * height;
+    ci.buffer.resize(pixelsCount * ci.colorChannelsCount * sizeof(uint16_t));
+    PixelConversion::ExpandToRgbaHalf(data,
+                                      dataChannelsCount,
+                                      reinterpret_cast<uint16_t*>(ci.buffer.data()),
+                                      pixelsCount);
+
+    ci.SetDimensions(width, height, 1, false);
+    ci.textureSampler = textureSampler;
+
+    return ci;
+}
+
+TextureCreationInfo TextureCreationInfo::CreateHdrFromHalf(std::vector<uint8_t>&& rgbaHalf,
+                                                           uint32_t width,
+                                                           uint32_t height,
+                                                           const TextureSampler& textureSampler)
+{
+    TextureCreationInfo ci;
+    ci.format = vk::Format::eR16G16B16A16Sfloat;
     ci.colorChannelsCount = 4;
+    ci.packHdrIfSupported = true;
 
-    std::vector<float> fourChannelData;
-    fourChannelData.resize(width * height * ci.colorChannelsCount);
+    EZASSERT((rgbaHalf.size() == static_cast<size_t>(width) * height * 4 * sizeof(uint16_t)),
+             "RGBA16F data size doesn't match texture dimensions");
+    ci.buffer = std::move(rgbaHalf);
 
-    float* copyTo = fourChannelData.data();
-    float* copyFrom = data;
+    ci.SetDimensions(width, height, 1, false);
+    ci.textureSampler = textureSampler;
+
+    return ci;
+}
 
-    for (uint32_t i = 0; i < width * height; ++i)
+void TextureCreationInfo::SetDimensions(uint32_t aWidth,
+                                        uint32_t aHeight,
+                                        uint32_t aImageLayersCount,
+                                        bool needMips)
+{
+    width = aWidth;
+    height = aHeight;
+    imageLayersCount = aImageLayersCount;
+    mipLevels =
+        needMips ? static_cast<uint32_t>(std::floor(std::log2(std::max(width, height))) + 1.0)
+                 : 1;
+}
+
+TextureCreationInfo TextureCreationInfo::CreateFromCooked(CookedTexture::Image&& cookedImage,
+                                                          const TextureSampler& textureSampler)
+{
+    TextureCreationInfo ci;
+    switch (cookedImage.header.format)
     {
-        copyTo[0 + 3] = 1.0f;  // alpha
-        for (uint32_t j = 0; j < dataChannelsCount; ++j) { copyTo[j] = copyFrom[j]; }
-        copyTo += ci.colorChannelsCount;
-        copyFrom += dataChannelsCount;
+        case CookedTexture::Format::eBC1RgbUnorm:
+            ci.format = vk::Format::eBc1RgbUnormBlock;
+            break;
+        case CookedTexture::Format::eBC3Unorm:
+            ci.format = vk::Format::eBc3UnormBlock;
+            break;
+        default:
+            ci.format = vk::Format::eR8G8B8A8Unorm;
+            break;
     }
+    ci.colorChannelsCount = 4;
+
+    ci.buffer = std::move(cookedImage.data);
+    for (const CookedTexture::MipLevel& mip : cookedImage.mipLevels)
+    {
+        ci.precomputedMips.push_back(MipRegion{ mip.offset, mip.width, mip.height });
+    }
+
+    ci.width = cookedImage.header.width;
+    ci.height = cookedImage.header.height;
+    ci.mipLevels = cookedImage.header.mipLevelsCount;
+    ci.firstMip = cookedImage.firstMip;
+
+    ci.textureSampler = textureSampler;
 
-    const uint8_t floatToUint8SizeRatio = 4;
-    const uint32_t dataSize =
-        static_cast<uint32_t>(fourChannelData.size()) * floatToUint8SizeRatio;
-    ci.buffer.resize(dataSize);
+    return ci;
+}
 
-    memcpy(ci.buffer.data(), fourChannelData.data(), dataSize);
+TextureCreationInfo TextureCreationInfo::CreateFromMipChain(vk::Format format,
+                                                            uint32_t texelSize,
+                                                            uint32_t width,
+                                                            uint32_t height,
+                                                            uint32_t imageLayersCount,
+                                                            uint32_t mipLevels,
+                                                            std::vector<uint8_t>&& data,
+                                                            const TextureSampler& textureSampler)
+{
+    TextureCreationInfo ci;
+    ci.format = format;
+    ci.colorChannelsCount = 4;
+
+    uint64_t offset = 0;
+    for (uint32_t mip = 0; mip < mipLevels; ++mip)
+    {
+        const uint32_t mipWidth = std::max(width >> mip, 1u);
+        const uint32_t mipHeight = std::max(height >> mip, 1u);
+        ci.precomputedMips.push_back(MipRegion{ offset, mipWidth, mipHeight });
+        offset += static_cast<uint64_t>(mipWidth) * mipHeight * imageLayersCount * texelSize;
+    }
+    EZASSERT(offset == data.size(), "Mip chain size doesn't match its data");
+    ci.buffer = std::move(data);
 
     ci.width = width;
     ci.height = height;
-    ci.mipLevels = 1;
+    ci.imageLayersCount = imageLayersCount;
+    ci.mipLevels = mipLevels;
+
+    ci.textureSampler = textureSampler;
+
+    return ci;
+}
 
+TextureCreationInfo TextureCreationInfo::CreateGpuOnly(vk::Format format,
+                                                       uint32_t width,
+                                                       uint32_t height,
+                                                       uint32_t imageLayersCount,
+                                                       bool needMips,
+                                                       vk::ImageUsageFlags gpuUsage,
+                                                       const TextureSampler& textureSampler)
+{
+    TextureCreationInfo ci;
+    ci.format = format;
+    ci.colorChannelsCount = 4;
+    ci.extraUsage = gpuUsage;
+    ci.gpuOnly = true;
+
+    ci.SetDimensions(width, height, imageLayersCount, needMips);
     ci.textureSampler = textureSampler;
 
     return ci;
 }
 
-bool TextureCreationInfo::IsValid() const { return width > 0 && height > 0 && !buffer.empty(); }
+bool TextureCreationInfo::IsValid() const
+{
+    const bool mipsValid = firstMip == 0 || (firstMip < mipLevels &&
+                                             precomputedMips.size() == mipLevels - firstMip);
+    return width > 0 && height > 0 && (gpuOnly || !buffer.empty()) && mipsValid;
+}
+
+bool Texture::IsFormatFilterable(vk::PhysicalDevice physicalDevice, vk::Format format)
+{
+    vk::FormatProperties formatProperties;
+    physicalDevice.getFormatProperties(format, &formatProperties);
+    const vk::FormatFeatureFlags requiredFeatures =
+        vk::FormatFeatureFlagBits::eSampledImage |
+        vk::FormatFeatureFlagBits::eSampledImageFilterLinear;
+    return (formatProperties.optimalTilingFeatures & requiredFeatures) == requiredFeatures;
+}
+
+std::unique_ptr<Texture> Texture::CreateDefault(uint8_t value,
+                                                vk::Device logicalDevice,
+                                                vk::PhysicalDevice physicalDevice,
+                                                vk::Queue graphicsQueue,
+                                                vk::CommandPool graphicsCommandPool,
+                                                VulkanSamplerCache& samplerCache)
+{
+    const std::array<uint8_t, 4> texel = { value, value, value, 255 };
+    auto texture = std::make_unique<Texture>(
+        TextureCreationInfo::CreateFromData(texel.data(), 1, 1, 4, 1, false, {}));
+    if (!texture->LoadToGpu(
+            logicalDevice, physicalDevice, graphicsQueue, graphicsCommandPool, samplerCache))
+    {
+        return nullptr;
+    }
+    return texture;
+}
 
 bool Texture::LoadToGpu(vk::Device aLogicalDevice,
                         vk::PhysicalDevice physicalDevice,
                         vk::Queue graphicsQueue,
-                        vk::CommandPool graphicsCommandPool)
+                        vk::CommandPool graphicsCommandPool,
+                        VulkanSamplerCache& samplerCache,
+                        MipGenerator* mipGenerator)
 {
     if (loadedToGpu)
     {
@@ -102,8 +371,6 @@ bool Texture::LoadToGpu(vk::Device aLogicalDevice,
         EZASSERT(false, "Can't load Texture with incomplete TextureCreationInfo");
         return false;
     }
-    // notice CPU texture data in creationInfo is not freed after load
-
     logicalDevice = aLogicalDevice;
 
     format = creationInfo.format;
@@ -111,76 +378,139 @@ bool Texture::LoadToGpu(vk::Device aLogicalDevice,
     height = creationInfo.height;
     imageLayersCount = creationInfo.imageLayersCount;
     mipLevels = creationInfo.mipLevels;
+    residentMip = creationInfo.firstMip;
 
-    vk::DeviceSize bufferSize = static_cast<vk::DeviceSize>(creationInfo.buffer.size());
+    // RGB-only HDR data is repacked to 4 bytes per texel on upload if the device can filter it
+    const bool packHdr = creationInfo.packHdrIfSupported &&
+                         format == vk::Format::eR16G16B16A16Sfloat &&
+                         !creationInfo.HasPrecomputedMips() &&
+                         IsFormatFilterable(physicalDevice, vk::Format::eB10G11R11UfloatPack32);
+    if (packHdr) { format = vk::Format::eB10G11R11UfloatPack32; }
+
+    // cooked BC mips are decoded on the CPU for devices without BC support, streamed ones too
+    if (IsBlockCompressed(format) && !IsFormatFilterable(physicalDevice, format))
+    {
+        EZLOG("Decoding texture, the device can't sample", vk::to_string(format));
+        creationInfo.buffer = DecodeBlockCompressedMips(
+            format, creationInfo.buffer, creationInfo.precomputedMips);
+        format = vk::Format::eR8G8B8A8Unorm;
+    }
 
     vk::FormatProperties formatProperties;
 
     physicalDevice.getFormatProperties(format, &formatProperties);
+    if (!(formatProperties.optimalTilingFeatures & vk::FormatFeatureFlagBits::eSampledImage))
+    {
+        EZLOG("Texture format is not supported for sampling:", vk::to_string(format));
+        return false;
+    }
 
     //    EZASSERT(static_cast<bool>(formatProperties.optimalTilingFeatures &
     //                               vk::FormatFeatureFlagBits::eBlitSrc));
     //    EZASSERT(static_cast<bool>(formatProperties.optimalTilingFeatures &
     //                               vk::FormatFeatureFlagBits::eBlitDst));
 
-    vk::Buffer stagingBuffer;
-    vk::DeviceMemory stagingMemory;
+    // mips are either uploaded as is or generated from mip 0 on GPU
+    const bool generateMips =
+        mipLevels > 1 && !creationInfo.HasPrecomputedMips() && !creationInfo.IsGpuOnly();
+    // formats without storage image support fall back to blits
+    MipGenerator* computeMipGenerator = nullptr;
+    if (generateMips && mipGenerator &&
+        mipGenerator->IsSupported(format, width, height, imageLayersCount))
+    {
+        computeMipGenerator = mipGenerator;
+    }
 
-    vk::BufferCreateInfo bufferCI{};
-    bufferCI.setSize(bufferSize);
-    bufferCI.setUsage(vk::BufferUsageFlags(vk::BufferUsageFlagBits::eTransferSrc));
-    bufferCI.setSharingMode(vk::SharingMode::eExclusive);
+    // streamed textures start with the smaller mips only, the image grows as mips arrive
+    ResultValue<ImageWithMemory> imageRV =
+        Image::CreateImage2DWithMemory(logicalDevice,
+                                       physicalDevice,
+                                       format,
+                                       GetImageUsage(generateMips, computeMipGenerator),
+                                       GetImageMipLevels(),
+                                       std::max(width >> residentMip, 1u),
+                                       std::max(height >> residentMip, 1u),
+                                       imageLayersCount,
+                                       GetImageCreateFlags(),
+                                       vk::SampleCountFlagBits::e1,
+                                       creationInfo.sharingQueueFamilies);
+    if (imageRV.result != GraphicsResult::Ok) { return false; }
+    image = imageRV.value.image;
+    deviceMemory = imageRV.value.imageMemory;
+    gpuBytes = logicalDevice.getImageMemoryRequirements(image).size;
+
+    // contents and layout of GPU-only textures are owned by the pass that renders into them
+    if (!creationInfo.IsGpuOnly() && !UploadPixels(physicalDevice,
+                                                   graphicsQueue,
+                                                   graphicsCommandPool,
+                                                   packHdr,
+                                                   generateMips,
+                                                   computeMipGenerator))
+    {
+        return false;
+    }
 
-    CheckVkResult(logicalDevice.createBuffer(&bufferCI, nullptr, &stagingBuffer));
+    imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
 
-    vk::MemoryRequirements memReqs{};
-    vk::MemoryAllocateInfo memAllocInfo{};
-    logicalDevice.getBufferMemoryRequirements(stagingBuffer, &memReqs);
+    sampler = samplerCache.GetSampler(creationInfo.textureSampler);
+    if (!sampler) { return false; }
 
-    const uint32_t memoryTypeIndex = VulkanBuffer::FindMemoryType(
-        physicalDevice,
-        memReqs.memoryTypeBits,
-        vk::MemoryPropertyFlagBits::eHostVisible | vk::MemoryPropertyFlagBits::eHostCoherent);
+    vk::ImageViewType imageViewType =
+        creationInfo.IsCubemap() ? vk::ImageViewType::eCube : vk::ImageViewType::e2D;
+    ResultValue<vk::ImageView> imageViewRV =
+        Image::CreateImageView(imageViewType,
+                               logicalDevice,
+                               image,
+                               format,
+                               vk::ImageAspectFlagBits::eColor,
+                               imageLayersCount,
+                               GetImageMipLevels());
+    if (imageViewRV.result != GraphicsResult::Ok) { return false; }
 
-    memAllocInfo.setAllocationSize(memReqs.size);
-    memAllocInfo.setMemoryTypeIndex(memoryTypeIndex);
+    descriptor.sampler = sampler;
+    descriptor.imageView = imageViewRV.value;
+    descriptor.imageLayout = imageLayout;
 
-    CheckVkResult(logicalDevice.allocateMemory(&memAllocInfo, nullptr, &stagingMemory));
-    CheckVkResult(logicalDevice.bindBufferMemory(stagingBuffer, stagingMemory, 0));
+    loadedToGpu = true;
+    if (creationInfo.cpuDataPolicy == TextureCpuDataPolicy::eReleaseAfterUpload)
+    {
+        ReleaseCpuData();
+    }
+    return true;
+}
 
-    uint8_t* data;
-    CheckVkResult(logicalDevice.mapMemory(
-        stagingMemory, 0, memReqs.size, vk::MemoryMapFlags{}, reinterpret_cast<void**>(&data)));
-    memcpy(data, creationInfo.buffer.data(), bufferSize);
-    logicalDevice.unmapMemory(stagingMemory);
+bool Texture::UploadPixels(vk::PhysicalDevice physicalDevice,
+                           vk::Queue graphicsQueue,
+                           vk::CommandPool graphicsCommandPool,
+                           bool packHdr,
+                           bool generateMips,
+                           MipGenerator* computeMipGenerator)
+{
+    const size_t texelsCount = static_cast<size_t>(width) * height * imageLayersCount;
+    vk::DeviceSize bufferSize =
+        packHdr ? static_cast<vk::DeviceSize>(texelsCount * sizeof(uint32_t))
+                : static_cast<vk::DeviceSize>(creationInfo.buffer.size());
+
+    const StagingBuffer staging =
+        CreateStagingBuffer(logicalDevice, physicalDevice, bufferSize, [&](uint8_t* data) {
+            if (packHdr)
+            {
+                PixelConversion::PackRgbaHalfToB10G11R11(
+                    reinterpret_cast<const uint16_t*>(creationInfo.buffer.data()),
+                    reinterpret_cast<uint32_t*>(data),
+                    texelsCount);
+            }
+            else { memcpy(data, creationInfo.buffer.data(), bufferSize); }
+        });
 
     // /////////////////////////////
 
-    vk::ImageCreateFlags imageCreateFlags = creationInfo.IsCubemap()
-                                              ? vk::ImageCreateFlagBits::eCubeCompatible
-                                              : vk::ImageCreateFlags{};
-    ResultValue<ImageWithMemory> imageRV = Image::CreateImage2DWithMemory(
-        logicalDevice,
-        physicalDevice,
-        format,
-        vk::ImageUsageFlagBits::eTransferDst | vk::ImageUsageFlagBits::eTransferSrc |
-            vk::ImageUsageFlagBits::eSampled,
-        creationInfo.mipLevels,
-        width,
-        height,
-        imageLayersCount,
-        imageCreateFlags,
-        vk::SampleCountFlagBits::e1);
-    if (imageRV.result != GraphicsResult::Ok) { return false; }
-    image = imageRV.value.image;
-    deviceMemory = imageRV.value.imageMemory;
-
     VulkanOneTimeCommandBuffer copyOneTimeCB =
         VulkanOneTimeCommandBuffer::Start(logicalDevice, graphicsCommandPool);
 
     vk::ImageSubresourceRange subresourceRange = {};
     subresourceRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
-    subresourceRange.setLevelCount(1);
+    subresourceRange.setLevelCount(generateMips ? 1 : GetImageMipLevels());
     subresourceRange.setLayerCount(imageLayersCount);
 
     ez::Image::SubmitChangeImageLayout(copyOneTimeCB.GetCommandBuffer(),
@@ -193,89 +523,329 @@ bool Texture::LoadToGpu(vk::Device aLogicalDevice,
                                        vk::AccessFlags{},
                                        vk::AccessFlagBits::eTransferWrite);
 
-    vk::BufferImageCopy bufferCopyRegion = {};
-    bufferCopyRegion.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
-    bufferCopyRegion.imageSubresource.setMipLevel(0);
-    bufferCopyRegion.imageSubresource.setBaseArrayLayer(0);
-    bufferCopyRegion.imageSubresource.setLayerCount(imageLayersCount);
-    bufferCopyRegion.imageExtent.setWidth(width);
-    bufferCopyRegion.imageExtent.setHeight(height);
-    bufferCopyRegion.imageExtent.setDepth(1);
+    std::vector<vk::BufferImageCopy> bufferCopyRegions;
+    if (creationInfo.HasPrecomputedMips())
+    {
+        // precomputedMips start at the resident mip, which is mip 0 of the image
+        const uint32_t precomputedMipsCount =
+            static_cast<uint32_t>(creationInfo.precomputedMips.size());
+        for (uint32_t mip = 0; mip < precomputedMipsCount; ++mip)
+        {
+            const TextureCreationInfo::MipRegion& mipRegion = creationInfo.precomputedMips[mip];
+            vk::BufferImageCopy& region = bufferCopyRegions.emplace_back();
+            region.setBufferOffset(mipRegion.offset);
+            region.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
+            region.imageSubresource.setMipLevel(mip);
+            region.imageSubresource.setBaseArrayLayer(0);
+            region.imageSubresource.setLayerCount(imageLayersCount);
+            region.imageExtent.setWidth(mipRegion.width);
+            region.imageExtent.setHeight(mipRegion.height);
+            region.imageExtent.setDepth(1);
+        }
+    }
+    else
+    {
+        vk::BufferImageCopy& region = bufferCopyRegions.emplace_back();
+        region.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
+        region.imageSubresource.setMipLevel(0);
+        region.imageSubresource.setBaseArrayLayer(0);
+        region.imageSubresource.setLayerCount(imageLayersCount);
+        region.imageExtent.setWidth(width);
+        region.imageExtent.setHeight(height);
+        region.imageExtent.setDepth(1);
+    }
 
     copyOneTimeCB.GetCommandBuffer().copyBufferToImage(
-        stagingBuffer, image, vk::ImageLayout::eTransferDstOptimal, 1, &bufferCopyRegion);
-
+        staging.buffer,
+        image,
+        vk::ImageLayout::eTransferDstOptimal,
+        static_cast<uint32_t>(bufferCopyRegions.size()),
+        bufferCopyRegions.data());
+
+    // mip 0 is the blit source, otherwise it is only sampled from now on
+    const bool blitMips = generateMips && !computeMipGenerator;
     ez::Image::SubmitChangeImageLayout(copyOneTimeCB.GetCommandBuffer(),
                                        vk::PipelineStageFlagBits::eAllCommands,
                                        vk::PipelineStageFlagBits::eAllCommands,
                                        image,
                                        subresourceRange,
                                        vk::ImageLayout::eTransferDstOptimal,
-                                       mipLevels > 1 ? vk::ImageLayout::eTransferSrcOptimal
-                                                     : vk::ImageLayout::eShaderReadOnlyOptimal,
+                                       blitMips ? vk::ImageLayout::eTransferSrcOptimal
+                                                : vk::ImageLayout::eShaderReadOnlyOptimal,
                                        vk::AccessFlagBits::eTransferWrite,
-                                       vk::AccessFlagBits::eTransferRead);
+                                       blitMips ? vk::AccessFlagBits::eTransferRead
+                                                : vk::AccessFlagBits::eShaderRead);
 
     copyOneTimeCB.EndSubmitAndWait(graphicsQueue);
 
-    logicalDevice.destroyBuffer(stagingBuffer);
-    logicalDevice.freeMemory(stagingMemory);
+    DestroyStagingBuffer(logicalDevice, staging);
 
     // //////////////////////////////////////////////
 
-    if (mipLevels > 1)
+    if (computeMipGenerator)
+    {
+        return computeMipGenerator->Generate(graphicsQueue,
+                                             graphicsCommandPool,
+                                             image,
+                                             format,
+                                             width,
+                                             height,
+                                             imageLayersCount,
+                                             mipLevels);
+    }
+    if (blitMips)
     {
-        const bool mipsCreated = Image::GenerateMipsForImage(
-            logicalDevice, graphicsQueue, graphicsCommandPool, image, width, height, mipLevels);
-        if (!mipsCreated) { return false; }
+        return Image::GenerateMipsForImage(logicalDevice,
+                                           graphicsQueue,
+                                           graphicsCommandPool,
+                                           image,
+                                           width,
+                                           height,
+                                           imageLayersCount,
+                                           mipLevels);
     }
+    return true;
+}
 
-    imageLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+bool Texture::RecordStreamIn(vk::PhysicalDevice physicalDevice,
+                             vk::CommandBuffer commandBuffer,
+                             const CookedTexture::Image& mips)
+{
+    // left from a stream-in the streamer dropped on Reset, its copy has finished since
+    DestroyStreamIn();
 
-    vk::SamplerCreateInfo samplerInfo{};
-    samplerInfo.setMagFilter(creationInfo.textureSampler.magFilter);
-    samplerInfo.setMinFilter(creationInfo.textureSampler.minFilter);
-    samplerInfo.setMipmapMode(vk::SamplerMipmapMode::eLinear);
-    samplerInfo.setAddressModeU(creationInfo.textureSampler.addressModeU);
-    samplerInfo.setAddressModeV(creationInfo.textureSampler.addressModeV);
-    samplerInfo.setAddressModeW(creationInfo.textureSampler.addressModeW);
-    samplerInfo.setCompareOp(vk::CompareOp::eNever);
-    samplerInfo.setBorderColor(vk::BorderColor::eFloatOpaqueWhite);
-    samplerInfo.setMaxLod(static_cast<float>(mipLevels));
-    samplerInfo.setMaxAnisotropy(8.0f);
-    samplerInfo.setAnisotropyEnable(VK_TRUE);
-    CheckVkResult(logicalDevice.createSampler(&samplerInfo, nullptr, &sampler));
+    const uint32_t newResidentMip = mips.firstMip;
+    if (!loadedToGpu || newResidentMip >= residentMip ||
+        mips.mipLevels.size() < residentMip - newResidentMip)
+    {
+        EZASSERT(false, "Streamed mips don't extend the resident mip chain");
+        return false;
+    }
+    const uint32_t streamedMipsCount = residentMip - newResidentMip;
+    const uint32_t oldImageMipLevels = GetImageMipLevels();
+    const uint32_t newImageMipLevels = mipLevels - newResidentMip;
+
+    // decoded like the mips uploaded by LoadToGpu
+    std::vector<CookedTexture::MipLevel> mipLevelsToCopy = mips.mipLevels;
+    const bool decodeMips =
+        IsBlockCompressed(creationInfo.format) && !IsBlockCompressed(format);
+    const std::vector<uint8_t> decodedMipsData =
+        decodeMips ? DecodeBlockCompressedMips(creationInfo.format, mips.data, mipLevelsToCopy)
+                   : std::vector<uint8_t>{};
+    const std::vector<uint8_t>& mipsData = decodeMips ? decodedMipsData : mips.data;
+
+    ResultValue<ImageWithMemory> imageRV =
+        Image::CreateImage2DWithMemory(logicalDevice,
+                                       physicalDevice,
+                                       format,
+                                       GetImageUsage(false, false),
+                                       newImageMipLevels,
+                                       std::max(width >> newResidentMip, 1u),
+                                       std::max(height >> newResidentMip, 1u),
+                                       imageLayersCount,
+                                       GetImageCreateFlags(),
+                                       vk::SampleCountFlagBits::e1,
+                                       creationInfo.sharingQueueFamilies);
+    if (imageRV.result != GraphicsResult::Ok) { return false; }
+
+    const vk::Image newImage = imageRV.value.image;
 
     vk::ImageViewType imageViewType =
         creationInfo.IsCubemap() ? vk::ImageViewType::eCube : vk::ImageViewType::e2D;
     ResultValue<vk::ImageView> imageViewRV =
         Image::CreateImageView(imageViewType,
                                logicalDevice,
-                               image,
+                               newImage,
                                format,
                                vk::ImageAspectFlagBits::eColor,
                                imageLayersCount,
-                               mipLevels);
-    if (imageViewRV.result != GraphicsResult::Ok) { return false; }
+                               newImageMipLevels);
+    if (imageViewRV.result != GraphicsResult::Ok)
+    {
+        logicalDevice.destroyImage(newImage);
+        logicalDevice.freeMemory(imageRV.value.imageMemory);
+        return false;
+    }
 
-    descriptor.sampler = sampler;
-    descriptor.imageView = imageViewRV.value;
-    descriptor.imageLayout = imageLayout;
+    const StagingBuffer staging = CreateStagingBuffer(
+        logicalDevice, physicalDevice, mipsData.size(), [&](uint8_t* data) {
+            memcpy(data, mipsData.data(), mipsData.size());
+        });
+
+    streamIn.image = newImage;
+    streamIn.imageMemory = imageRV.value.imageMemory;
+    streamIn.imageView = imageViewRV.value;
+    streamIn.stagingBuffer = staging.buffer;
+    streamIn.stagingMemory = staging.memory;
+    streamIn.residentMip = newResidentMip;
+
+    vk::ImageSubresourceRange newRange = {};
+    newRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
+    newRange.setLevelCount(newImageMipLevels);
+    newRange.setLayerCount(imageLayersCount);
+    vk::ImageSubresourceRange oldRange = newRange;
+    oldRange.setLevelCount(oldImageMipLevels);
+
+    ez::Image::SubmitChangeImageLayout(commandBuffer,
+                                       vk::PipelineStageFlagBits::eAllCommands,
+                                       vk::PipelineStageFlagBits::eAllCommands,
+                                       newImage,
+                                       newRange,
+                                       vk::ImageLayout::eUndefined,
+                                       vk::ImageLayout::eTransferDstOptimal,
+                                       vk::AccessFlags{},
+                                       vk::AccessFlagBits::eTransferWrite);
+    ez::Image::SubmitChangeImageLayout(commandBuffer,
+                                       vk::PipelineStageFlagBits::eAllCommands,
+                                       vk::PipelineStageFlagBits::eAllCommands,
+                                       image,
+                                       oldRange,
+                                       vk::ImageLayout::eShaderReadOnlyOptimal,
+                                       vk::ImageLayout::eTransferSrcOptimal,
+                                       vk::AccessFlagBits::eShaderRead,
+                                       vk::AccessFlagBits::eTransferRead);
 
-    loadedToGpu = true;
+    // new finer mips come from the staging buffer, already resident ones are copied over
+    std::vector<vk::BufferImageCopy> bufferCopyRegions;
+    for (uint32_t mip = 0; mip < streamedMipsCount; ++mip)
+    {
+        const CookedTexture::MipLevel& mipLevel = mipLevelsToCopy[mip];
+        vk::BufferImageCopy& region = bufferCopyRegions.emplace_back();
+        region.setBufferOffset(mipLevel.offset);
+        region.imageSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
+        region.imageSubresource.setMipLevel(mip);
+        region.imageSubresource.setBaseArrayLayer(0);
+        region.imageSubresource.setLayerCount(imageLayersCount);
+        region.imageExtent.setWidth(mipLevel.width);
+        region.imageExtent.setHeight(mipLevel.height);
+        region.imageExtent.setDepth(1);
+    }
+    commandBuffer.copyBufferToImage(staging.buffer,
+                                    newImage,
+                                    vk::ImageLayout::eTransferDstOptimal,
+                                    static_cast<uint32_t>(bufferCopyRegions.size()),
+                                    bufferCopyRegions.data());
+
+    std::vector<vk::ImageCopy> imageCopyRegions;
+    for (uint32_t mip = 0; mip < oldImageMipLevels; ++mip)
+    {
+        vk::ImageCopy& region = imageCopyRegions.emplace_back();
+        region.srcSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
+        region.srcSubresource.setMipLevel(mip);
+        region.srcSubresource.setLayerCount(imageLayersCount);
+        region.dstSubresource = region.srcSubresource;
+        region.dstSubresource.setMipLevel(mip + streamedMipsCount);
+        region.extent.setWidth(std::max(width >> (residentMip + mip), 1u));
+        region.extent.setHeight(std::max(height >> (residentMip + mip), 1u));
+        region.extent.setDepth(1);
+    }
+    commandBuffer.copyImage(image,
+                            vk::ImageLayout::eTransferSrcOptimal,
+                            newImage,
+                            vk::ImageLayout::eTransferDstOptimal,
+                            static_cast<uint32_t>(imageCopyRegions.size()),
+                            imageCopyRegions.data());
+
+    ez::Image::SubmitChangeImageLayout(commandBuffer,
+                                       vk::PipelineStageFlagBits::eAllCommands,
+                                       vk::PipelineStageFlagBits::eAllCommands,
+                                       newImage,
+                                       newRange,
+                                       vk::ImageLayout::eTransferDstOptimal,
+                                       vk::ImageLayout::eShaderReadOnlyOptimal,
+                                       vk::AccessFlagBits::eTransferWrite,
+                                       vk::AccessFlagBits::eShaderRead);
+    // frames submitted after the copy keep sampling the old image until FinishStreamIn
+    ez::Image::SubmitChangeImageLayout(commandBuffer,
+                                       vk::PipelineStageFlagBits::eAllCommands,
+                                       vk::PipelineStageFlagBits::eAllCommands,
+                                       image,
+                                       oldRange,
+                                       vk::ImageLayout::eTransferSrcOptimal,
+                                       vk::ImageLayout::eShaderReadOnlyOptimal,
+                                       vk::AccessFlagBits::eTransferRead,
+                                       vk::AccessFlagBits::eShaderRead);
     return true;
 }
 
+Texture::RetiredImage Texture::FinishStreamIn()
+{
+    EZASSERT(IsStreamingIn(), "No stream-in was recorded for the texture");
+
+    // the copy has finished, but frames recorded before may still sample the old image
+    const RetiredImage retiredImage{ image, deviceMemory, descriptor.imageView };
+    logicalDevice.destroyBuffer(streamIn.stagingBuffer);
+    logicalDevice.freeMemory(streamIn.stagingMemory);
+
+    image = streamIn.image;
+    deviceMemory = streamIn.imageMemory;
+    gpuBytes = logicalDevice.getImageMemoryRequirements(image).size;
+    descriptor.imageView = streamIn.imageView;
+    residentMip = streamIn.residentMip;
+    streamIn = {};
+    return retiredImage;
+}
+
+void Texture::DestroyStreamIn()
+{
+    if (!IsStreamingIn()) { return; }
+
+    logicalDevice.destroyImageView(streamIn.imageView);
+    logicalDevice.destroyImage(streamIn.image);
+    logicalDevice.freeMemory(streamIn.imageMemory);
+    logicalDevice.destroyBuffer(streamIn.stagingBuffer);
+    logicalDevice.freeMemory(streamIn.stagingMemory);
+    streamIn = {};
+}
+
+vk::ImageUsageFlags Texture::GetImageUsage(bool generateMips, bool computeMips) const
+{
+    vk::ImageUsageFlags imageUsage = vk::ImageUsageFlagBits::eSampled | creationInfo.extraUsage;
+    if (!creationInfo.IsGpuOnly()) { imageUsage |= vk::ImageUsageFlagBits::eTransferDst; }
+    // mips are written by a compute pass or blitted from mip 0,
+    // streamed images are copied into a bigger one
+    if (computeMips) { imageUsage |= vk::ImageUsageFlagBits::eStorage; }
+    if ((generateMips && !computeMips) || creationInfo.IsStreamed())
+    {
+        imageUsage |= vk::ImageUsageFlagBits::eTransferSrc;
+    }
+    return imageUsage;
+}
+
+vk::ImageCreateFlags Texture::GetImageCreateFlags() const
+{
+    return creationInfo.IsCubemap() ? vk::ImageCreateFlagBits::eCubeCompatible
+                                    : vk::ImageCreateFlags{};
+}
+
+TextureResidency Texture::GetResidency() const
+{
+    if (!loadedToGpu) { return TextureResidency::eCpu; }
+    return creationInfo.buffer.empty() ? TextureResidency::eGpu : TextureResidency::eCpuAndGpu;
+}
+
+void Texture::ReleaseCpuData()
+{
+    // swap with empty containers, clear() alone keeps the capacity allocated
+    std::vector<uint8_t>().swap(creationInfo.buffer);
+    std::vector<TextureCreationInfo::MipRegion>().swap(creationInfo.precomputedMips);
+}
+
 Texture::~Texture() { Destroy(); }
 
 void Texture::Destroy()
 {
     if (logicalDevice)
     {
+        // normally finished by the streamer, a texture destroyed earlier waits for its copy
+        if (IsStreamingIn())
+        {
+            CheckVkResult(logicalDevice.waitIdle());
+            DestroyStreamIn();
+        }
         logicalDevice.destroyImageView(descriptor.imageView);
         logicalDevice.destroyImage(image);
         logicalDevice.freeMemory(deviceMemory);
-        logicalDevice.destroySampler(sampler);
     }
 }
 
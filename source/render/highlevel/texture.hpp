@@ -1,15 +1,46 @@
 #pragma once
 
+#include <memory>
+#include <string>
 #include <vector>
 
+#include "core/cooked_texture.hpp"
 #include "render/highlevel/texture_sampler.hpp"
 #include "render/vulkan_include.hpp"
 
 namespace ez
 {
+class MipGenerator;
+class VulkanSamplerCache;
+
+// what happens to the CPU copy of texture data once it is uploaded to GPU
+enum class TextureCpuDataPolicy : uint8_t
+{
+    eReleaseAfterUpload = 0,
+    eKeep = 1,  // for textures that may need to be re-uploaded without reloading the source
+};
+
+enum class TextureResidency : uint8_t
+{
+    eCpu = 0,
+    eCpuAndGpu = 1,
+    eGpu = 2,
+};
+
+const char* ToString(TextureResidency residency);
+
 struct TextureCreationInfo final
 {
-    static TextureCreationInfo CreateFromData(uint8_t* data,
+    static TextureCreationInfo CreateFromData(const uint8_t* data,
+                                              uint32_t width,
+                                              uint32_t height,
+                                              uint32_t colorChannelsCount,
+                                              uint32_t imageLayersCount,
+                                              bool needMips,
+                                              const TextureSampler& textureSampler);
+
+    // zero-copy when data is already RGBA8, otherwise expanded like the overload above
+    static TextureCreationInfo CreateFromData(std::vector<uint8_t>&& data,
                                               uint32_t width,
                                               uint32_t height,
                                               uint32_t colorChannelsCount,
@@ -17,13 +48,47 @@ struct TextureCreationInfo final
                                               bool needMips,
                                               const TextureSampler& textureSampler);
 
-    static TextureCreationInfo CreateHdrFromData(float* data,
+    // stored as RGBA16F, see packHdrIfSupported
+    static TextureCreationInfo CreateHdrFromData(const float* data,
                                                  uint32_t width,
                                                  uint32_t height,
                                                  uint32_t channelsCount,
                                                  const TextureSampler& textureSampler);
 
+    // takes RGBA16F data as is, e.g. from HdrDecoder
+    static TextureCreationInfo CreateHdrFromHalf(std::vector<uint8_t>&& rgbaHalf,
+                                                 uint32_t width,
+                                                 uint32_t height,
+                                                 const TextureSampler& textureSampler);
+
+    // takes a mip chain cooked offline by ez_cook, no mips are generated at load;
+    // a partially loaded chain (cookedImage.firstMip > 0) is uploaded as its smallest mips
+    static TextureCreationInfo CreateFromCooked(CookedTexture::Image&& cookedImage,
+                                                const TextureSampler& textureSampler);
+
+    // tightly packed mip chain, all layers of a mip are stored next to each other
+    static TextureCreationInfo CreateFromMipChain(vk::Format format,
+                                                  uint32_t texelSize,
+                                                  uint32_t width,
+                                                  uint32_t height,
+                                                  uint32_t imageLayersCount,
+                                                  uint32_t mipLevels,
+                                                  std::vector<uint8_t>&& data,
+                                                  const TextureSampler& textureSampler);
+
+    // nothing is uploaded, the image is filled on GPU (e.g. by a compute pass) after creation
+    static TextureCreationInfo CreateGpuOnly(vk::Format format,
+                                             uint32_t width,
+                                             uint32_t height,
+                                             uint32_t imageLayersCount,
+                                             bool needMips,
+                                             vk::ImageUsageFlags gpuUsage,
+                                             const TextureSampler& textureSampler);
+
     bool IsValid() const;
+    bool IsGpuOnly() const { return gpuOnly; }
+    bool HasPrecomputedMips() const { return !precomputedMips.empty(); }
+    bool IsStreamed() const { return !streamingSourcePath.empty(); }
 
     void SetIsCubemap(bool value) { isCubemap = value; }
     bool IsCubemap() const { return isCubemap; }
@@ -33,6 +98,13 @@ struct TextureCreationInfo final
 
     // CPU data to load to GPU
     std::vector<uint8_t> buffer;
+    // RGBA16F data without meaningful alpha may be uploaded as B10G11R11
+    bool packHdrIfSupported = false;
+    // usage on top of sampling, e.g. storage for textures written by compute
+    vk::ImageUsageFlags extraUsage{};
+    // queue families that access the image, it is created with concurrent sharing if > 1
+    std::vector<uint32_t> sharingQueueFamilies;
+    TextureCpuDataPolicy cpuDataPolicy = TextureCpuDataPolicy::eReleaseAfterUpload;
     TextureSampler textureSampler;
 
     // other
@@ -40,9 +112,28 @@ struct TextureCreationInfo final
     uint32_t height = 0;
     uint32_t imageLayersCount = 1;
     uint32_t mipLevels = 0;
+    // mips before firstMip are not in buffer, only streaming can bring them to GPU later
+    uint32_t firstMip = 0;
+    // cooked file the missing mips are read from, see TextureStreamer
+    std::string streamingSourcePath;
+
+    // location of mips [firstMip, mipLevels) in buffer, filled only for precomputed chains
+    struct MipRegion final
+    {
+        uint64_t offset = 0;
+        uint32_t width = 0;
+        uint32_t height = 0;
+    };
+    std::vector<MipRegion> precomputedMips;
 
    private:
+    void SetDimensions(uint32_t aWidth,
+                       uint32_t aHeight,
+                       uint32_t aImageLayersCount,
+                       bool needMips);
+
     bool isCubemap = false;
+    bool gpuOnly = false;
 };
 
 class Texture
@@ -52,10 +143,59 @@ class Texture
     ~Texture();
 
     bool IsLoadedToGPU() const { return loadedToGpu; }
+    // mips are generated with mipGenerator if it supports the format, blitted otherwise
     bool LoadToGpu(vk::Device aLogicalDevice,
                    vk::PhysicalDevice physicalDevice,
                    vk::Queue graphicsQueue,
-                   vk::CommandPool graphicsCommandPool);
+                   vk::CommandPool graphicsCommandPool,
+                   VulkanSamplerCache& samplerCache,
+                   MipGenerator* mipGenerator = nullptr);
+
+    static bool IsFormatFilterable(vk::PhysicalDevice physicalDevice, vk::Format format);
+
+    // 1x1 (value, value, value, 255) texture loaded to GPU, stands in for missing material
+    // textures; null if the upload fails
+    static std::unique_ptr<Texture> CreateDefault(uint8_t value,
+                                                  vk::Device logicalDevice,
+                                                  vk::PhysicalDevice physicalDevice,
+                                                  vk::Queue graphicsQueue,
+                                                  vk::CommandPool graphicsCommandPool,
+                                                  VulkanSamplerCache& samplerCache);
+
+    // must be called before LoadToGpu
+    void SetSharingQueueFamilies(std::vector<uint32_t> queueFamilies)
+    {
+        creationInfo.sharingQueueFamilies = std::move(queueFamilies);
+    }
+
+    TextureResidency GetResidency() const;
+    uint64_t GetCpuBytes() const { return creationInfo.buffer.capacity(); }
+    uint64_t GetGpuBytes() const { return gpuBytes; }
+
+    bool IsStreamed() const { return creationInfo.IsStreamed(); }
+    const std::string& GetStreamingSourcePath() const
+    {
+        return creationInfo.streamingSourcePath;
+    }
+    // finest mip present on GPU, 0 once the texture is fully resident
+    uint32_t GetResidentMip() const { return residentMip; }
+
+    // records the fill of a new image that also holds mips [mips.firstMip, GetResidentMip()),
+    // resident mips are copied on GPU; the current image stays in use until FinishStreamIn
+    bool RecordStreamIn(vk::PhysicalDevice physicalDevice,
+                        vk::CommandBuffer commandBuffer,
+                        const CookedTexture::Image& mips);
+    // image replaced by a stream-in, frames submitted before the switch may still sample it
+    struct RetiredImage final
+    {
+        vk::Image image;
+        vk::DeviceMemory memory;
+        vk::ImageView imageView;
+    };
+    // the recorded commands have finished, the new image replaces the current one and
+    // descriptor gets its view; the caller destroys the returned one once no frame uses it
+    RetiredImage FinishStreamIn();
+    bool IsStreamingIn() const { return static_cast<bool>(streamIn.image); }
 
     vk::Image image;
     vk::ImageLayout imageLayout;
@@ -63,20 +203,47 @@ class Texture
 
     vk::DescriptorImageInfo descriptor;
     vk::Format format;
+    // owned by VulkanSamplerCache
     vk::Sampler sampler;
 
-    uint32_t width;
-    uint32_t height;
-    uint32_t mipLevels;
-    uint32_t imageLayersCount;
+    uint32_t width = 0;
+    uint32_t height = 0;
+    uint32_t mipLevels = 0;
+    uint32_t imageLayersCount = 0;
 
     bool loadedToGpu = false;
 
    private:
     void Destroy();
+    bool UploadPixels(vk::PhysicalDevice physicalDevice,
+                      vk::Queue graphicsQueue,
+                      vk::CommandPool graphicsCommandPool,
+                      bool packHdr,
+                      bool generateMips,
+                      MipGenerator* computeMipGenerator);
+    void ReleaseCpuData();
+    void DestroyStreamIn();
+
+    uint32_t GetImageMipLevels() const { return mipLevels - residentMip; }
+    vk::ImageUsageFlags GetImageUsage(bool generateMips, bool computeMips) const;
+    vk::ImageCreateFlags GetImageCreateFlags() const;
 
     TextureCreationInfo creationInfo;
     vk::Device logicalDevice;
+    uint64_t gpuBytes = 0;
+    uint32_t residentMip = 0;
+
+    // image being filled by a recorded stream-in, owned here until FinishStreamIn
+    struct StreamIn final
+    {
+        vk::Image image;
+        vk::DeviceMemory imageMemory;
+        vk::ImageView imageView;
+        vk::Buffer stagingBuffer;
+        vk::DeviceMemory stagingMemory;
+        uint32_t residentMip = 0;
+    };
+    StreamIn streamIn;
 };
 
 }  // namespace ez
@@ -56,4 +56,13 @@ TextureSampler TextureSampler::FromGltfSampler(int32_t gltfMagFilter,
 
     return sampler;
 }
+
+bool TextureSampler::operator==(const TextureSampler& other) const
+{
+    return magFilter == other.magFilter && minFilter == other.minFilter &&
+           addressModeU == other.addressModeU && addressModeV == other.addressModeV &&
+           addressModeW == other.addressModeW && mipmapMode == other.mipmapMode &&
+           maxAnisotropy == other.maxAnisotropy && minLod == other.minLod &&
+           maxLod == other.maxLod;
+}
 }  // namespace ez
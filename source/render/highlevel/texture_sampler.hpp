@@ -16,5 +16,14 @@ struct TextureSampler final
     vk::SamplerAddressMode addressModeU = vk::SamplerAddressMode::eRepeat;
     vk::SamplerAddressMode addressModeV = vk::SamplerAddressMode::eRepeat;
     vk::SamplerAddressMode addressModeW = vk::SamplerAddressMode::eRepeat;
+    vk::SamplerMipmapMode mipmapMode = vk::SamplerMipmapMode::eLinear;
+    // anisotropic filtering is disabled for values <= 1
+    float maxAnisotropy = 8.0f;
+    float minLod = 0.0f;
+    // image views limit the mips anyway, so one sampler serves textures with any mip count
+    float maxLod = VK_LOD_CLAMP_NONE;
+
+    bool operator==(const TextureSampler& other) const;
+    bool operator!=(const TextureSampler& other) const { return !(*this == other); }
 };
 }  // namespace ez
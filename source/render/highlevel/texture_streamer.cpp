@@ -0,0 +1,195 @@
+#include "texture_streamer.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "core/log_assert.hpp"
+
+namespace ez
+{
+TextureStreamer::TextureStreamer(vk::Device aLogicalDevice,
+                                 vk::PhysicalDevice aPhysicalDevice,
+                                 std::unique_ptr<VulkanAsyncSubmission> aUploads)
+    : logicalDevice(aLogicalDevice)
+    , physicalDevice(aPhysicalDevice)
+    , uploads(std::move(aUploads))
+{
+}
+
+TextureStreamer::~TextureStreamer() { FlushRetiredImages(); }
+
+ResultValue<std::unique_ptr<TextureStreamer>> TextureStreamer::Create(
+    vk::Device logicalDevice,
+    vk::PhysicalDevice physicalDevice,
+    vk::Queue graphicsQueue,
+    vk::CommandPool graphicsCommandPool)
+{
+    auto uploadsRV =
+        VulkanAsyncSubmission::Create(logicalDevice, graphicsQueue, graphicsCommandPool);
+    if (uploadsRV.result != GraphicsResult::Ok) { return uploadsRV.result; }
+
+    return { GraphicsResult::Ok,
+             std::make_unique<TextureStreamer>(
+                 logicalDevice, physicalDevice, std::move(uploadsRV.value)) };
+}
+
+void TextureStreamer::Reset()
+{
+    // the submission in flight may read textures that are destroyed already, so they are not
+    // touched; a texture that lives on discards its unfinished image on the next stream-in
+    FlushRetiredImages();
+    uploadingTextures.clear();
+
+    requestedMips.clear();
+    reads.clear();
+    failedTextures.clear();
+    uploadedBytes = 0;
+}
+
+void TextureStreamer::RequestMip(Texture& texture, uint32_t mip)
+{
+    if (!texture.IsStreamed() || !texture.IsLoadedToGPU()) { return; }
+
+    const auto [it, inserted] = requestedMips.emplace(&texture, mip);
+    if (!inserted) { it->second = std::min(it->second, mip); }
+}
+
+uint32_t TextureStreamer::GetPendingReadsCount() const
+{
+    return static_cast<uint32_t>(reads.size());
+}
+
+void TextureStreamer::IssueReads()
+{
+    for (const auto& [texture, mip] : requestedMips)
+    {
+        const uint32_t residentMip = texture->GetResidentMip();
+        if (mip >= residentMip || reads.count(texture) > 0 ||
+            uploadingTextures.count(texture) > 0 || failedTextures.count(texture) > 0)
+        {
+            continue;
+        }
+
+        // everything between the requested and the resident mip arrives in one image update
+        const std::string path = texture->GetStreamingSourcePath();
+        const uint32_t mipsCount = residentMip - mip;
+        reads[texture].pending = ioThread.Enqueue([path, mip = mip, mipsCount]() {
+            return CookedTexture::LoadMipRange(path, mip, mipsCount);
+        });
+    }
+}
+
+void TextureStreamer::FlushRetiredImages()
+{
+    uploads->WaitIdle();
+    uploads->Poll();
+    // an empty submission is enough, its fence covers the frames submitted before it
+    if (!retiredImages.empty())
+    {
+        uploads->Begin();
+        if (uploads->Submit())
+        {
+            uploads->WaitIdle();
+            uploads->Poll();
+        }
+        else { CheckVkResult(logicalDevice.waitIdle()); }
+    }
+    DestroyImages(retiringImages);
+    DestroyImages(retiredImages);
+}
+
+void TextureStreamer::DestroyImages(std::vector<Texture::RetiredImage>& images)
+{
+    for (const Texture::RetiredImage& image : images)
+    {
+        logicalDevice.destroyImageView(image.imageView);
+        logicalDevice.destroyImage(image.image);
+        logicalDevice.freeMemory(image.memory);
+    }
+    images.clear();
+}
+
+bool TextureStreamer::FinishUploads()
+{
+    if (!uploads->Poll()) { return false; }
+
+    DestroyImages(retiringImages);
+    for (Texture* texture : uploadingTextures)
+    {
+        retiredImages.push_back(texture->FinishStreamIn());
+    }
+    const bool viewsChanged = !uploadingTextures.empty();
+    uploadingTextures.clear();
+    return viewsChanged;
+}
+
+bool TextureStreamer::Update(uint64_t uploadBudgetBytes)
+{
+    const bool viewsChanged = FinishUploads();
+
+    IssueReads();
+    requestedMips.clear();
+    // finished reads wait until the submission in flight is done
+    if (uploads->IsBusy()) { return viewsChanged; }
+
+    // begun with the first upload of the frame
+    vk::CommandBuffer commandBuffer;
+    uint64_t frameBytes = 0;
+    for (auto it = reads.begin(); it != reads.end();)
+    {
+        Texture* texture = it->first;
+        MipsRead& read = it->second;
+        if (read.pending.valid())
+        {
+            if (read.pending.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+            {
+                ++it;
+                continue;
+            }
+            read.mips = read.pending.get();
+            if (!read.mips.has_value())
+            {
+                EZLOG("failed to stream texture mips:", texture->GetStreamingSourcePath());
+                failedTextures.insert(texture);
+                it = reads.erase(it);
+                continue;
+            }
+        }
+
+        // the first upload of a frame always goes through, otherwise a mip bigger than the
+        // budget would never become resident
+        const uint64_t mipsBytes = read.mips->data.size();
+        if (frameBytes > 0 && frameBytes + mipsBytes > uploadBudgetBytes)
+        {
+            ++it;
+            continue;
+        }
+
+        if (!commandBuffer) { commandBuffer = uploads->Begin(); }
+        if (texture->RecordStreamIn(physicalDevice, commandBuffer, *read.mips))
+        {
+            frameBytes += mipsBytes;
+            uploadingTextures.insert(texture);
+        }
+        else { failedTextures.insert(texture); }
+        it = reads.erase(it);
+    }
+
+    // replaced images are destroyed after the next submission even if nothing is uploaded
+    if (!commandBuffer && !retiredImages.empty()) { commandBuffer = uploads->Begin(); }
+    if (!commandBuffer) { return viewsChanged; }
+    if (!uploads->Submit())
+    {
+        // recorded images are released with their textures
+        failedTextures.merge(uploadingTextures);
+        uploadingTextures.clear();
+        return viewsChanged;
+    }
+
+    retiringImages.insert(retiringImages.end(), retiredImages.begin(), retiredImages.end());
+    retiredImages.clear();
+    uploadedBytes += frameBytes;
+    return viewsChanged;
+}
+
+}  // namespace ez
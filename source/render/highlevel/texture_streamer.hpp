@@ -0,0 +1,91 @@
+#pragma once
+
+#include <future>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "core/cooked_texture.hpp"
+#include "core/thread_pool.hpp"
+#include "render/graphics_result.hpp"
+#include "render/highlevel/texture.hpp"
+#include "render/vulkan/vulkan_async_submission.hpp"
+#include "render/vulkan_include.hpp"
+
+namespace ez
+{
+// Brings finer mips of streamed textures (see TextureCreationInfo::firstMip) to GPU on demand.
+// Mips requested during a frame are read from cooked files on a background I/O thread and
+// uploaded on the graphics queue, at most uploadBudgetBytes per Update. Uploads of one Update
+// go in a single submission that is never waited for, textures switch to their new images in
+// the first Update after it finishes. Replaced images are destroyed once the fence of the next
+// submission signals, it is submitted after every frame that may sample them.
+class TextureStreamer final
+{
+   public:
+    TextureStreamer() = delete;
+    TextureStreamer(const TextureStreamer&) = delete;
+
+    TextureStreamer(vk::Device aLogicalDevice,
+                    vk::PhysicalDevice aPhysicalDevice,
+                    std::unique_ptr<VulkanAsyncSubmission> aUploads);
+    ~TextureStreamer();
+
+    static ResultValue<std::unique_ptr<TextureStreamer>> Create(
+        vk::Device logicalDevice,
+        vk::PhysicalDevice physicalDevice,
+        vk::Queue graphicsQueue,
+        vk::CommandPool graphicsCommandPool);
+
+    // textures are about to be destroyed, e.g. on scene reload
+    void Reset();
+
+    // keeps the finest requested mip per texture until the next Update
+    void RequestMip(Texture& texture, uint32_t mip);
+
+    // returns true if any texture got a new image view, descriptor sets using it are stale
+    bool Update(uint64_t uploadBudgetBytes);
+
+    uint32_t GetPendingReadsCount() const;
+    uint64_t GetUploadedBytes() const { return uploadedBytes; }
+
+   private:
+    struct MipsRead final
+    {
+        std::future<std::optional<CookedTexture::Image>> pending;
+        std::optional<CookedTexture::Image> mips;
+    };
+
+    void IssueReads();
+    bool FinishUploads();
+    // waits until no frame uses the replaced images and destroys them
+    void FlushRetiredImages();
+    void DestroyImages(std::vector<Texture::RetiredImage>& images);
+
+    vk::Device logicalDevice;
+    vk::PhysicalDevice physicalDevice;
+    // one upload submission in flight at a time, on the graphics queue so that the images
+    // need no queue family ownership transfers
+    std::unique_ptr<VulkanAsyncSubmission> uploads;
+    // textures recorded into the submission in flight, their resident mip is not updated yet
+    std::unordered_set<Texture*> uploadingTextures;
+    // replaced since the last submission, go with the next one
+    std::vector<Texture::RetiredImage> retiredImages;
+    // destroyed when the submission in flight finishes
+    std::vector<Texture::RetiredImage> retiringImages;
+
+    std::unordered_map<Texture*, uint32_t> requestedMips;
+    // one read per texture at a time, finished reads wait here until the budget allows upload
+    std::unordered_map<Texture*, MipsRead> reads;
+    // textures whose cooked file could not be read, they stay at their resident mip
+    std::unordered_set<Texture*> failedTextures;
+
+    uint64_t uploadedBytes = 0;
+
+    // reads only touch their own captures, so dropping a future never blocks on the thread
+    ThreadPool ioThread{ 1 };
+};
+
+}  // namespace ez
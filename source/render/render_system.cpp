@@ -5,6 +5,9 @@
 
 #include <algorithm>
 #include <cassert>
+#include <chrono>
+#include <cmath>
+#include <limits>
 
 #include "core/file_utils.hpp"
 #include "core/log_assert.hpp"
@@ -12,8 +15,10 @@
 #include "core/view.hpp"
 #include "render/config.hpp"
 #include "render/graphics_result.hpp"
+#include "render/vulkan/spirv_cache.hpp"
 #include "render/vulkan/utils.hpp"
 #include "render/vulkan/vulkan_buffer.hpp"
+#include "render/vulkan/vulkan_shader_compiler.hpp"
 
 namespace ez
 {
@@ -99,30 +104,102 @@ ResultValue<std::unique_ptr<RenderSystem>> RenderSystem::Create()
     }
     ci.globalUBO = *globalUBO;
 
-    // Create material image sampler descriptor sets
-    // clang-format off
-    const std::vector<vk::DescriptorSetLayoutBinding> setLayoutBindings = {
-        { 0, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr },
-        { 1, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr },
-        { 2, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr },
-        { 3, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr },
-        { 4, vk::DescriptorType::eCombinedImageSampler, 1, vk::ShaderStageFlagBits::eFragment, nullptr },
-    };
-    // clang-format on
-    vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
-    descriptorSetLayoutCI.pBindings = setLayoutBindings.data();
-    descriptorSetLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
-    auto rv =
-        ci.vulkanDevice->GetDevice().createDescriptorSetLayout(descriptorSetLayoutCI, nullptr);
-    if (rv.result == vk::Result::eSuccess) { ci.samplersDescriptorSetLayout = rv.value; }
-    else
+    ci.vulkanPipelineManager = std::make_unique<VulkanPipelineManager>(
+        ci.vulkanDevice->GetDevice(), ci.vulkanDevice->GetPipelineCache());
+    ci.vulkanSamplerCache = std::make_unique<VulkanSamplerCache>(ci.vulkanDevice->GetDevice());
+    ci.sceneDescriptorAllocator =
+        std::make_unique<VulkanDescriptorAllocator>(ci.vulkanDevice->GetDevice());
+
+    ci.defaultWhiteTexture = Texture::CreateDefault(255,
+                                                    ci.vulkanDevice->GetDevice(),
+                                                    ci.vulkanDevice->GetPhysicalDevice(),
+                                                    ci.vulkanDevice->GetGraphicsQueue(),
+                                                    ci.vulkanDevice->GetGraphicsCommandPool(),
+                                                    *ci.vulkanSamplerCache);
+    ci.defaultBlackTexture = Texture::CreateDefault(0,
+                                                    ci.vulkanDevice->GetDevice(),
+                                                    ci.vulkanDevice->GetPhysicalDevice(),
+                                                    ci.vulkanDevice->GetGraphicsQueue(),
+                                                    ci.vulkanDevice->GetGraphicsCommandPool(),
+                                                    *ci.vulkanSamplerCache);
+    if (!ci.defaultWhiteTexture || !ci.defaultBlackTexture)
     {
-        EZLOG("Failed to create samplers DescriptorSetLayout");
+        EZLOG("Failed to create default textures");
         return GraphicsResult::Error;
     }
 
-    ci.vulkanPipelineManager =
-        std::make_unique<VulkanPipelineManager>(ci.vulkanDevice->GetDevice());
+    auto mipGeneratorRV = MipGenerator::Create(ci.vulkanDevice->GetDevice(),
+                                               ci.vulkanDevice->GetPhysicalDevice(),
+                                               *ci.vulkanPipelineManager,
+                                               *ci.vulkanSamplerCache);
+    if (mipGeneratorRV.result != GraphicsResult::Ok)
+    {
+        EZLOG("Failed to create MipGenerator");
+        return mipGeneratorRV.result;
+    }
+    ci.mipGenerator = std::move(mipGeneratorRV.value);
+
+    if (Config::BindlessTexturesEnabled && ci.vulkanDevice->IsBindlessSupported())
+    {
+        auto bindlessMaterialsRV =
+            BindlessMaterials::Create(ci.vulkanDevice->GetDevice(),
+                                      ci.vulkanDevice->GetPhysicalDevice(),
+                                      ci.vulkanDevice->GetGraphicsQueue(),
+                                      ci.vulkanDevice->GetGraphicsCommandPool(),
+                                      *ci.vulkanSamplerCache);
+        // not fatal, materials get their own descriptor sets then
+        if (bindlessMaterialsRV.result == GraphicsResult::Ok)
+        {
+            ci.bindlessMaterials = std::move(bindlessMaterialsRV.value);
+        }
+        else { EZLOG("Bindless materials are not available"); }
+    }
+
+    auto envCubemapGeneratorRV =
+        EnvCubemapGenerator::Create(ci.vulkanDevice->GetDevice(),
+                                    ci.vulkanDevice->GetComputeQueue(),
+                                    ci.vulkanDevice->GetComputeCommandPool(),
+                                    *ci.vulkanPipelineManager);
+    if (envCubemapGeneratorRV.result != GraphicsResult::Ok)
+    {
+        EZLOG("Failed to create EnvCubemapGenerator");
+        return envCubemapGeneratorRV.result;
+    }
+    ci.envCubemapGenerator = std::move(envCubemapGeneratorRV.value);
+
+    auto iblBakerRV = IblBaker::Create({ ci.vulkanDevice->GetDevice(),
+                                         ci.vulkanDevice->GetPhysicalDevice(),
+                                         ci.vulkanDevice->GetGraphicsQueue(),
+                                         ci.vulkanDevice->GetGraphicsCommandPool(),
+                                         ci.vulkanDevice->GetComputeQueue(),
+                                         ci.vulkanDevice->GetComputeCommandPool(),
+                                         ci.vulkanDevice->GetQueueFamilyIndices(),
+                                         ci.vulkanSamplerCache.get() },
+                                       *ci.vulkanPipelineManager);
+    if (iblBakerRV.result != GraphicsResult::Ok)
+    {
+        EZLOG("Failed to create IblBaker");
+        return iblBakerRV.result;
+    }
+    ci.iblBaker = std::move(iblBakerRV.value);
+
+    auto textureStreamerRV =
+        TextureStreamer::Create(ci.vulkanDevice->GetDevice(),
+                                ci.vulkanDevice->GetPhysicalDevice(),
+                                ci.vulkanDevice->GetGraphicsQueue(),
+                                ci.vulkanDevice->GetGraphicsCommandPool());
+    if (textureStreamerRV.result != GraphicsResult::Ok)
+    {
+        EZLOG("Failed to create TextureStreamer");
+        return textureStreamerRV.result;
+    }
+    ci.textureStreamer = std::move(textureStreamerRV.value);
+
+    // embedded shaders are never read from files
+    if (Config::ShaderHotReloadEnabled && !SpirVShaderCompiler::UsesEmbeddedShaders())
+    {
+        ci.shaderWatcher = std::make_unique<FileWatcher>();
+    }
 
     ci.commandBuffers = CreateCommandBuffers(ci.vulkanDevice->GetDevice(),
                                              ci.vulkanDevice->GetGraphicsCommandPool(),
@@ -152,8 +229,17 @@ RenderSystem::RenderSystem(RenderSystemCreateInfo& ci)
     , vulkanSwapchain(std::move(ci.vulkanSwapchain))
     , vulkanRenderPass(std::move(ci.vulkanRenderPass))
     , vulkanPipelineManager(std::move(ci.vulkanPipelineManager))
+    , vulkanSamplerCache(std::move(ci.vulkanSamplerCache))
+    , sceneDescriptorAllocator(std::move(ci.sceneDescriptorAllocator))
+    , defaultWhiteTexture(std::move(ci.defaultWhiteTexture))
+    , defaultBlackTexture(std::move(ci.defaultBlackTexture))
+    , mipGenerator(std::move(ci.mipGenerator))
+    , bindlessMaterials(std::move(ci.bindlessMaterials))
+    , envCubemapGenerator(std::move(ci.envCubemapGenerator))
+    , iblBaker(std::move(ci.iblBaker))
+    , textureStreamer(std::move(ci.textureStreamer))
+    , shaderWatcher(std::move(ci.shaderWatcher))
     , globalUBO(std::move(ci.globalUBO))
-    , samplersDescriptorSetLayout(std::move(ci.samplersDescriptorSetLayout))
     , frameSemaphores(std::move(ci.frameSemaphores))
     , commandBuffers(std::move(ci.commandBuffers))
 {
@@ -276,7 +362,7 @@ bool RenderSystem::InitializeImGui(std::unique_ptr<VulkanDevice>& vulkanDevice,
     init_info.Device = vulkanDevice->GetDevice();
     init_info.QueueFamily = vulkanDevice->GetQueueFamilyIndices().graphicsFamily;
     init_info.Queue = vulkanDevice->GetGraphicsQueue();
-    init_info.PipelineCache = nullptr;
+    init_info.PipelineCache = vulkanDevice->GetPipelineCache();
     init_info.DescriptorPool = vulkanDevice->GetDescriptorPool();
     init_info.Allocator = nullptr;
     init_info.MinImageCount = 2;
@@ -320,7 +406,7 @@ bool RenderSystem::InitializeImGui(std::unique_ptr<VulkanDevice>& vulkanDevice,
     return true;
 }
 
-void RenderSystem::CleanupTotalPipeline()
+void RenderSystem::CleanupSwapchain()
 {
     EZASSERT(vulkanInstance);
     EZASSERT(vulkanDevice);
@@ -334,14 +420,17 @@ void RenderSystem::CleanupTotalPipeline()
                                      static_cast<uint32_t>(commandBuffers.size()),
                                      commandBuffers.data());
     commandBuffers = {};
-
-    vulkanPipelineManager.reset();
-    vulkanRenderPass.reset();
 }
 
-void RenderSystem::RecreateTotalPipeline()
+void RenderSystem::RecreateSwapchain()
 {
-    CleanupTotalPipeline();
+    // pipelines, layouts and scene resources don't depend on the swapchain extent, a resize
+    // keeps them all
+    const std::optional<vk::Format> oldImageFormat =
+        vulkanSwapchain ? std::optional(vulkanSwapchain->GetInfo().imageFormat) : std::nullopt;
+    const bool oldMsaa8xEnabled = vulkanSwapchain && vulkanSwapchain->GetInfo().msaa8xEnabled;
+
+    CleanupSwapchain();
 
     if (!vulkanDevice->IsMSAA8xSupported()) { Config::msaa8xEnabled = false; }
 
@@ -360,14 +449,25 @@ void RenderSystem::RecreateTotalPipeline()
     }
     vulkanSwapchain = std::move(vulkanSwapchainRV.value);
 
-    auto vulkanRenderPassRV = VulkanRenderPass::CreateRenderPass(
-        { vulkanDevice->GetDevice(), vulkanSwapchain->GetInfo().imageFormat });
-    if (vulkanRenderPassRV.result != GraphicsResult::Ok)
+    // attachments of the render pass changed, pipelines have to be created for the new one
+    if (oldImageFormat != vulkanSwapchain->GetInfo().imageFormat ||
+        oldMsaa8xEnabled != vulkanSwapchain->GetInfo().msaa8xEnabled)
     {
-        EZLOG("Failed to Recreate VulkanRenderPass");
-        return;
+        auto vulkanRenderPassRV = VulkanRenderPass::CreateRenderPass(
+            { vulkanDevice->GetDevice(), vulkanSwapchain->GetInfo().imageFormat });
+        if (vulkanRenderPassRV.result != GraphicsResult::Ok)
+        {
+            EZLOG("Failed to Recreate VulkanRenderPass");
+            return;
+        }
+        // the new pass may reuse the handle of the old one, its pipelines must not be found
+        if (vulkanRenderPass)
+        {
+            vulkanPipelineManager->ReleaseGraphicsPipelines(vulkanRenderPass->GetRenderPass());
+        }
+        vulkanRenderPass = std::move(vulkanRenderPassRV.value);
+        needRecreateSceneResources = true;
     }
-    vulkanRenderPass = std::move(vulkanRenderPassRV.value);
 
     GraphicsResult framebuffersResult =
         vulkanSwapchain->CreateFramebuffersForRenderPass(vulkanRenderPass->GetRenderPass());
@@ -377,15 +477,14 @@ void RenderSystem::RecreateTotalPipeline()
         return;
     }
 
-    EZASSERT(!vulkanPipelineManager);
-
-    vulkanPipelineManager = std::make_unique<VulkanPipelineManager>(GetDevice());
-
     EZASSERT(commandBuffers.empty());
     commandBuffers = CreateCommandBuffers(
         GetDevice(), vulkanDevice->GetGraphicsCommandPool(), GetSwapchainInfo());
+}
 
-    needRecreateSceneResources = true;
+bool RenderSystem::UsesBindlessMaterials(const Model& model) const
+{
+    return bindlessMaterials && !model.bindlessFragmentShaderName.empty();
 }
 
 void RenderSystem::UpdateGlobalUniforms(const std::unique_ptr<Camera>& camera)
@@ -393,19 +492,104 @@ void RenderSystem::UpdateGlobalUniforms(const std::unique_ptr<Camera>& camera)
     vk::Device logicalDevice = vulkanDevice->GetDevice();
 
     void* data;
-    GlobalUBO::Data globalUBOUpdatedData = { camera->GetViewMatrix(),
-                                             camera->GetProjectionMatrix(),
-                                             camera->GetViewProjectionMatrix() };
+    // kept on the CPU side too, texture streaming picks visible mips with it
+    globalUBO.data = { camera->GetViewMatrix(),
+                       camera->GetProjectionMatrix(),
+                       camera->GetViewProjectionMatrix() };
 
     CheckVkResult(logicalDevice.mapMemory(globalUBO.uniformBufferMemory,
                                           0,
                                           sizeof(GlobalUBO::Data),
                                           vk::MemoryMapFlags(),
                                           &data));
-    memcpy(data, &globalUBOUpdatedData, sizeof(globalUBOUpdatedData));
+    memcpy(data, &globalUBO.data, sizeof(GlobalUBO::Data));
     logicalDevice.unmapMemory(globalUBO.uniformBufferMemory);
 }
 
+// Materials with the same textures share one set, so the key is the textures, not descriptors:
+// streaming changes image views but keeps the sharing valid.
+bool RenderSystem::AllocateMaterialDescriptorSet(Material& material)
+{
+    const auto textureKey = [](const Texture* texture) {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(texture));
+    };
+    VulkanDescriptorAllocator::ContentKey contentKey;
+    if (material.type == MaterialType::eCubemap)
+    {
+        contentKey = { static_cast<uint64_t>(material.type),
+                       textureKey(material.cubemapTexture) };
+    }
+    else
+    {
+        contentKey = { static_cast<uint64_t>(material.type),
+                       textureKey(material.textures.baseColor),
+                       textureKey(material.textures.metallicRoughness),
+                       textureKey(material.textures.normal),
+                       textureKey(material.textures.occlusion),
+                       textureKey(material.textures.emission) };
+    }
+
+    // the layout is reflected from the material shaders
+    bool isNew = false;
+    material.descriptorSet = sceneDescriptorAllocator->AllocateShared(
+        material.graphicsPipeline->GetDescriptorSetLayout(1), contentKey, isNew);
+    if (!material.descriptorSet)
+    {
+        EZLOG("Failed to allocate material descriptor set");
+        return false;
+    }
+    if (isNew) { WriteMaterialDescriptorSet(material); }
+    return true;
+}
+
+void RenderSystem::WriteMaterialDescriptorSet(const Material& material)
+{
+    if (material.type == MaterialType::eCubemap)
+    {
+        vk::WriteDescriptorSet writeDescriptorSet{};
+        writeDescriptorSet.descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        writeDescriptorSet.descriptorCount = 1;
+        writeDescriptorSet.dstSet = material.descriptorSet;
+        writeDescriptorSet.dstBinding = 0;
+        writeDescriptorSet.pImageInfo = &material.cubemapTexture->descriptor;
+        GetDevice().updateDescriptorSets(1, &writeDescriptorSet, 0, nullptr);
+        return;
+    }
+
+    // the defaults of the bindless material table, except for emission
+    const auto descriptorOr = [](const Texture* texture, const Texture& defaultTexture) {
+        return texture ? texture->descriptor : defaultTexture.descriptor;
+    };
+    const std::vector<vk::DescriptorImageInfo> imageDescriptors = {
+        descriptorOr(material.textures.baseColor, *defaultWhiteTexture),
+        descriptorOr(material.textures.metallicRoughness, *defaultBlackTexture),
+        descriptorOr(material.textures.normal, *defaultWhiteTexture),
+        descriptorOr(material.textures.occlusion, *defaultWhiteTexture),
+        descriptorOr(material.textures.emission, *defaultBlackTexture)
+    };
+
+    std::vector<vk::WriteDescriptorSet> writeDescriptorSets{};
+    for (size_t i = 0; i < imageDescriptors.size(); i++)
+    {
+        // textures the shader doesn't sample are not in the layout
+        if (!material.graphicsPipeline->HasDescriptorBinding(1, static_cast<uint32_t>(i)))
+        {
+            continue;
+        }
+        writeDescriptorSets.emplace_back();
+        writeDescriptorSets.back().descriptorType = vk::DescriptorType::eCombinedImageSampler;
+        writeDescriptorSets.back().descriptorCount = 1;
+        writeDescriptorSets.back().dstSet = material.descriptorSet;
+        writeDescriptorSets.back().dstBinding = static_cast<uint32_t>(i);
+        writeDescriptorSets.back().pImageInfo = &imageDescriptors[i];
+    }
+
+    GetDevice().updateDescriptorSets(static_cast<uint32_t>(writeDescriptorSets.size()),
+                                     writeDescriptorSets.data(),
+                                     0,
+                                     nullptr);
+}
+
 void RenderSystem::PrepareToRender(std::shared_ptr<Scene> scene)
 {
     if (needRecreateSceneResources)
@@ -415,160 +599,422 @@ void RenderSystem::PrepareToRender(std::shared_ptr<Scene> scene)
     }
     if (scene->ReadyToRender()) { return; }
 
+    // streaming requests may point to textures of the previous scene
+    textureStreamer->Reset();
+    // previous frame is finished, sets of the previous scene are not in use anymore
+    sceneDescriptorAllocator->Reset();
+    if (bindlessMaterials) { bindlessMaterials->Reset(); }
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point prepareStart = Clock::now();
+    // shaders are compiled and pipelines created on workers, the frame doesn't wait for them
+    pendingPipelines.clear();
+    pendingPipelinesStart = prepareStart;
+    if (Config::PendingPipelinesPolicy == Config::PendingPipelinePolicy::eDrawFallback)
+    {
+        // tiny and cached by the manager, waiting for it is cheap
+        auto fallbackPipelineRV = vulkanPipelineManager->CreateGraphicsPipeline(
+            vulkanRenderPass->GetRenderPass(),
+            { globalUBO.descriptorSetLayout },
+            eVertexLayout::vlPosition,
+            vk::CompareOp::eLess,
+            sfNone,
+            "fallback.vert",
+            "fallback.frag");
+        EZASSERT((fallbackPipelineRV.result == GraphicsResult::Ok),
+                 "Failed to create fallback graphics pipeline");
+        fallbackPipeline = fallbackPipelineRV.value;
+    }
+
     // todo: cleanup old scene models
     std::vector<Model>& sceneModels = scene->GetModelsMutable();
     bool modelsCreateSuccess = true;
     for (Model& model : sceneModels)
     {
         model.SetLogicalDevice(GetDevice());
-        modelsCreateSuccess |= model.CreateVertexBuffers(
+
+        const bool bindless = UsesBindlessMaterials(model);
+        const bool hasCubemap =
+            std::any_of(model.materials.begin(), model.materials.end(), [](const Material& m) {
+                return m.type == MaterialType::eCubemap && m.cubemapTexture != nullptr;
+            });
+        // the bindless set needs binding flags, the material set is reflected otherwise
+        const std::vector<vk::DescriptorSetLayout> descriptorSetLayouts = {
+            globalUBO.descriptorSetLayout,
+            bindless ? bindlessMaterials->GetDescriptorSetLayout() : vk::DescriptorSetLayout{}
+        };
+        // materials with the same features share a pipeline through the manager
+        for (Material& material : model.materials)
+        {
+            // sets of the previous preparation were freed by the allocator reset
+            material.graphicsPipeline = nullptr;
+            material.descriptorSet = nullptr;
+            pendingPipelines.push_back(
+                { &material,
+                  bindless,
+                  vulkanPipelineManager->CreateGraphicsPipelineAsync(
+                      vulkanRenderPass->GetRenderPass(),
+                      descriptorSetLayouts,
+                      model.GetVertexLayout(),
+                      hasCubemap ? vk::CompareOp::eLessOrEqual : vk::CompareOp::eLess,
+                      material.GetShaderPermutation(),
+                      model.vertexShaderName,
+                      bindless ? model.bindlessFragmentShaderName
+                               : model.fragmentShaderName) });
+        }
+
+        modelsCreateSuccess &= model.CreateVertexBuffers(
             GetPhysicalDevice(), GetGraphicsQueue(), vulkanDevice->GetGraphicsCommandPool());
 
+        // panorama -> cubemap conversion runs on the compute queue once textures are loaded
+        std::vector<std::pair<Texture*, Texture*>> envCubemapsToGenerate;
+        if (model.GetType() == Model::eType::Cubemap)
+        {
+            const QueueFamilyIndices& families = vulkanDevice->GetQueueFamilyIndices();
+            for (Material& material : model.materials)
+            {
+                Texture* panorama = material.panoramaTexture;
+                Texture* cubemap = material.cubemapTexture;
+                if (panorama == nullptr || cubemap == nullptr || cubemap->IsLoadedToGPU())
+                {
+                    continue;
+                }
+                if (families.graphicsFamily != families.computeFamily)
+                {
+                    panorama->SetSharingQueueFamilies(
+                        { families.graphicsFamily, families.computeFamily });
+                    cubemap->SetSharingQueueFamilies(
+                        { families.graphicsFamily, families.computeFamily });
+                }
+                envCubemapsToGenerate.emplace_back(panorama, cubemap);
+            }
+        }
+
         for (Texture& tex : model.textures)
         {
             if (!tex.IsLoadedToGPU())
             {
-                modelsCreateSuccess |= tex.LoadToGpu(GetDevice(),
+                modelsCreateSuccess &= tex.LoadToGpu(GetDevice(),
                                                      GetPhysicalDevice(),
                                                      vulkanDevice->GetGraphicsQueue(),
-                                                     vulkanDevice->GetGraphicsCommandPool());
+                                                     vulkanDevice->GetGraphicsCommandPool(),
+                                                     *vulkanSamplerCache,
+                                                     mipGenerator.get());
             }
         }
 
-        vk::CompareOp depthCompareOp = vk::CompareOp::eLess;
+        for (const auto& [panorama, cubemap] : envCubemapsToGenerate)
+        {
+            modelsCreateSuccess &= envCubemapGenerator->Dispatch(*panorama, *cubemap) &&
+                                   iblBaker->Bake(model.GetFilePath(), *cubemap);
+        }
+
         for (Material& material : model.materials)
         {
-            if (material.type == MaterialType::eDefault &&
-                material.textures.baseColor != nullptr)
+            if (material.type == MaterialType::eDefault && bindless)
             {
-                vk::DescriptorSetAllocateInfo descriptorSetAllocInfo{};
-                descriptorSetAllocInfo.descriptorPool = vulkanDevice->GetDescriptorPool();
-                descriptorSetAllocInfo.pSetLayouts = &samplersDescriptorSetLayout;
-                descriptorSetAllocInfo.descriptorSetCount = 1;
-                CheckVkResult(GetDevice().allocateDescriptorSets(&descriptorSetAllocInfo,
-                                                                 &material.descriptorSet));
-                // todo: handle missing textures - create white and black tex
-                vk::DescriptorImageInfo defaultWhiteTexture =
-                    material.textures.baseColor->descriptor;
-                vk::DescriptorImageInfo defaultBlackTexture =
-                    material.textures.baseColor->descriptor;
-                const std::vector<vk::DescriptorImageInfo> imageDescriptors = {
-                    material.textures.baseColor ? material.textures.baseColor->descriptor
-                                                : defaultWhiteTexture,
-                    material.textures.metallicRoughness
-                        ? material.textures.metallicRoughness->descriptor
-                        : defaultBlackTexture,
-                    material.textures.normal ? material.textures.normal->descriptor
-                                             : defaultWhiteTexture,
-                    material.textures.occlusion ? material.textures.occlusion->descriptor
-                                                : defaultWhiteTexture,
-                    material.textures.emission ? material.textures.emission->descriptor
-                                               : defaultBlackTexture
-                };
-
-                std::vector<vk::WriteDescriptorSet> writeDescriptorSets{};
-                for (size_t i = 0; i < imageDescriptors.size(); i++)
-                {
-                    writeDescriptorSets.emplace_back();
-                    writeDescriptorSets.back().descriptorType =
-                        vk::DescriptorType::eCombinedImageSampler;
-                    writeDescriptorSets.back().descriptorCount = 1;
-                    writeDescriptorSets.back().dstSet = material.descriptorSet;
-                    writeDescriptorSets.back().dstBinding = static_cast<uint32_t>(i);
-                    writeDescriptorSets.back().pImageInfo = &imageDescriptors[i];
-                }
-
-                GetDevice().updateDescriptorSets(
-                    static_cast<uint32_t>(writeDescriptorSets.size()),
-                    writeDescriptorSets.data(),
-                    0,
-                    nullptr);
+                material.bindlessIndex = bindlessMaterials->AddMaterial(material);
             }
-            else if (material.type == MaterialType::eCubemap &&
-                     material.cubemapTexture != nullptr)
-            {
-                vk::DescriptorSetAllocateInfo descriptorSetAllocInfo{};
-                descriptorSetAllocInfo.descriptorPool = vulkanDevice->GetDescriptorPool();
-                descriptorSetAllocInfo.pSetLayouts = &samplersDescriptorSetLayout;
-                descriptorSetAllocInfo.descriptorSetCount = 1;
-                CheckVkResult(GetDevice().allocateDescriptorSets(&descriptorSetAllocInfo,
-                                                                 &material.descriptorSet));
-
-                const std::vector<vk::DescriptorImageInfo> imageDescriptors = {
-                    material.cubemapTexture->descriptor
-                };
-
-                std::vector<vk::WriteDescriptorSet> writeDescriptorSets{};
-                for (size_t i = 0; i < imageDescriptors.size(); i++)
-                {
-                    writeDescriptorSets.emplace_back();
-                    writeDescriptorSets.back().descriptorType =
-                        vk::DescriptorType::eCombinedImageSampler;
-                    writeDescriptorSets.back().descriptorCount = 1;
-                    writeDescriptorSets.back().dstSet = material.descriptorSet;
-                    writeDescriptorSets.back().dstBinding = static_cast<uint32_t>(i);
-                    writeDescriptorSets.back().pImageInfo = &imageDescriptors[i];
-                }
+        }
+    }
+    if (bindlessMaterials) { bindlessMaterials->Update(); }
 
-                GetDevice().updateDescriptorSets(
-                    static_cast<uint32_t>(writeDescriptorSets.size()),
-                    writeDescriptorSets.data(),
-                    0,
-                    nullptr);
+    // pipelines cached by the manager are ready already, no need to wait a frame for them
+    ResolvePendingPipelines();
 
-                depthCompareOp = vk::CompareOp::eLessOrEqual;
-            }
-            else
+    EZLOG("Scene prepared in",
+          std::chrono::duration<double, std::milli>(Clock::now() - prepareStart).count(),
+          "ms,",
+          pendingPipelines.size(),
+          "pipelines pending");
+    EZASSERT(modelsCreateSuccess);
+    scene->SetReadyToRender(true);
+}
+
+void RenderSystem::ResolvePendingPipelines()
+{
+    if (pendingPipelines.empty()) { return; }
+
+    // the previous frame is finished, materials may switch pipelines and sets here
+    bool resolvedAny = false;
+    for (auto it = pendingPipelines.begin(); it != pendingPipelines.end();)
+    {
+        if (it->pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        Material& material = *it->material;
+        material.graphicsPipeline = it->pipeline.get();
+        const bool bindless = it->bindless;
+        it = pendingPipelines.erase(it);
+        resolvedAny = true;
+        if (!material.graphicsPipeline)
+        {
+            EZLOG("Failed to create graphics pipeline for material");
+            continue;
+        }
+
+        // material set layouts come with the pipelines
+        if (bindless) { continue; }
+        // missing pbr textures are replaced with defaults, a missing cubemap can't be
+        const bool canWriteSet =
+            material.type == MaterialType::eDefault || material.cubemapTexture != nullptr;
+        // drawn with the fallback pipeline if its set can't be allocated
+        if (!canWriteSet || !AllocateMaterialDescriptorSet(material))
+        {
+            material.graphicsPipeline = nullptr;
+        }
+    }
+
+    if (!resolvedAny || !pendingPipelines.empty()) { return; }
+
+    // compare runs with and without Config::PipelineCachePath to see what the cache saves
+    EZLOG("Material pipelines ready in",
+          std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() -
+                                                    pendingPipelinesStart)
+              .count(),
+          "ms");
+    // shader files are known once their pipelines are compiled
+    if (shaderWatcher) { shaderWatcher->Watch(vulkanPipelineManager->GetShaderSourceFiles()); }
+}
+
+void RenderSystem::ReloadChangedShaders()
+{
+    if (!shaderWatcher) { return; }
+
+    const std::vector<std::string> changedFiles = shaderWatcher->PollChangedFiles();
+    if (!changedFiles.empty())
+    {
+        const uint32_t reloadsCount = vulkanPipelineManager->ReloadPipelines(changedFiles);
+        EZLOG(changedFiles.size(), "shader files changed, reloading pipelines:", reloadsCount);
+    }
+
+    // the previous frame is finished, pipelines swapped here are not in use by the GPU
+    const uint32_t pendingReloadsCount = vulkanPipelineManager->GetPendingReloadsCount();
+    vulkanPipelineManager->ApplyReloadedPipelines();
+    if (vulkanPipelineManager->GetPendingReloadsCount() < pendingReloadsCount)
+    {
+        // edited shaders may include new files, failed ones too
+        shaderWatcher->Watch(vulkanPipelineManager->GetShaderSourceFiles());
+    }
+}
+
+// Size in pixels of the bigger side of the screen rect covered by bb, nothing if bb is outside
+// of the view frustum.
+static std::optional<float> GetProjectedSize(const BoundingBox& bb,
+                                             const glm::mat4& modelViewProjection,
+                                             const glm::vec2& viewportSize)
+{
+    glm::vec2 ndcMin(std::numeric_limits<float>::max());
+    glm::vec2 ndcMax(std::numeric_limits<float>::lowest());
+    bool crossesNearPlane = false;
+    // bit per clip plane, stays set only if all corners are outside of that plane
+    uint32_t outsideAllCorners = 0b111111;
+    for (uint32_t i = 0; i < 8; ++i)
+    {
+        const glm::vec3 corner((i & 1) ? bb.max.x : bb.min.x,
+                               (i & 2) ? bb.max.y : bb.min.y,
+                               (i & 4) ? bb.max.z : bb.min.z);
+        const glm::vec4 clip = modelViewProjection * glm::vec4(corner, 1.0f);
+
+        uint32_t outside = 0;
+        if (clip.x < -clip.w) { outside |= 1 << 0; }
+        if (clip.x > clip.w) { outside |= 1 << 1; }
+        if (clip.y < -clip.w) { outside |= 1 << 2; }
+        if (clip.y > clip.w) { outside |= 1 << 3; }
+        if (clip.z < 0.0f) { outside |= 1 << 4; }
+        if (clip.z > clip.w) { outside |= 1 << 5; }
+        outsideAllCorners &= outside;
+
+        if (clip.w <= std::numeric_limits<float>::epsilon())
+        {
+            crossesNearPlane = true;
+            continue;
+        }
+        const glm::vec2 ndc = glm::vec2(clip) / clip.w;
+        ndcMin = glm::min(ndcMin, ndc);
+        ndcMax = glm::max(ndcMax, ndc);
+    }
+
+    if (outsideAllCorners != 0) { return {}; }
+    // the camera is inside or right next to the bounds, they may cover the whole screen
+    if (crossesNearPlane) { return std::max(viewportSize.x, viewportSize.y); }
+
+    ndcMin = glm::clamp(ndcMin, glm::vec2(-1.0f), glm::vec2(1.0f));
+    ndcMax = glm::clamp(ndcMax, glm::vec2(-1.0f), glm::vec2(1.0f));
+    const glm::vec2 size = (ndcMax - ndcMin) * 0.5f * viewportSize;
+    return std::max(size.x, size.y);
+}
+
+// Culls primitives against the view frustum and requests the mips the visible ones need.
+// Texel density is estimated assuming a texture is mapped once across the primitive bounds:
+// a texture N times bigger than the projected bounds is sampled from mip log2(N).
+static void RequestVisibleMipsRecursive(const std::unique_ptr<Node>& node,
+                                        const glm::mat4& viewProjection,
+                                        const glm::vec2& viewportSize,
+                                        TextureStreamer& textureStreamer)
+{
+    if (node->mesh)
+    {
+        const glm::mat4 modelViewProjection =
+            viewProjection * node->mesh->pushConstantsBlock.modelMatrix;
+        for (const std::unique_ptr<Primitive>& primitive : node->mesh->primitives)
+        {
+            if (!primitive->bb.valid) { continue; }
+            const std::optional<float> screenSize =
+                GetProjectedSize(primitive->bb, modelViewProjection, viewportSize);
+            if (!screenSize.has_value()) { continue; }
+
+            const Material::PbrTextures& textures = primitive->material.textures;
+            for (Texture* texture : { textures.baseColor,
+                                      textures.metallicRoughness,
+                                      textures.normal,
+                                      textures.occlusion,
+                                      textures.emission })
             {
-                // EZASSERT(false);
+                if (texture == nullptr || !texture->IsStreamed()) { continue; }
+
+                const float texelsPerPixel =
+                    static_cast<float>(std::max(texture->width, texture->height)) /
+                    std::max(screenSize.value(), 1.0f);
+                const uint32_t mip =
+                    texelsPerPixel > 1.0f
+                        ? static_cast<uint32_t>(std::floor(std::log2(texelsPerPixel)))
+                        : 0;
+                textureStreamer.RequestMip(*texture, std::min(mip, texture->mipLevels - 1));
             }
         }
+    }
 
-        std::vector<vk::DescriptorSetLayout> descriptorSetLayouts = {
-            globalUBO.descriptorSetLayout, samplersDescriptorSetLayout
-        };
-        auto vulkanGraphicsPipelineRV =
-            vulkanPipelineManager->CreateGraphicsPipeline(GetSwapchainInfo().extent,
-                                                          vulkanRenderPass->GetRenderPass(),
-                                                          descriptorSetLayouts,
-                                                          model.GetVertexLayout(),
-                                                          depthCompareOp,
-                                                          model.vertexShaderName,
-                                                          model.fragmentShaderName);
-        if (vulkanGraphicsPipelineRV.result != GraphicsResult::Ok)
+    for (const std::unique_ptr<Node>& child : node->children)
+    {
+        RequestVisibleMipsRecursive(child, viewProjection, viewportSize, textureStreamer);
+    }
+}
+
+void RenderSystem::StreamVisibleTextures(const std::shared_ptr<Scene>& scene)
+{
+    const vk::Extent2D& extent = GetViewportExtent();
+    const glm::vec2 viewportSize(static_cast<float>(extent.width),
+                                 static_cast<float>(extent.height));
+    for (const Model& model : scene->GetModels())
+    {
+        for (const std::unique_ptr<Node>& node : model.nodes)
         {
-            EZASSERT(false, "Failed to create graphics pipeline for model");
-            modelsCreateSuccess = false;
+            RequestVisibleMipsRecursive(
+                node, globalUBO.data.viewProjectionMatrix, viewportSize, *textureStreamer);
         }
-        else
+    }
+
+    // previous frame is finished, descriptor sets are not in use and can be rewritten
+    if (!textureStreamer->Update(Config::TextureStreamingUploadBudget)) { return; }
+    if (bindlessMaterials) { bindlessMaterials->RewriteTextureDescriptors(); }
+    for (Model& model : scene->GetModelsMutable())
+    {
+        for (const Material& material : model.materials)
         {
-            model.graphicsPipeline = vulkanGraphicsPipelineRV.value;
+            if (material.type == MaterialType::eDefault && material.descriptorSet)
+            {
+                WriteMaterialDescriptorSet(material);
+            }
         }
     }
-    EZASSERT(modelsCreateSuccess);
-    scene->SetReadyToRender(true);
 }
 
-static void DrawNodeRecursive(const Model& model,
-                              const std::unique_ptr<Node>& node,
-                              const vk::DescriptorSet& globalDescriptorSet,
-                              vk::CommandBuffer& curCb)
+namespace
 {
+struct DrawContext final
+{
+    vk::CommandBuffer commandBuffer;
+    vk::DescriptorSet globalDescriptorSet;
+    // null if the model doesn't use bindless materials
+    vk::DescriptorSet bindlessDescriptorSet;
+    // used by primitives whose material pipeline is not ready, null to skip them
+    const VulkanGraphicsPipeline* fallbackPipeline = nullptr;
+
+    vk::Pipeline boundPipeline;
+    vk::PipelineLayout boundLayout;
+    const Mesh* pushedMesh = nullptr;
+};
+}  // namespace
+
+// Material pipelines of a model share their layout, so sets are bound and the mesh matrix is
+// pushed again only when a primitive switches between them and the fallback pipeline. With
+// bindless materials primitives only push their material index.
+static void DrawNodeRecursive(const std::unique_ptr<Node>& node, DrawContext& context)
+{
+    vk::CommandBuffer& curCb = context.commandBuffer;
     if (node->mesh)
     {
         for (const std::unique_ptr<Primitive>& primitive : node->mesh->primitives)
         {
-            curCb.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
-                                     model.graphicsPipeline->GetPipelineLayout(),
-                                     0,
-                                     { globalDescriptorSet, primitive->material.descriptorSet },
-                                     {});
+            const VulkanGraphicsPipeline* materialPipeline =
+                primitive->material.graphicsPipeline.get();
+            const VulkanGraphicsPipeline* pipeline =
+                materialPipeline ? materialPipeline : context.fallbackPipeline;
+            if (!pipeline) { continue; }
+
+            if (pipeline->GetPipeline() != context.boundPipeline)
+            {
+                context.boundPipeline = pipeline->GetPipeline();
+                curCb.bindPipeline(vk::PipelineBindPoint::eGraphics, context.boundPipeline);
+            }
+
+            const vk::PipelineLayout pipelineLayout = pipeline->GetPipelineLayout();
+            if (pipelineLayout != context.boundLayout)
+            {
+                // push constant ranges differ, nothing bound or pushed carries over
+                context.boundLayout = pipelineLayout;
+                context.pushedMesh = nullptr;
+                if (!materialPipeline)
+                {
+                    curCb.bindDescriptorSets(vk::PipelineBindPoint::eGraphics,
+                                             pipelineLayout,
+                                             0,
+                                             { context.globalDescriptorSet },
+                                             {});
+                }
+                else if (context.bindlessDescriptorSet)
+                {
+                    curCb.bindDescriptorSets(
+                        vk::PipelineBindPoint::eGraphics,
+                        pipelineLayout,
+                        0,
+                        { context.globalDescriptorSet, context.bindlessDescriptorSet },
+                        {});
+                }
+            }
 
-            curCb.pushConstants(model.graphicsPipeline->GetPipelineLayout(),
-                                vk::ShaderStageFlagBits::eVertex,
-                                0,
-                                Mesh::PushConstantsBlockSize,
-                                &node->mesh->pushConstantsBlock);
+            if (context.pushedMesh != node->mesh.get() &&
+                pipeline->HasPushConstants(vk::ShaderStageFlagBits::eVertex))
+            {
+                context.pushedMesh = node->mesh.get();
+                curCb.pushConstants(pipelineLayout,
+                                    vk::ShaderStageFlagBits::eVertex,
+                                    0,
+                                    Mesh::PushConstantsBlockSize,
+                                    &node->mesh->pushConstantsBlock);
+            }
+
+            if (materialPipeline && context.bindlessDescriptorSet)
+            {
+                curCb.pushConstants(pipelineLayout,
+                                    vk::ShaderStageFlagBits::eFragment,
+                                    Mesh::MaterialIndexPushConstantOffset,
+                                    Mesh::MaterialIndexPushConstantSize,
+                                    &primitive->material.bindlessIndex);
+            }
+            else if (materialPipeline)
+            {
+                curCb.bindDescriptorSets(
+                    vk::PipelineBindPoint::eGraphics,
+                    pipelineLayout,
+                    0,
+                    { context.globalDescriptorSet, primitive->material.descriptorSet },
+                    {});
+            }
 
             curCb.drawIndexed(primitive->indexCount, 1, 0, 0, 0);
         }
@@ -576,10 +1022,95 @@ static void DrawNodeRecursive(const Model& model,
 
     for (const std::unique_ptr<Node>& child : node->children)
     {
-        DrawNodeRecursive(model, child, globalDescriptorSet, curCb);
+        DrawNodeRecursive(child, context);
     }
 }
 
+void RenderSystem::DrawStatsWindow(const std::shared_ptr<Scene>& scene)
+{
+    constexpr double BytesInMb = 1024.0 * 1024.0;
+
+    uint64_t totalCpuBytes = 0;
+    uint64_t totalGpuBytes = 0;
+    for (const Model& model : scene->GetModels())
+    {
+        for (const Texture& tex : model.textures)
+        {
+            totalCpuBytes += tex.GetCpuBytes();
+            totalGpuBytes += tex.GetGpuBytes();
+        }
+    }
+
+    ImGui::Begin("Render Stats");
+    ImGui::Text("Textures CPU: %.2f MB", totalCpuBytes / BytesInMb);
+    ImGui::Text("Textures GPU: %.2f MB", totalGpuBytes / BytesInMb);
+    ImGui::Text("Samplers: %u", vulkanSamplerCache->GetSamplersCount());
+    const SpirVCache::Stats shaderCacheStats = SpirVCache::GetStats();
+    ImGui::Text("Shader cache: %u hits, %u preprocessed hits, %u misses",
+                shaderCacheStats.sourceHits,
+                shaderCacheStats.preprocessedHits,
+                shaderCacheStats.misses);
+    ImGui::Text("Shaders: %.1f KB SPIR-V, compiled in %.1f ms",
+                vulkanPipelineManager->GetShaderModulesBytes() / 1024.0,
+                vulkanPipelineManager->GetShadersCompilationMs());
+    ImGui::Text("Pipelines: %u graphics, %u compute, %u reused, driver took %.1f ms",
+                vulkanPipelineManager->GetGraphicsPipelinesCount(),
+                vulkanPipelineManager->GetComputePipelinesCount(),
+                vulkanPipelineManager->GetReusedPipelinesCount(),
+                vulkanPipelineManager->GetPipelinesCreationMs());
+    ImGui::Text("Material pipelines pending: %zu (%s)",
+                pendingPipelines.size(),
+                fallbackPipeline ? "fallback drawn" : "skipped");
+    ImGui::Text("Reflected layouts: %u descriptor set, %u pipeline",
+                vulkanPipelineManager->GetDescriptorSetLayoutsCount(),
+                vulkanPipelineManager->GetPipelineLayoutsCount());
+    if (shaderWatcher)
+    {
+        ImGui::Text("Shader hot reload: %u files (%s), %u pipelines reloaded, %u pending",
+                    shaderWatcher->GetWatchedFilesCount(),
+                    shaderWatcher->UsesNotifications() ? "inotify" : "polling",
+                    vulkanPipelineManager->GetReloadedPipelinesCount(),
+                    vulkanPipelineManager->GetPendingReloadsCount());
+    }
+    ImGui::Text("Scene descriptor sets: %u in %u pools, %u reused",
+                sceneDescriptorAllocator->GetSetsCount(),
+                sceneDescriptorAllocator->GetPoolsCount(),
+                sceneDescriptorAllocator->GetSharedSetHitsCount());
+    if (bindlessMaterials)
+    {
+        ImGui::Text("Bindless: %u textures, %u materials",
+                    bindlessMaterials->GetTexturesCount(),
+                    bindlessMaterials->GetMaterialsCount());
+    }
+    else { ImGui::Text("Bindless: off"); }
+    ImGui::Text("Streaming: %u reads pending, %.2f MB uploaded",
+                textureStreamer->GetPendingReadsCount(),
+                textureStreamer->GetUploadedBytes() / BytesInMb);
+    ImGui::Text("IBL: %s",
+                iblBaker->IsBusy()              ? "baking"
+                : iblBaker->IsLoadedFromCache() ? "loaded from cache"
+                : iblBaker->IsReady()           ? "baked"
+                                                : "none");
+    for (const Model& model : scene->GetModels())
+    {
+        if (!ImGui::TreeNode(model.name.c_str())) { continue; }
+        for (size_t i = 0; i < model.textures.size(); ++i)
+        {
+            const Texture& tex = model.textures[i];
+            ImGui::Text("#%zu %ux%u mip %u %s: CPU %.2f MB, GPU %.2f MB",
+                        i,
+                        tex.width,
+                        tex.height,
+                        tex.GetResidentMip(),
+                        ToString(tex.GetResidency()),
+                        tex.GetCpuBytes() / BytesInMb,
+                        tex.GetGpuBytes() / BytesInMb);
+        }
+        ImGui::TreePop();
+    }
+    ImGui::End();
+}
+
 bool RenderSystem::NeedsToRecreateSwapchain() const
 {
     return !vulkanSwapchain ||
@@ -591,7 +1122,7 @@ void RenderSystem::Draw(const std::unique_ptr<View>& view,
 {
     if (NeedsToRecreateSwapchain())
     {
-        RecreateTotalPipeline();
+        RecreateSwapchain();
         ImGui_ImplVulkan_Shutdown();
         ImGui_ImplSDL2_Shutdown();
         ImGui::DestroyContext();
@@ -604,7 +1135,12 @@ void RenderSystem::Draw(const std::unique_ptr<View>& view,
     }
 
     std::shared_ptr<Scene> scene = view->GetScene();
+    ResolvePendingPipelines();
+    ReloadChangedShaders();
     UpdateGlobalUniforms(camera);
+    envCubemapGenerator->Update();
+    iblBaker->Update();
+    StreamVisibleTextures(scene);
 
     vk::Device logicalDevice = vulkanDevice->GetDevice();
 
@@ -627,11 +1163,24 @@ void RenderSystem::Draw(const std::unique_ptr<View>& view,
 
     vk::SubmitInfo submitInfo = {};
 
-    vk::Semaphore waitSemaphores[] = { frameSemaphores.imageAvailableSemaphore };
-    vk::PipelineStageFlags waitStages[] = { vk::PipelineStageFlagBits::eColorAttachmentOutput };
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
+    std::vector<vk::Semaphore> waitSemaphores = { frameSemaphores.imageAvailableSemaphore };
+    std::vector<vk::PipelineStageFlags> waitStages = {
+        vk::PipelineStageFlagBits::eColorAttachmentOutput
+    };
+    // first frame after env cubemap generation or ibl baking finished on the compute queue
+    if (vk::Semaphore envCubemapSemaphore = envCubemapGenerator->TakeFinishedSemaphore())
+    {
+        waitSemaphores.push_back(envCubemapSemaphore);
+        waitStages.push_back(vk::PipelineStageFlagBits::eFragmentShader);
+    }
+    if (vk::Semaphore iblSemaphore = iblBaker->TakeFinishedSemaphore())
+    {
+        waitSemaphores.push_back(iblSemaphore);
+        waitStages.push_back(vk::PipelineStageFlagBits::eFragmentShader);
+    }
+    submitInfo.waitSemaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+    submitInfo.pWaitSemaphores = waitSemaphores.data();
+    submitInfo.pWaitDstStageMask = waitStages.data();
 
     EZASSERT((curFrameIndex < commandBuffers.size()));
     vk::CommandBuffer curCb = commandBuffers.at(curFrameIndex);
@@ -655,28 +1204,45 @@ void RenderSystem::Draw(const std::unique_ptr<View>& view,
 
     curCb.beginRenderPass(&renderPassInfo, vk::SubpassContents::eInline);
 
+    // dynamic state of all graphics pipelines
+    const vk::Viewport viewport(0.0f,
+                                0.0f,
+                                static_cast<float>(swapchainInfo.extent.width),
+                                static_cast<float>(swapchainInfo.extent.height),
+                                0.0f,
+                                1.0f);
+    curCb.setViewport(0, 1, &viewport);
+    curCb.setScissor(0, 1, &renderPassInfo.renderArea);
+
+    DrawContext drawContext;
+    drawContext.commandBuffer = curCb;
+    drawContext.globalDescriptorSet = globalUBO.descriptorSet;
     for (const Model& model : scene->GetModelsMutable())
     {
-        if (!model.graphicsPipeline)
+        // env cubemap contents are still being generated
+        if (model.GetType() == Model::eType::Cubemap && envCubemapGenerator->IsBusy())
         {
-            EZASSERT(false, "Invalid Model Graphics Pipeline");
             continue;
         }
-        curCb.bindPipeline(vk::PipelineBindPoint::eGraphics,
-                           model.graphicsPipeline->GetPipeline());
-
         vk::Buffer vertexBuffers[] = { model.vertexBuffer };
         vk::DeviceSize offsets[] = { 0 };
 
         curCb.bindVertexBuffers(0, 1, vertexBuffers, offsets);
         curCb.bindIndexBuffer(model.indexBuffer, 0, vk::IndexType::eUint32);
 
+        drawContext.bindlessDescriptorSet = UsesBindlessMaterials(model)
+                                                ? bindlessMaterials->GetDescriptorSet()
+                                                : vk::DescriptorSet{};
+        // a gray cube around the camera is worse than no sky for a few frames
+        drawContext.fallbackPipeline =
+            model.GetType() == Model::eType::Cubemap ? nullptr : fallbackPipeline.get();
         for (const std::unique_ptr<Node>& node : model.nodes)
         {
-            DrawNodeRecursive(model, node, globalUBO.descriptorSet, curCb);
+            DrawNodeRecursive(node, drawContext);
         }
     }
 
+    DrawStatsWindow(scene);
     ImGui::Render();
     ImGui_ImplVulkan_RenderDrawData(ImGui::GetDrawData(), curCb);
 
@@ -715,7 +1281,7 @@ void RenderSystem::Draw(const std::unique_ptr<View>& view,
 
     if (result == vk::Result::eErrorOutOfDateKHR || result == vk::Result::eSuboptimalKHR)
     {
-        RecreateTotalPipeline();
+        RecreateSwapchain();
     }
     else if (result != vk::Result::eSuccess)
     {
@@ -733,12 +1299,27 @@ RenderSystem::~RenderSystem()
     ImGui_ImplSDL2_Shutdown();
     ImGui::DestroyContext();
 
-    CleanupTotalPipeline();
+    CleanupSwapchain();
+    textureStreamer.reset();
+    iblBaker.reset();
+    envCubemapGenerator.reset();
+    mipGenerator.reset();
+    bindlessMaterials.reset();
+    sceneDescriptorAllocator.reset();
+    // layouts of all pipelines live in the manager
+    pendingPipelines.clear();
+    fallbackPipeline.reset();
+    vulkanPipelineManager.reset();
+    vulkanRenderPass.reset();
 
     vk::Device logicalDevice = vulkanDevice->GetDevice();
     CheckVkResult(logicalDevice.waitIdle());
 
-    logicalDevice.destroyDescriptorSetLayout(samplersDescriptorSetLayout);
+    defaultWhiteTexture.reset();
+    defaultBlackTexture.reset();
+    // scene textures reference cached samplers but never destroy them
+    vulkanSamplerCache.reset();
+
     logicalDevice.destroyDescriptorSetLayout(globalUBO.descriptorSetLayout);
     logicalDevice.destroyBuffer(globalUBO.uniformBuffer);
     logicalDevice.freeMemory(globalUBO.uniformBufferMemory);
@@ -1,17 +1,26 @@
 #pragma once
 
+#include <chrono>
 #include <iostream>
 #include <memory>
 #include <optional>
 
 #include "core/camera/camera.hpp"
+#include "core/file_watcher.hpp"
 #include "core/scene/scene.hpp"
 #include "render/graphics_result.hpp"
+#include "render/highlevel/bindless_materials.hpp"
+#include "render/highlevel/env_cubemap_generator.hpp"
+#include "render/highlevel/ibl_baker.hpp"
 #include "render/highlevel/mesh.hpp"
+#include "render/highlevel/mip_generator.hpp"
+#include "render/highlevel/texture_streamer.hpp"
+#include "render/vulkan/vulkan_descriptor_allocator.hpp"
 #include "render/vulkan/vulkan_device.hpp"
 #include "render/vulkan/vulkan_instance.hpp"
 #include "render/vulkan/vulkan_pipeline_manager.hpp"
 #include "render/vulkan/vulkan_render_pass.hpp"
+#include "render/vulkan/vulkan_sampler_cache.hpp"
 #include "render/vulkan/vulkan_swapchain.hpp"
 
 namespace ez
@@ -47,10 +56,21 @@ struct RenderSystemCreateInfo
     std::unique_ptr<VulkanSwapchain> vulkanSwapchain;
     std::unique_ptr<VulkanRenderPass> vulkanRenderPass;
     std::unique_ptr<VulkanPipelineManager> vulkanPipelineManager;
+    std::unique_ptr<VulkanSamplerCache> vulkanSamplerCache;
+    std::unique_ptr<VulkanDescriptorAllocator> sceneDescriptorAllocator;
+    std::unique_ptr<Texture> defaultWhiteTexture;
+    std::unique_ptr<Texture> defaultBlackTexture;
+    std::unique_ptr<MipGenerator> mipGenerator;
+    // null if the device doesn't support descriptor indexing
+    std::unique_ptr<BindlessMaterials> bindlessMaterials;
+    std::unique_ptr<EnvCubemapGenerator> envCubemapGenerator;
+    std::unique_ptr<IblBaker> iblBaker;
+    std::unique_ptr<TextureStreamer> textureStreamer;
+    // null if shader hot reload is disabled
+    std::unique_ptr<FileWatcher> shaderWatcher;
 
     FrameSemaphores frameSemaphores;
     GlobalUBO globalUBO;
-    vk::DescriptorSetLayout samplersDescriptorSetLayout;
     std::vector<vk::CommandBuffer> commandBuffers;
 };
 
@@ -91,24 +111,55 @@ class RenderSystem
                                 vk::RenderPass renderPass,
                                 vk::CommandBuffer commandBuffer);
 
+    bool UsesBindlessMaterials(const Model& model) const;
     void UpdateGlobalUniforms(const std::unique_ptr<Camera>& camera);
+    bool AllocateMaterialDescriptorSet(Material& material);
+    void WriteMaterialDescriptorSet(const Material& material);
+    void StreamVisibleTextures(const std::shared_ptr<Scene>& scene);
+    void ResolvePendingPipelines();
+    void ReloadChangedShaders();
+    void DrawStatsWindow(const std::shared_ptr<Scene>& scene);
 
-    void CleanupTotalPipeline();
-    void RecreateTotalPipeline();
+    void CleanupSwapchain();
+    void RecreateSwapchain();
 
     std::unique_ptr<VulkanInstance> vulkanInstance = nullptr;
     std::unique_ptr<VulkanDevice> vulkanDevice = nullptr;
     std::unique_ptr<VulkanSwapchain> vulkanSwapchain = nullptr;
     std::unique_ptr<VulkanRenderPass> vulkanRenderPass = nullptr;
     std::unique_ptr<VulkanPipelineManager> vulkanPipelineManager = nullptr;
+    std::unique_ptr<VulkanSamplerCache> vulkanSamplerCache = nullptr;
+    // material descriptor sets of the current scene, reset when the scene is prepared again
+    std::unique_ptr<VulkanDescriptorAllocator> sceneDescriptorAllocator = nullptr;
+    // bound in material sets instead of the textures a material doesn't have
+    std::unique_ptr<Texture> defaultWhiteTexture = nullptr;
+    std::unique_ptr<Texture> defaultBlackTexture = nullptr;
+    std::unique_ptr<MipGenerator> mipGenerator = nullptr;
+    std::unique_ptr<BindlessMaterials> bindlessMaterials = nullptr;
+    std::unique_ptr<EnvCubemapGenerator> envCubemapGenerator = nullptr;
+    std::unique_ptr<IblBaker> iblBaker = nullptr;
+    std::unique_ptr<TextureStreamer> textureStreamer = nullptr;
+    std::unique_ptr<FileWatcher> shaderWatcher = nullptr;
 
     GlobalUBO globalUBO;
-    vk::DescriptorSetLayout samplersDescriptorSetLayout;
     FrameSemaphores frameSemaphores;
 
+    // drawn instead of material pipelines that are not created yet, null with the eSkip policy
+    std::shared_ptr<VulkanGraphicsPipeline> fallbackPipeline;
+    struct PendingMaterialPipeline final
+    {
+        Material* material = nullptr;
+        bool bindless = false;
+        VulkanPipelineManager::GraphicsPipelineFuture pipeline;
+    };
+    // requested by the last PrepareToRender, moved into their materials once ready
+    std::vector<PendingMaterialPipeline> pendingPipelines;
+    std::chrono::steady_clock::time_point pendingPipelinesStart;
+
     std::vector<vk::CommandBuffer> commandBuffers;
     size_t curFrameIndex = 0;
 
+    // the render pass changed, scene pipelines have to be requested again
     bool needRecreateSceneResources = false;
 };
 
@@ -0,0 +1,237 @@
+#include "spirv_cache.hpp"
+
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+#include "core/file_utils.hpp"
+#include "core/log_assert.hpp"
+#include "render/config.hpp"
+
+namespace ez::SpirVCache
+{
+namespace
+{
+constexpr uint32_t SpirVMagic = 0x07230203;
+
+struct SourcesHeader final
+{
+    uint32_t magic = Magic;
+    uint32_t version = Version;
+    uint64_t preprocessedHash = 0;
+    uint32_t sourcesCount = 0;
+    uint32_t reserved = 0;
+};
+static_assert(sizeof(SourcesHeader) == 24);
+
+struct SourcesEntry final
+{
+    std::vector<SourceFile> sources;
+    uint64_t preprocessedHash = 0;
+};
+
+struct CacheState final
+{
+    std::mutex mutex;
+    // by FileUtils::Hash(shader path, options hash)
+    std::unordered_map<uint64_t, SourcesEntry> sourcesEntries;
+    // by preprocessed hash
+    std::unordered_map<uint64_t, std::vector<uint32_t>> spirvs;
+    Stats stats;
+};
+
+CacheState& GetState()
+{
+    static CacheState state;
+    return state;
+}
+
+std::string GetCacheFilePath(uint64_t hash, const char* extension)
+{
+    std::ostringstream path;
+    path << Config::ShaderCacheDirectory << "/" << std::hex << std::setw(16)
+         << std::setfill('0') << hash << extension;
+    return path.str();
+}
+
+std::optional<SourcesEntry> LoadSourcesEntry(uint64_t sourcesKey, const std::string& shaderPath)
+{
+    std::ifstream file(GetCacheFilePath(sourcesKey, SourcesFileExtension), std::ios::binary);
+    if (!file.is_open()) { return {}; }
+
+    SourcesHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(SourcesHeader));
+    if (!file.good() || header.magic != Magic || header.version != Version) { return {}; }
+
+    SourcesEntry entry;
+    entry.preprocessedHash = header.preprocessedHash;
+    entry.sources.resize(header.sourcesCount);
+    for (SourceFile& source : entry.sources)
+    {
+        uint32_t pathLength = 0;
+        file.read(reinterpret_cast<char*>(&source.hash), sizeof(source.hash));
+        file.read(reinterpret_cast<char*>(&pathLength), sizeof(pathLength));
+        if (!file.good()) { return {}; }
+        source.path.resize(pathLength);
+        file.read(source.path.data(), pathLength);
+    }
+    // a different shader with the same key hash
+    if (!file.good() || entry.sources.empty() || entry.sources.front().path != shaderPath)
+    {
+        return {};
+    }
+    return entry;
+}
+
+bool SaveSourcesEntry(uint64_t sourcesKey, const SourcesEntry& entry)
+{
+    SourcesHeader header;
+    header.preprocessedHash = entry.preprocessedHash;
+    header.sourcesCount = static_cast<uint32_t>(entry.sources.size());
+
+    std::string contents(reinterpret_cast<const char*>(&header), sizeof(SourcesHeader));
+    for (const SourceFile& source : entry.sources)
+    {
+        const uint32_t pathLength = static_cast<uint32_t>(source.path.size());
+        contents.append(reinterpret_cast<const char*>(&source.hash), sizeof(source.hash));
+        contents.append(reinterpret_cast<const char*>(&pathLength), sizeof(pathLength));
+        contents.append(source.path);
+    }
+    return FileUtils::WriteFileAtomically(
+        GetCacheFilePath(sourcesKey, SourcesFileExtension),
+        [&](std::ostream& file) {
+            file.write(contents.data(), static_cast<std::streamsize>(contents.size()));
+        });
+}
+
+std::optional<std::vector<uint32_t>> LoadSpirV(uint64_t preprocessedHash)
+{
+    {
+        CacheState& state = GetState();
+        std::lock_guard<std::mutex> lock(state.mutex);
+        const auto it = state.spirvs.find(preprocessedHash);
+        if (it != state.spirvs.end()) { return it->second; }
+    }
+
+    const std::string path = GetCacheFilePath(preprocessedHash, SpirVFileExtension);
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) { return {}; }
+
+    const std::streamsize size = file.tellg();
+    if (size <= 0 || size % sizeof(uint32_t) != 0) { return {}; }
+
+    std::vector<uint32_t> spirv(static_cast<size_t>(size) / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(spirv.data()), size);
+    if (!file.good() || spirv.front() != SpirVMagic)
+    {
+        EZLOG("shader cache is invalid:", path);
+        return {};
+    }
+
+    CacheState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.spirvs.emplace(preprocessedHash, spirv);
+    return spirv;
+}
+}  // namespace
+
+std::optional<std::vector<uint32_t>> FindBySources(const std::string& shaderPath,
+                                                   uint64_t optionsHash,
+                                                   std::vector<SourceFile>* sources)
+{
+    if (!Config::ShaderCacheEnabled) { return {}; }
+
+    CacheState& state = GetState();
+    const uint64_t sourcesKey = FileUtils::Hash(shaderPath, optionsHash);
+
+    std::optional<SourcesEntry> entry;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        const auto it = state.sourcesEntries.find(sourcesKey);
+        if (it != state.sourcesEntries.end()) { entry = it->second; }
+    }
+    if (!entry) { entry = LoadSourcesEntry(sourcesKey, shaderPath); }
+    if (!entry) { return {}; }
+
+    // files are read again even for entries in memory, they may be edited while running
+    for (const SourceFile& source : entry->sources)
+    {
+        if (FileUtils::HashFile(source.path) != source.hash) { return {}; }
+    }
+
+    std::optional<std::vector<uint32_t>> spirv = LoadSpirV(entry->preprocessedHash);
+    if (!spirv) { return {}; }
+
+    if (sources != nullptr) { *sources = entry->sources; }
+    std::lock_guard<std::mutex> lock(state.mutex);
+    state.sourcesEntries[sourcesKey] = std::move(*entry);
+    ++state.stats.sourceHits;
+    return spirv;
+}
+
+std::optional<std::vector<uint32_t>> FindByPreprocessed(uint64_t preprocessedHash)
+{
+    if (!Config::ShaderCacheEnabled) { return {}; }
+
+    std::optional<std::vector<uint32_t>> spirv = LoadSpirV(preprocessedHash);
+
+    CacheState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    if (spirv) { ++state.stats.preprocessedHits; }
+    else { ++state.stats.misses; }
+    return spirv;
+}
+
+void Store(const std::string& shaderPath,
+           uint64_t optionsHash,
+           const std::vector<SourceFile>& sources,
+           uint64_t preprocessedHash,
+           const std::vector<uint32_t>& spirv)
+{
+    if (!Config::ShaderCacheEnabled) { return; }
+    EZASSERT((!sources.empty() && sources.front().path == shaderPath),
+             "Shader sources must start with the shader itself");
+
+    const uint64_t sourcesKey = FileUtils::Hash(shaderPath, optionsHash);
+    const SourcesEntry entry{ sources, preprocessedHash };
+
+    CacheState& state = GetState();
+    bool isNewSpirV = false;
+    {
+        std::lock_guard<std::mutex> lock(state.mutex);
+        state.sourcesEntries[sourcesKey] = entry;
+        isNewSpirV = state.spirvs.emplace(preprocessedHash, spirv).second;
+    }
+
+    std::error_code ec;
+    std::filesystem::create_directories(Config::ShaderCacheDirectory, ec);
+    if (ec)
+    {
+        EZLOG("failed to create shader cache directory:", ec.message());
+        return;
+    }
+
+    const std::string spirvPath = GetCacheFilePath(preprocessedHash, SpirVFileExtension);
+    if (isNewSpirV && !std::filesystem::exists(spirvPath, ec))
+    {
+        const bool written = FileUtils::WriteFileAtomically(spirvPath, [&](std::ostream& file) {
+            file.write(reinterpret_cast<const char*>(spirv.data()),
+                       static_cast<std::streamsize>(spirv.size() * sizeof(uint32_t)));
+        });
+        if (!written) { return; }
+    }
+    SaveSourcesEntry(sourcesKey, entry);
+}
+
+Stats GetStats()
+{
+    CacheState& state = GetState();
+    std::lock_guard<std::mutex> lock(state.mutex);
+    return state.stats;
+}
+
+}  // namespace ez::SpirVCache
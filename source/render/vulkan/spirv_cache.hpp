@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Memory and disk cache of SPIR-V compiled from GLSL, safe to use from several threads.
+// SPIR-V is stored by the hash of the preprocessed source (includes expanded) and the compiler
+// options. Next to it every shader file keeps a list of the files it was preprocessed from with
+// their content hashes, so an unchanged shader is found without running glslang at all.
+namespace ez::SpirVCache
+{
+constexpr uint32_t Magic = 0x5053455A;  // "ZESP"
+constexpr uint32_t Version = 1;
+constexpr const char* SpirVFileExtension = ".spv";
+constexpr const char* SourcesFileExtension = ".ezdeps";
+
+struct SourceFile final
+{
+    std::string path;
+    // FileUtils::Hash of the contents
+    uint64_t hash = 0;
+};
+
+struct Stats final
+{
+    // found by the shader file sources, glslang was not run
+    uint32_t sourceHits = 0;
+    // found by the preprocessed source, only the glslang preprocessor was run
+    uint32_t preprocessedHits = 0;
+    uint32_t misses = 0;
+};
+
+// SPIR-V of shaderPath if none of the files it was compiled from has changed since,
+// these files are written to sources on a hit
+std::optional<std::vector<uint32_t>> FindBySources(const std::string& shaderPath,
+                                                   uint64_t optionsHash,
+                                                   std::vector<SourceFile>* sources = nullptr);
+// preprocessedHash is FileUtils::Hash(preprocessed source, optionsHash)
+std::optional<std::vector<uint32_t>> FindByPreprocessed(uint64_t preprocessedHash);
+
+// sources start with shaderPath itself, followed by its includes
+void Store(const std::string& shaderPath,
+           uint64_t optionsHash,
+           const std::vector<SourceFile>& sources,
+           uint64_t preprocessedHash,
+           const std::vector<uint32_t>& spirv);
+
+Stats GetStats();
+
+}  // namespace ez::SpirVCache
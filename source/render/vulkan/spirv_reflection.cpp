@@ -0,0 +1,553 @@
+#include "spirv_reflection.hpp"
+
+#include <algorithm>
+#include <array>
+#include <iterator>
+#include <map>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+
+#include "core/log_assert.hpp"
+
+namespace ez::SpirVReflection
+{
+namespace
+{
+constexpr uint32_t SpirVMagic = 0x07230203;
+constexpr size_t HeaderWordsCount = 5;
+
+// values from the SPIR-V specification
+enum Op : uint32_t
+{
+    OpEntryPoint = 15,
+    OpTypeInt = 21,
+    OpTypeFloat = 22,
+    OpTypeVector = 23,
+    OpTypeMatrix = 24,
+    OpTypeImage = 25,
+    OpTypeSampler = 26,
+    OpTypeSampledImage = 27,
+    OpTypeArray = 28,
+    OpTypeRuntimeArray = 29,
+    OpTypeStruct = 30,
+    OpTypePointer = 32,
+    OpConstant = 43,
+    OpSpecConstant = 50,
+    OpVariable = 59,
+    OpDecorate = 71,
+    OpMemberDecorate = 72,
+};
+
+enum StorageClass : uint32_t
+{
+    scUniformConstant = 0,
+    scInput = 1,
+    scUniform = 2,
+    scPushConstant = 9,
+    scStorageBuffer = 12,
+};
+
+enum Decoration : uint32_t
+{
+    dBlock = 2,
+    dBufferBlock = 3,
+    dArrayStride = 6,
+    dMatrixStride = 7,
+    dBuiltIn = 11,
+    dLocation = 30,
+    dBinding = 33,
+    dDescriptorSet = 34,
+    dOffset = 35,
+};
+
+enum ExecutionModel : uint32_t
+{
+    emVertex = 0,
+    emFragment = 4,
+    emGLCompute = 5,
+};
+
+enum Dim : uint32_t
+{
+    dimBuffer = 5,
+    dimSubpassData = 6,
+};
+
+struct Type final
+{
+    uint32_t opcode = 0;
+    // words after the result id
+    std::vector<uint32_t> operands;
+};
+
+struct Decorations final
+{
+    std::optional<uint32_t> set;
+    std::optional<uint32_t> binding;
+    std::optional<uint32_t> location;
+    std::optional<uint32_t> arrayStride;
+    bool block = false;
+    bool bufferBlock = false;
+    bool builtIn = false;
+    // by member index
+    std::unordered_map<uint32_t, uint32_t> memberOffsets;
+    std::unordered_map<uint32_t, uint32_t> memberMatrixStrides;
+    bool hasBuiltInMembers = false;
+};
+
+struct Variable final
+{
+    uint32_t id = 0;
+    uint32_t pointerTypeId = 0;
+    uint32_t storageClass = 0;
+};
+
+struct Module final
+{
+    std::optional<vk::ShaderStageFlagBits> stage;
+    std::unordered_map<uint32_t, Type> types;
+    // values of 32 bit integer constants, spec constants have their default values
+    std::unordered_map<uint32_t, uint32_t> constants;
+    std::unordered_map<uint32_t, Decorations> decorations;
+    std::vector<Variable> variables;
+
+    const Type* FindType(uint32_t id) const
+    {
+        const auto it = types.find(id);
+        return it != types.end() ? &it->second : nullptr;
+    }
+
+    const Decorations* FindDecorations(uint32_t id) const
+    {
+        const auto it = decorations.find(id);
+        return it != decorations.end() ? &it->second : nullptr;
+    }
+};
+
+// operands after the opcode word, instructions with fewer are malformed
+uint32_t GetMinOperandsCount(uint32_t opcode)
+{
+    switch (opcode)
+    {
+        case OpEntryPoint: return 2;
+        case OpTypeSampler: return 1;
+        case OpTypeFloat:
+        case OpTypeSampledImage:
+        case OpTypeRuntimeArray:
+        case OpDecorate: return 2;
+        case OpTypeInt:
+        case OpTypeVector:
+        case OpTypeMatrix:
+        case OpTypeArray:
+        case OpTypePointer:
+        case OpConstant:
+        case OpSpecConstant:
+        case OpVariable:
+        case OpMemberDecorate: return 3;
+        case OpTypeImage: return 8;
+        default: return 0;
+    }
+}
+
+std::optional<vk::ShaderStageFlagBits> ToStage(uint32_t executionModel)
+{
+    switch (executionModel)
+    {
+        case emVertex: return vk::ShaderStageFlagBits::eVertex;
+        case emFragment: return vk::ShaderStageFlagBits::eFragment;
+        case emGLCompute: return vk::ShaderStageFlagBits::eCompute;
+        default: return {};
+    }
+}
+
+bool Parse(const std::vector<uint32_t>& spirv, Module& module)
+{
+    if (spirv.size() < HeaderWordsCount || spirv[0] != SpirVMagic) { return false; }
+
+    for (size_t i = HeaderWordsCount; i < spirv.size();)
+    {
+        const uint32_t wordCount = spirv[i] >> 16;
+        const uint32_t opcode = spirv[i] & 0xffff;
+        if (wordCount == 0 || i + wordCount > spirv.size()) { return false; }
+
+        const uint32_t* operands = spirv.data() + i + 1;
+        const uint32_t operandsCount = wordCount - 1;
+        i += wordCount;
+        if (operandsCount < GetMinOperandsCount(opcode)) { return false; }
+
+        switch (opcode)
+        {
+            case OpEntryPoint:
+                // modules here have one entry point
+                if (!module.stage) { module.stage = ToStage(operands[0]); }
+                break;
+            case OpDecorate:
+            {
+                Decorations& decorations = module.decorations[operands[0]];
+                const std::optional<uint32_t> value =
+                    operandsCount > 2 ? std::optional<uint32_t>(operands[2]) : std::nullopt;
+                switch (operands[1])
+                {
+                    case dBlock: decorations.block = true; break;
+                    case dBufferBlock: decorations.bufferBlock = true; break;
+                    case dBuiltIn: decorations.builtIn = true; break;
+                    case dArrayStride: decorations.arrayStride = value; break;
+                    case dLocation: decorations.location = value; break;
+                    case dBinding: decorations.binding = value; break;
+                    case dDescriptorSet: decorations.set = value; break;
+                    default: break;
+                }
+                break;
+            }
+            case OpMemberDecorate:
+            {
+                Decorations& decorations = module.decorations[operands[0]];
+                const uint32_t member = operands[1];
+                if (operands[2] == dBuiltIn) { decorations.hasBuiltInMembers = true; }
+                if (operandsCount < 4) { break; }
+                if (operands[2] == dOffset) { decorations.memberOffsets[member] = operands[3]; }
+                if (operands[2] == dMatrixStride)
+                {
+                    decorations.memberMatrixStrides[member] = operands[3];
+                }
+                break;
+            }
+            case OpTypeInt:
+            case OpTypeFloat:
+            case OpTypeVector:
+            case OpTypeMatrix:
+            case OpTypeImage:
+            case OpTypeSampler:
+            case OpTypeSampledImage:
+            case OpTypeArray:
+            case OpTypeRuntimeArray:
+            case OpTypeStruct:
+            case OpTypePointer:
+                if (operandsCount == 0) { return false; }
+                module.types[operands[0]] = { opcode,
+                                              { operands + 1, operands + operandsCount } };
+                break;
+            case OpConstant:
+            case OpSpecConstant: module.constants[operands[1]] = operands[2]; break;
+            case OpVariable:
+                module.variables.push_back({ operands[1], operands[0], operands[2] });
+                break;
+            default: break;
+        }
+    }
+    return module.stage.has_value();
+}
+
+// size in a Block or push constant struct, matrixStride comes from the member decoration
+uint32_t GetTypeSize(const Module& module, uint32_t typeId, uint32_t matrixStride = 0)
+{
+    const Type* type = module.FindType(typeId);
+    if (type == nullptr) { return 0; }
+
+    switch (type->opcode)
+    {
+        case OpTypeInt:
+        case OpTypeFloat: return type->operands[0] / 8;
+        case OpTypeVector: return type->operands[1] * GetTypeSize(module, type->operands[0]);
+        case OpTypeMatrix:
+        {
+            const uint32_t columnSize = matrixStride > 0
+                                            ? matrixStride
+                                            : GetTypeSize(module, type->operands[0]);
+            return type->operands[1] * columnSize;
+        }
+        case OpTypeArray:
+        {
+            const auto length = module.constants.find(type->operands[1]);
+            if (length == module.constants.end()) { return 0; }
+
+            const Decorations* decorations = module.FindDecorations(typeId);
+            const uint32_t stride = decorations && decorations->arrayStride
+                                        ? *decorations->arrayStride
+                                        : GetTypeSize(module, type->operands[0]);
+            return length->second * stride;
+        }
+        case OpTypeStruct:
+        {
+            const Decorations* decorations = module.FindDecorations(typeId);
+            uint32_t size = 0;
+            for (uint32_t member = 0; member < type->operands.size(); ++member)
+            {
+                uint32_t offset = 0;
+                uint32_t memberMatrixStride = 0;
+                if (decorations != nullptr)
+                {
+                    const auto offsetIt = decorations->memberOffsets.find(member);
+                    if (offsetIt != decorations->memberOffsets.end())
+                    {
+                        offset = offsetIt->second;
+                    }
+                    const auto strideIt = decorations->memberMatrixStrides.find(member);
+                    if (strideIt != decorations->memberMatrixStrides.end())
+                    {
+                        memberMatrixStride = strideIt->second;
+                    }
+                }
+                size = std::max(size,
+                                offset + GetTypeSize(module,
+                                                     type->operands[member],
+                                                     memberMatrixStride));
+            }
+            return size;
+        }
+        default: return 0;
+    }
+}
+
+std::optional<vk::DescriptorType> GetDescriptorType(const Module& module,
+                                                    uint32_t storageClass,
+                                                    uint32_t typeId)
+{
+    const Type* type = module.FindType(typeId);
+    if (type == nullptr) { return {}; }
+
+    if (storageClass == scStorageBuffer) { return vk::DescriptorType::eStorageBuffer; }
+    if (storageClass == scUniform)
+    {
+        const Decorations* decorations = module.FindDecorations(typeId);
+        if (decorations == nullptr) { return {}; }
+        if (decorations->bufferBlock) { return vk::DescriptorType::eStorageBuffer; }
+        if (decorations->block) { return vk::DescriptorType::eUniformBuffer; }
+        return {};
+    }
+    if (storageClass != scUniformConstant) { return {}; }
+
+    switch (type->opcode)
+    {
+        case OpTypeSampledImage: return vk::DescriptorType::eCombinedImageSampler;
+        case OpTypeSampler: return vk::DescriptorType::eSampler;
+        case OpTypeImage:
+        {
+            const uint32_t dim = type->operands[1];
+            const bool storage = type->operands[5] == 2;
+            if (dim == dimSubpassData) { return vk::DescriptorType::eInputAttachment; }
+            if (dim == dimBuffer)
+            {
+                return storage ? vk::DescriptorType::eStorageTexelBuffer
+                               : vk::DescriptorType::eUniformTexelBuffer;
+            }
+            return storage ? vk::DescriptorType::eStorageImage
+                           : vk::DescriptorType::eSampledImage;
+        }
+        default: return {};
+    }
+}
+
+std::optional<vk::Format> GetVertexInputFormat(const Module& module, uint32_t typeId)
+{
+    const Type* type = module.FindType(typeId);
+    if (type == nullptr) { return {}; }
+
+    uint32_t componentsCount = 1;
+    if (type->opcode == OpTypeVector)
+    {
+        componentsCount = type->operands[1];
+        type = module.FindType(type->operands[0]);
+        if (type == nullptr) { return {}; }
+    }
+    if (componentsCount < 1 || componentsCount > 4 || type->operands[0] != 32) { return {}; }
+
+    static const std::map<std::pair<uint32_t, bool>, std::array<vk::Format, 4>> Formats = {
+        { { OpTypeFloat, false },
+          { vk::Format::eR32Sfloat,
+            vk::Format::eR32G32Sfloat,
+            vk::Format::eR32G32B32Sfloat,
+            vk::Format::eR32G32B32A32Sfloat } },
+        { { OpTypeInt, true },
+          { vk::Format::eR32Sint,
+            vk::Format::eR32G32Sint,
+            vk::Format::eR32G32B32Sint,
+            vk::Format::eR32G32B32A32Sint } },
+        { { OpTypeInt, false },
+          { vk::Format::eR32Uint,
+            vk::Format::eR32G32Uint,
+            vk::Format::eR32G32B32Uint,
+            vk::Format::eR32G32B32A32Uint } },
+    };
+    const bool isSigned = type->opcode == OpTypeInt && type->operands[1] != 0;
+    const auto it = Formats.find({ type->opcode, isSigned });
+    if (it == Formats.end()) { return {}; }
+    return it->second[componentsCount - 1];
+}
+
+bool ReflectVariable(const Module& module, const Variable& variable, ShaderInterface& result)
+{
+    const Type* pointer = module.FindType(variable.pointerTypeId);
+    if (pointer == nullptr || pointer->opcode != OpTypePointer) { return false; }
+    const uint32_t typeId = pointer->operands[1];
+    const Decorations* decorations = module.FindDecorations(variable.id);
+
+    switch (variable.storageClass)
+    {
+        case scUniformConstant:
+        case scUniform:
+        case scStorageBuffer:
+        {
+            if (!decorations || !decorations->set || !decorations->binding) { return false; }
+
+            DescriptorBinding binding;
+            binding.set = *decorations->set;
+            binding.binding = *decorations->binding;
+            binding.stages = result.stages;
+
+            uint32_t elementTypeId = typeId;
+            const Type* type = module.FindType(typeId);
+            if (type != nullptr && type->opcode == OpTypeArray)
+            {
+                const auto length = module.constants.find(type->operands[1]);
+                if (length == module.constants.end()) { return false; }
+                binding.count = length->second;
+                elementTypeId = type->operands[0];
+            }
+            else if (type != nullptr && type->opcode == OpTypeRuntimeArray)
+            {
+                binding.count = 0;
+                elementTypeId = type->operands[0];
+            }
+
+            const std::optional<vk::DescriptorType> descriptorType =
+                GetDescriptorType(module, variable.storageClass, elementTypeId);
+            if (!descriptorType) { return false; }
+            binding.type = *descriptorType;
+            result.bindings.push_back(binding);
+            return true;
+        }
+        case scPushConstant:
+        {
+            const Type* type = module.FindType(typeId);
+            const Decorations* typeDecorations = module.FindDecorations(typeId);
+            if (type == nullptr || type->opcode != OpTypeStruct || !typeDecorations)
+            {
+                return false;
+            }
+
+            uint32_t offset = UINT32_MAX;
+            for (const auto& [member, memberOffset] : typeDecorations->memberOffsets)
+            {
+                offset = std::min(offset, memberOffset);
+            }
+            const uint32_t end = GetTypeSize(module, typeId);
+            if (offset == UINT32_MAX || end <= offset) { return false; }
+            result.pushConstantRanges.emplace_back(result.stages, offset, end - offset);
+            return true;
+        }
+        case scInput:
+        {
+            const bool isVertexStage = result.stages == vk::ShaderStageFlagBits::eVertex;
+            const Decorations* typeDecorations = module.FindDecorations(typeId);
+            const bool isBuiltIn = (decorations && decorations->builtIn) ||
+                                   (typeDecorations && typeDecorations->hasBuiltInMembers);
+            if (!isVertexStage || isBuiltIn) { return true; }
+            if (!decorations || !decorations->location) { return false; }
+
+            const std::optional<vk::Format> format = GetVertexInputFormat(module, typeId);
+            if (!format) { return false; }
+            result.vertexInputs.push_back({ *decorations->location, *format });
+            return true;
+        }
+        default: return true;
+    }
+}
+
+bool CompareBindings(const DescriptorBinding& lhs, const DescriptorBinding& rhs)
+{
+    return std::tie(lhs.set, lhs.binding) < std::tie(rhs.set, rhs.binding);
+}
+}  // namespace
+
+std::vector<DescriptorBinding> ShaderInterface::GetSetBindings(uint32_t set) const
+{
+    std::vector<DescriptorBinding> setBindings;
+    std::copy_if(bindings.begin(),
+                 bindings.end(),
+                 std::back_inserter(setBindings),
+                 [set](const DescriptorBinding& binding) { return binding.set == set; });
+    return setBindings;
+}
+
+bool ShaderInterface::HasBinding(uint32_t set, uint32_t binding) const
+{
+    return std::any_of(bindings.begin(), bindings.end(), [set, binding](const auto& b) {
+        return b.set == set && b.binding == binding;
+    });
+}
+
+bool ShaderInterface::HasPushConstants(vk::ShaderStageFlags stage) const
+{
+    return std::any_of(pushConstantRanges.begin(),
+                       pushConstantRanges.end(),
+                       [stage](const vk::PushConstantRange& range) {
+                           return static_cast<bool>(range.stageFlags & stage);
+                       });
+}
+
+std::optional<ShaderInterface> Reflect(const std::vector<uint32_t>& spirv)
+{
+    Module module;
+    if (!Parse(spirv, module))
+    {
+        EZLOG("Failed to parse SPIR-V for reflection");
+        return {};
+    }
+
+    ShaderInterface result;
+    result.stages = *module.stage;
+    for (const Variable& variable : module.variables)
+    {
+        if (!ReflectVariable(module, variable, result))
+        {
+            EZLOG("Unsupported shader resource, SPIR-V id", variable.id);
+            return {};
+        }
+    }
+    std::sort(result.bindings.begin(), result.bindings.end(), CompareBindings);
+    std::sort(result.vertexInputs.begin(),
+              result.vertexInputs.end(),
+              [](const VertexInput& lhs, const VertexInput& rhs) {
+                  return lhs.location < rhs.location;
+              });
+    return result;
+}
+
+std::optional<ShaderInterface> Merge(const std::vector<ShaderInterface>& stageInterfaces)
+{
+    ShaderInterface result;
+    for (const ShaderInterface& stage : stageInterfaces)
+    {
+        result.stages |= stage.stages;
+        result.pushConstantRanges.insert(result.pushConstantRanges.end(),
+                                         stage.pushConstantRanges.begin(),
+                                         stage.pushConstantRanges.end());
+        result.vertexInputs.insert(
+            result.vertexInputs.end(), stage.vertexInputs.begin(), stage.vertexInputs.end());
+
+        for (const DescriptorBinding& binding : stage.bindings)
+        {
+            const auto it = std::find_if(
+                result.bindings.begin(), result.bindings.end(), [&binding](const auto& b) {
+                    return b.set == binding.set && b.binding == binding.binding;
+                });
+            if (it == result.bindings.end())
+            {
+                result.bindings.push_back(binding);
+                continue;
+            }
+            if (it->type != binding.type || it->count != binding.count)
+            {
+                EZLOG("Shader stages declare set", binding.set, "binding", binding.binding,
+                      "differently");
+                return {};
+            }
+            it->stages |= binding.stages;
+        }
+    }
+    std::sort(result.bindings.begin(), result.bindings.end(), CompareBindings);
+    return result;
+}
+}  // namespace ez::SpirVReflection
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+#include "render/vulkan_include.hpp"
+
+// Resource interface of compiled SPIR-V: descriptor bindings, push constants and vertex inputs.
+// Only the instructions needed for that are parsed, it is not a SPIR-V validator.
+namespace ez::SpirVReflection
+{
+struct DescriptorBinding final
+{
+    uint32_t set = 0;
+    uint32_t binding = 0;
+    vk::DescriptorType type = vk::DescriptorType::eSampler;
+    // 0 for runtime arrays, the layout has to come from elsewhere then
+    uint32_t count = 1;
+    vk::ShaderStageFlags stages;
+};
+
+struct VertexInput final
+{
+    uint32_t location = 0;
+    vk::Format format = vk::Format::eUndefined;
+};
+
+struct ShaderInterface final
+{
+    vk::ShaderStageFlags stages;
+    // sorted by set and binding
+    std::vector<DescriptorBinding> bindings;
+    // a range per stage that uses push constants
+    std::vector<vk::PushConstantRange> pushConstantRanges;
+    // vertex stage only
+    std::vector<VertexInput> vertexInputs;
+
+    // bindings of one set, sorted by binding
+    std::vector<DescriptorBinding> GetSetBindings(uint32_t set) const;
+    bool HasBinding(uint32_t set, uint32_t binding) const;
+    bool HasPushConstants(vk::ShaderStageFlags stage) const;
+};
+
+// nothing if spirv is malformed or uses a resource this parser doesn't know
+std::optional<ShaderInterface> Reflect(const std::vector<uint32_t>& spirv);
+
+// interface of a pipeline from the interfaces of its stages, nothing if the stages declare the
+// same binding differently
+std::optional<ShaderInterface> Merge(const std::vector<ShaderInterface>& stageInterfaces);
+}  // namespace ez::SpirVReflection
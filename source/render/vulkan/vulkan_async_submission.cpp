@@ -0,0 +1,130 @@
+#include "vulkan_async_submission.hpp"
+
+#include <limits>
+
+#include "core/log_assert.hpp"
+
+namespace ez
+{
+VulkanAsyncSubmission::VulkanAsyncSubmission(vk::Device aLogicalDevice,
+                                             vk::Queue aQueue,
+                                             vk::CommandPool aCommandPool,
+                                             vk::Fence aFence,
+                                             vk::Semaphore aFinishedSemaphore)
+    : logicalDevice(aLogicalDevice)
+    , queue(aQueue)
+    , commandPool(aCommandPool)
+    , fence(aFence)
+    , finishedSemaphore(aFinishedSemaphore)
+{
+}
+
+VulkanAsyncSubmission::~VulkanAsyncSubmission()
+{
+    WaitIdle();
+    Poll();
+
+    logicalDevice.destroySemaphore(finishedSemaphore);
+    logicalDevice.destroyFence(fence);
+}
+
+ResultValue<std::unique_ptr<VulkanAsyncSubmission>> VulkanAsyncSubmission::Create(
+    vk::Device logicalDevice,
+    vk::Queue queue,
+    vk::CommandPool commandPool)
+{
+    vk::FenceCreateInfo fenceCI{};
+    vk::Fence fence;
+    if (logicalDevice.createFence(&fenceCI, nullptr, &fence) != vk::Result::eSuccess)
+    {
+        EZLOG("Failed to create async submission fence");
+        return GraphicsResult::Error;
+    }
+
+    vk::SemaphoreCreateInfo semaphoreCI{};
+    vk::Semaphore finishedSemaphore;
+    if (logicalDevice.createSemaphore(&semaphoreCI, nullptr, &finishedSemaphore) !=
+        vk::Result::eSuccess)
+    {
+        EZLOG("Failed to create async submission semaphore");
+        logicalDevice.destroyFence(fence);
+        return GraphicsResult::Error;
+    }
+
+    return { GraphicsResult::Ok,
+             std::make_unique<VulkanAsyncSubmission>(
+                 logicalDevice, queue, commandPool, fence, finishedSemaphore) };
+}
+
+vk::CommandBuffer VulkanAsyncSubmission::Begin()
+{
+    EZASSERT(!busy && !commandBuffer, "Previous async submission is still in flight");
+
+    vk::CommandBufferAllocateInfo allocInfo = {};
+    allocInfo.level = vk::CommandBufferLevel::ePrimary;
+    allocInfo.commandPool = commandPool;
+    allocInfo.commandBufferCount = 1;
+    CheckVkResult(logicalDevice.allocateCommandBuffers(&allocInfo, &commandBuffer));
+
+    vk::CommandBufferBeginInfo beginInfo = {};
+    beginInfo.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit;
+    CheckVkResult(commandBuffer.begin(&beginInfo));
+
+    return commandBuffer;
+}
+
+bool VulkanAsyncSubmission::Submit()
+{
+    CheckVkResult(commandBuffer.end());
+
+    // a signaled semaphore nobody waited on yet is consumed here and signaled again
+    const vk::PipelineStageFlags waitStage = vk::PipelineStageFlagBits::eAllCommands;
+    vk::SubmitInfo submitInfo = {};
+    submitInfo.waitSemaphoreCount = semaphorePendingWait ? 1 : 0;
+    submitInfo.pWaitSemaphores = &finishedSemaphore;
+    submitInfo.pWaitDstStageMask = &waitStage;
+    submitInfo.commandBufferCount = 1;
+    submitInfo.pCommandBuffers = &commandBuffer;
+    submitInfo.signalSemaphoreCount = 1;
+    submitInfo.pSignalSemaphores = &finishedSemaphore;
+
+    CheckVkResult(logicalDevice.resetFences(1, &fence));
+    if (queue.submit(1, &submitInfo, fence) != vk::Result::eSuccess)
+    {
+        EZASSERT(false, "Failed to submit async command buffer!");
+        logicalDevice.freeCommandBuffers(commandPool, 1, &commandBuffer);
+        commandBuffer = nullptr;
+        return false;
+    }
+    semaphorePendingWait = false;
+    busy = true;
+    return true;
+}
+
+bool VulkanAsyncSubmission::Poll()
+{
+    if (!busy || logicalDevice.getFenceStatus(fence) != vk::Result::eSuccess) { return false; }
+
+    logicalDevice.freeCommandBuffers(commandPool, 1, &commandBuffer);
+    commandBuffer = nullptr;
+    busy = false;
+    semaphorePendingWait = true;
+    return true;
+}
+
+void VulkanAsyncSubmission::WaitIdle() const
+{
+    if (!busy) { return; }
+
+    CheckVkResult(
+        logicalDevice.waitForFences(1, &fence, VK_TRUE, std::numeric_limits<uint64_t>::max()));
+}
+
+vk::Semaphore VulkanAsyncSubmission::TakeFinishedSemaphore()
+{
+    if (busy || !semaphorePendingWait) { return nullptr; }
+
+    semaphorePendingWait = false;
+    return finishedSemaphore;
+}
+}  // namespace ez
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <memory>
+
+#include "render/graphics_result.hpp"
+#include "render/vulkan_include.hpp"
+
+namespace ez
+{
+// One submission in flight at a time on any queue: the command buffer, a fence polled by the
+// owner and a semaphore the graphics queue waits on before it uses the results. Serves the
+// compute passes on the compute queue and the texture uploads on the graphics queue.
+class VulkanAsyncSubmission
+{
+   public:
+    VulkanAsyncSubmission(vk::Device aLogicalDevice,
+                          vk::Queue aQueue,
+                          vk::CommandPool aCommandPool,
+                          vk::Fence aFence,
+                          vk::Semaphore aFinishedSemaphore);
+    ~VulkanAsyncSubmission();
+
+    static ResultValue<std::unique_ptr<VulkanAsyncSubmission>> Create(
+        vk::Device logicalDevice,
+        vk::Queue queue,
+        vk::CommandPool commandPool);
+
+    // must not be busy, returns a command buffer in recording state
+    vk::CommandBuffer Begin();
+    bool Submit();
+
+    // true exactly once per submission, when it is found finished
+    bool Poll();
+    // blocks until the submission is finished, Poll still reports it afterwards
+    void WaitIdle() const;
+    bool IsBusy() const { return busy; }
+
+    // returns the semaphore signaled by the last finished submission once, null otherwise
+    vk::Semaphore TakeFinishedSemaphore();
+
+   private:
+    vk::Device logicalDevice;
+    vk::Queue queue;
+    vk::CommandPool commandPool;
+    vk::Fence fence;
+    vk::Semaphore finishedSemaphore;
+
+    vk::CommandBuffer commandBuffer;
+
+    bool busy = false;
+    bool semaphorePendingWait = false;
+};
+}  // namespace ez
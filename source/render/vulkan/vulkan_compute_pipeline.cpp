@@ -0,0 +1,83 @@
+#include "vulkan_compute_pipeline.hpp"
+
+#include <utility>
+
+#include "core/log_assert.hpp"
+
+namespace ez
+{
+VulkanComputePipeline::VulkanComputePipeline(vk::Device aLogicalDevice,
+                                             const PipelineLayoutInfo& aLayout)
+    : logicalDevice(aLogicalDevice)
+    , layout(aLayout)
+{
+}
+
+VulkanComputePipeline::VulkanComputePipeline(VulkanComputePipeline&& other)
+{
+    logicalDevice = other.logicalDevice;
+    layout = std::move(other.layout);
+    computePipeline = other.computePipeline;
+
+    other.logicalDevice = nullptr;
+    other.computePipeline = nullptr;
+}
+
+VulkanComputePipeline::~VulkanComputePipeline()
+{
+    if (logicalDevice) { logicalDevice.destroyPipeline(computePipeline); }
+}
+
+void VulkanComputePipeline::Swap(VulkanComputePipeline& other)
+{
+    std::swap(logicalDevice, other.logicalDevice);
+    std::swap(layout, other.layout);
+    std::swap(computePipeline, other.computePipeline);
+}
+
+std::shared_ptr<VulkanComputePipeline> VulkanComputePipeline::CreateVulkanComputePipeline(
+    vk::Device logicalDevice,
+    vk::PipelineCache pipelineCache,
+    const PipelineLayoutInfo& layout,
+    const std::vector<uint32_t>& computeShaderCode)
+{
+    VulkanComputePipeline obj{ logicalDevice, layout };
+    if (obj.CreateComputePipeline(pipelineCache, computeShaderCode))
+    {
+        return std::make_shared<VulkanComputePipeline>(std::move(obj));
+    }
+    return {};
+}
+
+bool VulkanComputePipeline::CreateComputePipeline(vk::PipelineCache pipelineCache,
+                                                  const std::vector<uint32_t>& compShaderCode)
+{
+    vk::ShaderModuleCreateInfo moduleCreateInfo = {};
+    moduleCreateInfo.codeSize = compShaderCode.size() * sizeof(uint32_t);
+    moduleCreateInfo.pCode = compShaderCode.data();
+
+    vk::ShaderModule compShaderModule;
+    if (logicalDevice.createShaderModule(&moduleCreateInfo, nullptr, &compShaderModule) !=
+        vk::Result::eSuccess)
+    {
+        EZLOG("Failed to create compute shader module!");
+        return false;
+    }
+
+    vk::ComputePipelineCreateInfo pipelineInfo = {};
+    pipelineInfo.stage.stage = vk::ShaderStageFlagBits::eCompute;
+    pipelineInfo.stage.module = compShaderModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = layout.pipelineLayout;
+
+    const vk::Result result = logicalDevice.createComputePipelines(
+        pipelineCache, 1, &pipelineInfo, nullptr, &computePipeline);
+    logicalDevice.destroyShaderModule(compShaderModule, nullptr);
+    if (result != vk::Result::eSuccess)
+    {
+        EZLOG("Failed to create compute pipeline!");
+        return false;
+    }
+    return true;
+}
+}  // namespace ez
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "render/vulkan/vulkan_layout_cache.hpp"
+#include "render/vulkan_include.hpp"
+
+namespace ez
+{
+class VulkanComputePipeline
+{
+   public:
+    VulkanComputePipeline(VulkanComputePipeline&& other);
+    ~VulkanComputePipeline();
+
+    vk::Pipeline GetPipeline() const { return computePipeline; }
+    vk::PipelineLayout GetPipelineLayout() const { return layout.pipelineLayout; }
+    // null if the pipeline has no such set
+    vk::DescriptorSetLayout GetDescriptorSetLayout(uint32_t set) const
+    {
+        return set < layout.descriptorSetLayouts.size() ? layout.descriptorSetLayouts[set]
+                                                         : vk::DescriptorSetLayout{};
+    }
+
+    // exchanges the Vulkan objects, everyone holding this pipeline gets the other one's
+    void Swap(VulkanComputePipeline& other);
+
+    static std::shared_ptr<VulkanComputePipeline> CreateVulkanComputePipeline(
+        vk::Device logicalDevice,
+        vk::PipelineCache pipelineCache,
+        const PipelineLayoutInfo& layout,
+        const std::vector<uint32_t>& computeShaderCode);
+
+   private:
+    VulkanComputePipeline(vk::Device aLogicalDevice, const PipelineLayoutInfo& aLayout);
+
+    bool CreateComputePipeline(vk::PipelineCache pipelineCache,
+                               const std::vector<uint32_t>& compShaderCode);
+
+    vk::Device logicalDevice;
+    // owned by VulkanLayoutCache
+    PipelineLayoutInfo layout;
+    vk::Pipeline computePipeline;
+};
+
+}  // namespace ez
@@ -0,0 +1,119 @@
+#include "vulkan_descriptor_allocator.hpp"
+
+#include "core/hash_combine.hpp"
+#include "core/log_assert.hpp"
+#include "render/config.hpp"
+#include "render/graphics_result.hpp"
+
+namespace ez
+{
+size_t VulkanDescriptorAllocator::SharedSetKeyHash::operator()(const SharedSetKey& key) const
+{
+    size_t seed = 0;
+    HashCombine(seed, static_cast<VkDescriptorSetLayout>(key.layout));
+    for (uint64_t value : key.content)
+    {
+        HashCombine(seed, value);
+    }
+    return seed;
+}
+
+VulkanDescriptorAllocator::VulkanDescriptorAllocator(vk::Device aLogicalDevice)
+    : logicalDevice(aLogicalDevice)
+{
+}
+
+VulkanDescriptorAllocator::~VulkanDescriptorAllocator()
+{
+    for (vk::DescriptorPool pool : pools)
+    {
+        logicalDevice.destroyDescriptorPool(pool);
+    }
+}
+
+vk::DescriptorPool VulkanDescriptorAllocator::CreatePool()
+{
+    std::vector<vk::DescriptorPoolSize> poolSizes;
+    for (const auto& [type, count] : Config::SceneDescriptorPoolSizes)
+    {
+        poolSizes.emplace_back(type, count);
+    }
+
+    vk::DescriptorPoolCreateInfo poolCI{};
+    poolCI.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolCI.pPoolSizes = poolSizes.data();
+    poolCI.maxSets = Config::SceneDescriptorPoolMaxSets;
+
+    vk::DescriptorPool pool;
+    if (logicalDevice.createDescriptorPool(&poolCI, nullptr, &pool) != vk::Result::eSuccess)
+    {
+        EZLOG("Failed to create scene descriptor pool");
+        return {};
+    }
+    pools.push_back(pool);
+    return pool;
+}
+
+vk::DescriptorSet VulkanDescriptorAllocator::Allocate(vk::DescriptorSetLayout layout)
+{
+    vk::DescriptorSetAllocateInfo descriptorSetAllocInfo{};
+    descriptorSetAllocInfo.pSetLayouts = &layout;
+    descriptorSetAllocInfo.descriptorSetCount = 1;
+
+    // a fresh pool is tried once, a set that doesn't fit into it never will
+    while (true)
+    {
+        const bool isFreshPool = currentPool == pools.size();
+        if (isFreshPool && !CreatePool()) { return {}; }
+
+        descriptorSetAllocInfo.descriptorPool = pools[currentPool];
+        vk::DescriptorSet descriptorSet;
+        const vk::Result result =
+            logicalDevice.allocateDescriptorSets(&descriptorSetAllocInfo, &descriptorSet);
+        if (result == vk::Result::eSuccess)
+        {
+            ++setsCount;
+            return descriptorSet;
+        }
+        if (isFreshPool ||
+            (result != vk::Result::eErrorOutOfPoolMemory &&
+             result != vk::Result::eErrorFragmentedPool))
+        {
+            CheckVkResult(result);
+            return {};
+        }
+        ++currentPool;
+    }
+}
+
+vk::DescriptorSet VulkanDescriptorAllocator::AllocateShared(vk::DescriptorSetLayout layout,
+                                                            const ContentKey& contentKey,
+                                                            bool& isNew)
+{
+    SharedSetKey key{ layout, contentKey };
+    const auto it = sharedSets.find(key);
+    if (it != sharedSets.end())
+    {
+        isNew = false;
+        ++sharedSetHitsCount;
+        return it->second;
+    }
+
+    isNew = true;
+    const vk::DescriptorSet descriptorSet = Allocate(layout);
+    if (descriptorSet) { sharedSets.emplace(std::move(key), descriptorSet); }
+    return descriptorSet;
+}
+
+void VulkanDescriptorAllocator::Reset()
+{
+    for (vk::DescriptorPool pool : pools)
+    {
+        logicalDevice.resetDescriptorPool(pool);
+    }
+    currentPool = 0;
+    sharedSets.clear();
+    setsCount = 0;
+    sharedSetHitsCount = 0;
+}
+}  // namespace ez
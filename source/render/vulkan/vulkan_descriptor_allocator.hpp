@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "render/vulkan_include.hpp"
+
+namespace ez
+{
+// Allocates descriptor sets that live as long as the resources they point to (e.g. a scene).
+// Sets come from a growing list of pools and are never freed one by one, Reset recycles them
+// all at once. Sets with the same layout and content key are allocated once and shared.
+class VulkanDescriptorAllocator
+{
+   public:
+    // identity of what a set points to, e.g. texture handles; compared in full, not by hash
+    using ContentKey = std::vector<uint64_t>;
+
+    VulkanDescriptorAllocator(vk::Device aLogicalDevice);
+    VulkanDescriptorAllocator(const VulkanDescriptorAllocator&) = delete;
+    ~VulkanDescriptorAllocator();
+
+    // returns null if the set can't be allocated even from a new pool
+    vk::DescriptorSet Allocate(vk::DescriptorSetLayout layout);
+
+    // shared set for layout and contentKey, isNew tells the caller it has to write it
+    vk::DescriptorSet AllocateShared(vk::DescriptorSetLayout layout,
+                                     const ContentKey& contentKey,
+                                     bool& isNew);
+
+    // all sets become invalid, must not be in use by the GPU
+    void Reset();
+
+    uint32_t GetPoolsCount() const { return static_cast<uint32_t>(pools.size()); }
+    uint32_t GetSetsCount() const { return setsCount; }
+    uint32_t GetSharedSetsCount() const { return static_cast<uint32_t>(sharedSets.size()); }
+    uint32_t GetSharedSetHitsCount() const { return sharedSetHitsCount; }
+
+   private:
+    struct SharedSetKey final
+    {
+        vk::DescriptorSetLayout layout;
+        ContentKey content;
+
+        bool operator==(const SharedSetKey& other) const
+        {
+            return layout == other.layout && content == other.content;
+        }
+    };
+
+    struct SharedSetKeyHash final
+    {
+        size_t operator()(const SharedSetKey& key) const;
+    };
+
+    vk::DescriptorPool CreatePool();
+
+    vk::Device logicalDevice;
+
+    std::vector<vk::DescriptorPool> pools;
+    // pools before it are full until the next Reset
+    size_t currentPool = 0;
+
+    std::unordered_map<SharedSetKey, vk::DescriptorSet, SharedSetKeyHash> sharedSets;
+    uint32_t setsCount = 0;
+    uint32_t sharedSetHitsCount = 0;
+};
+}  // namespace ez
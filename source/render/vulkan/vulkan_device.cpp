@@ -2,10 +2,13 @@
 
 #include <SDL_vulkan.h>
 
+#include <cstring>
+#include <fstream>
 #include <map>
 #include <set>
 #include <string>
 
+#include "core/file_utils.hpp"
 #include "core/log_assert.hpp"
 #include "render/config.hpp"
 #include "render/vulkan/vulkan_swapchain.hpp"
@@ -122,6 +125,23 @@ VulkanDevice::VulkanDevice(vk::Instance aInstance,
     EZLOG("Color + Depth supported MSAA samples count:", maxSamplesStr);
 
     msaa8xSupported = (maxSamples & vk::SampleCountFlagBits::e8) == vk::SampleCountFlagBits::e8;
+    bindlessSupported = CheckBindlessSupport(physicalDevice);
+
+    pipelineCache = CreatePipelineCache(device, physicalDeviceProperties);
+}
+
+bool VulkanDevice::CheckBindlessSupport(vk::PhysicalDevice device)
+{
+    vk::PhysicalDeviceVulkan12Features features12 = {};
+    vk::PhysicalDeviceFeatures2 features2 = {};
+    features2.pNext = &features12;
+    device.getFeatures2(&features2);
+
+    return features12.descriptorIndexing && features12.runtimeDescriptorArray &&
+           features12.descriptorBindingPartiallyBound &&
+           features12.descriptorBindingSampledImageUpdateAfterBind &&
+           features12.descriptorBindingUpdateUnusedWhilePending &&
+           features12.shaderSampledImageArrayNonUniformIndexing;
 }
 
 bool VulkanDevice::CheckDeviceExtensionSupport(vk::PhysicalDevice device)
@@ -210,12 +230,27 @@ ResultValue<vk::Device> VulkanDevice::CreateDevice(vk::PhysicalDevice physicalDe
         queueCreateInfos.push_back(queueCreateInfo);
     }
 
+    vk::PhysicalDeviceFeatures supportedFeatures;
+    physicalDevice.getFeatures(&supportedFeatures);
+
     vk::PhysicalDeviceFeatures deviceFeatures = {};
     deviceFeatures.samplerAnisotropy = VK_TRUE;  // request for anisotropy
+    // cooked textures are BC compressed, Texture checks format support before upload
+    deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
 
     vk::PhysicalDeviceVulkan12Features device12Features = {};
     device12Features.separateDepthStencilLayouts =
         VK_TRUE;  // request for separate depth-stencil
+    // descriptor indexing (core in 1.2) for bindless material textures
+    if (CheckBindlessSupport(physicalDevice))
+    {
+        device12Features.descriptorIndexing = VK_TRUE;
+        device12Features.runtimeDescriptorArray = VK_TRUE;
+        device12Features.descriptorBindingPartiallyBound = VK_TRUE;
+        device12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        device12Features.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        device12Features.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+    }
 
     vk::DeviceCreateInfo createInfo = {};
     createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
@@ -291,8 +326,73 @@ ResultValue<vk::DescriptorPool> VulkanDevice::CreateDescriptorPool(vk::Device de
     return { GraphicsResult::Ok, descriptorPool };
 }
 
+// Data saved by another driver or GPU is rejected by the header check, an empty cache is
+// created then. Failing to create even that is not fatal, pipelines are created without cache.
+vk::PipelineCache VulkanDevice::CreatePipelineCache(
+    vk::Device device, const vk::PhysicalDeviceProperties& properties)
+{
+    std::vector<char> data;
+    std::ifstream file(Config::PipelineCachePath, std::ios::binary);
+    if (file.is_open())
+    {
+        data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+
+    VkPipelineCacheHeaderVersionOne header{};
+    if (data.size() >= sizeof(header)) { memcpy(&header, data.data(), sizeof(header)); }
+    const bool isValid =
+        data.size() >= sizeof(header) && header.headerSize >= sizeof(header) &&
+        header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+        header.vendorID == properties.vendorID && header.deviceID == properties.deviceID &&
+        memcmp(header.pipelineCacheUUID, properties.pipelineCacheUUID.data(), VK_UUID_SIZE) ==
+            0;
+    if (!data.empty() && !isValid)
+    {
+        EZLOG("Pipeline cache was saved for another device or driver, ignoring it");
+    }
+    if (isValid) { EZLOG("Pipeline cache loaded,", data.size(), "bytes"); }
+
+    vk::PipelineCacheCreateInfo pipelineCacheCI{};
+    pipelineCacheCI.initialDataSize = isValid ? data.size() : 0;
+    pipelineCacheCI.pInitialData = isValid ? data.data() : nullptr;
+
+    vk::PipelineCache pipelineCache;
+    if (device.createPipelineCache(&pipelineCacheCI, nullptr, &pipelineCache) !=
+        vk::Result::eSuccess)
+    {
+        EZLOG("Failed to create pipeline cache");
+        return {};
+    }
+    return pipelineCache;
+}
+
+void VulkanDevice::SavePipelineCache()
+{
+    if (!pipelineCache) { return; }
+
+    size_t size = 0;
+    if (device.getPipelineCacheData(pipelineCache, &size, nullptr) != vk::Result::eSuccess)
+    {
+        return;
+    }
+    std::vector<char> data(size);
+    if (device.getPipelineCacheData(pipelineCache, &size, data.data()) != vk::Result::eSuccess)
+    {
+        EZLOG("Failed to get pipeline cache data");
+        return;
+    }
+    data.resize(size);
+
+    FileUtils::WriteFileAtomically(Config::PipelineCachePath, [&](std::ostream& file) {
+        file.write(data.data(), static_cast<std::streamsize>(data.size()));
+    });
+}
+
 VulkanDevice::~VulkanDevice()
 {
+    SavePipelineCache();
+    device.destroyPipelineCache(pipelineCache);
+
     device.destroyCommandPool(graphicsCommandPool);
     device.destroyCommandPool(computeCommandPool);
     device.destroyDescriptorPool(descriptorPool);
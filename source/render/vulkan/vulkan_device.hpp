@@ -41,8 +41,12 @@ class VulkanDevice
     vk::CommandPool GetGraphicsCommandPool() const { return graphicsCommandPool; }
     vk::CommandPool GetComputeCommandPool() const { return computeCommandPool; }
     vk::DescriptorPool GetDescriptorPool() const { return descriptorPool; }
+    // shared by all pipeline creation, loaded from and saved to Config::PipelineCachePath
+    vk::PipelineCache GetPipelineCache() const { return pipelineCache; }
 
     bool IsMSAA8xSupported() const { return msaa8xSupported; }
+    // descriptor indexing features needed by BindlessMaterials are enabled
+    bool IsBindlessSupported() const { return bindlessSupported; }
 
     static ResultValue<std::unique_ptr<VulkanDevice>> CreateVulkanDevice(vk::Instance instance);
 
@@ -51,11 +55,15 @@ class VulkanDevice
 
     static bool IsDeviceSuitable(vk::PhysicalDevice, vk::SurfaceKHR);
     static bool CheckDeviceExtensionSupport(vk::PhysicalDevice);
+    static bool CheckBindlessSupport(vk::PhysicalDevice);
 
     static ResultValue<vk::Device> CreateDevice(vk::PhysicalDevice, const QueueFamilyIndices&);
     static ResultValue<vk::CommandPool> CreateCommandPool(vk::Device,
                                                           uint32_t queueFamilyIndex);
     static ResultValue<vk::DescriptorPool> CreateDescriptorPool(vk::Device device);
+    static vk::PipelineCache CreatePipelineCache(
+        vk::Device device, const vk::PhysicalDeviceProperties& properties);
+    void SavePipelineCache();
 
     vk::Instance instance;
     vk::PhysicalDevice physicalDevice;
@@ -70,10 +78,12 @@ class VulkanDevice
     vk::CommandPool graphicsCommandPool;
     vk::CommandPool computeCommandPool;
     vk::DescriptorPool descriptorPool;
+    vk::PipelineCache pipelineCache;
 
     QueueFamilyIndices queueFamilyIndices;
 
     bool msaa8xSupported = false;
+    bool bindlessSupported = false;
 };
 
 }  // namespace ez
@@ -1,56 +1,63 @@
 #include "vulkan_graphics_pipeline.hpp"
 
+#include <algorithm>
+#include <array>
+#include <utility>
+
 #include "core/file_utils.hpp"
 #include "core/log_assert.hpp"
 #include "render/config.hpp"
-#include "render/highlevel/mesh.hpp"
-#include "render/vulkan/vulkan_shader_compiler.hpp"
 
 namespace ez
 {
-VulkanGraphicsPipeline::VulkanGraphicsPipeline(vk::Device aLogicalDevice)
+VulkanGraphicsPipeline::VulkanGraphicsPipeline(vk::Device aLogicalDevice,
+                                               const PipelineLayoutInfo& aLayout)
     : logicalDevice(aLogicalDevice)
+    , layout(aLayout)
 {
 }
 
 VulkanGraphicsPipeline::VulkanGraphicsPipeline(VulkanGraphicsPipeline&& other)
 {
     logicalDevice = other.logicalDevice;
-    pipelineLayout = other.pipelineLayout;
+    layout = std::move(other.layout);
     graphicsPipeline = other.graphicsPipeline;
 
     other.logicalDevice = nullptr;
-    other.pipelineLayout = nullptr;
     other.graphicsPipeline = nullptr;
 }
 
 VulkanGraphicsPipeline::~VulkanGraphicsPipeline()
 {
-    if (logicalDevice)
-    {
-        logicalDevice.destroyPipeline(graphicsPipeline);
-        logicalDevice.destroyPipelineLayout(pipelineLayout);
-    }
+    if (logicalDevice) { logicalDevice.destroyPipeline(graphicsPipeline); }
+}
+
+void VulkanGraphicsPipeline::Swap(VulkanGraphicsPipeline& other)
+{
+    std::swap(logicalDevice, other.logicalDevice);
+    std::swap(layout, other.layout);
+    std::swap(graphicsPipeline, other.graphicsPipeline);
 }
 
 std::shared_ptr<VulkanGraphicsPipeline> VulkanGraphicsPipeline::CreateVulkanGraphicsPipeline(
     vk::Device logicalDevice,
-    vk::Extent2D swapchainExtent,
+    vk::PipelineCache pipelineCache,
     vk::RenderPass renderPass,
-    const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts,
+    const PipelineLayoutInfo& layout,
     VertexLayout vertexLayout,
     vk::CompareOp depthCompareOp,
-    const std::string& vertexShaderName,
-    const std::string& fragmentShaderName)
+    ShaderPermutation permutation,
+    const std::vector<uint32_t>& vertexShaderCode,
+    const std::vector<uint32_t>& fragmentShaderCode)
 {
-    VulkanGraphicsPipeline obj{ logicalDevice };
-    if (obj.CreateGraphicsPipeline(swapchainExtent,
+    VulkanGraphicsPipeline obj{ logicalDevice, layout };
+    if (obj.CreateGraphicsPipeline(pipelineCache,
                                    renderPass,
-                                   descriptorSetLayouts,
                                    vertexLayout,
                                    depthCompareOp,
-                                   vertexShaderName,
-                                   fragmentShaderName))
+                                   permutation,
+                                   vertexShaderCode,
+                                   fragmentShaderCode))
     {
         return std::make_shared<VulkanGraphicsPipeline>(std::move(obj));
     }
@@ -74,18 +81,30 @@ vk::ShaderModule VulkanGraphicsPipeline::CreateShaderModule(const std::vector<ui
 }
 
 bool VulkanGraphicsPipeline::CreateGraphicsPipeline(
-    vk::Extent2D swapchainExtent,
+    vk::PipelineCache pipelineCache,
     vk::RenderPass renderPass,
-    const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts,
     VertexLayout vertexLayout,
     vk::CompareOp depthCompareOp,
-    const std::string& vertexShaderName,
-    const std::string& fragmentShaderName)
+    ShaderPermutation permutation,
+    const std::vector<uint32_t>& vertShaderCode,
+    const std::vector<uint32_t>& fragShaderCode)
 {
-    const std::vector<uint32_t> vertShaderCode =
-        SpirVShaderCompiler::CompileFromGLSL(vertexShaderName);
-    const std::vector<uint32_t> fragShaderCode =
-        SpirVShaderCompiler::CompileFromGLSL(fragmentShaderName);
+    auto bindingDescription = ez::Vertex::getBindingDescription();
+    auto attributeDescriptions = ez::Vertex::getAttributeDescriptions(vertexLayout);
+
+    // attributes the shader doesn't read are fine
+    for (const SpirVReflection::VertexInput& input : layout.shaderInterface.vertexInputs)
+    {
+        const auto attribute =
+            std::find_if(attributeDescriptions.begin(),
+                         attributeDescriptions.end(),
+                         [&input](const auto& a) { return a.location == input.location; });
+        if (attribute == attributeDescriptions.end() || attribute->format != input.format)
+        {
+            EZLOG("Vertex layout doesn't match shader input at location", input.location);
+            return false;
+        }
+    }
 
     vk::ShaderModule vertShaderModule = CreateShaderModule(vertShaderCode);
     vk::ShaderModule fragShaderModule = CreateShaderModule(fragShaderCode);
@@ -100,14 +119,26 @@ bool VulkanGraphicsPipeline::CreateGraphicsPipeline(
     fragShaderStageInfo.module = fragShaderModule;
     fragShaderStageInfo.pName = "main";
 
+    // a VkBool32 per material feature, constants a shader doesn't declare are ignored
+    std::array<vk::Bool32, ShaderFeaturesCount> specializationData;
+    std::array<vk::SpecializationMapEntry, ShaderFeaturesCount> specializationEntries;
+    for (uint32_t i = 0; i < ShaderFeaturesCount; ++i)
+    {
+        specializationData[i] = (permutation >> i) & 1u;
+        specializationEntries[i] = vk::SpecializationMapEntry(
+            i, i * static_cast<uint32_t>(sizeof(vk::Bool32)), sizeof(vk::Bool32));
+    }
+    vk::SpecializationInfo specializationInfo = {};
+    specializationInfo.mapEntryCount = ShaderFeaturesCount;
+    specializationInfo.pMapEntries = specializationEntries.data();
+    specializationInfo.dataSize = sizeof(specializationData);
+    specializationInfo.pData = specializationData.data();
+    fragShaderStageInfo.pSpecializationInfo = &specializationInfo;
+
     vk::PipelineShaderStageCreateInfo shaderStages[] = { vertShaderStageInfo,
                                                          fragShaderStageInfo };
 
     vk::PipelineVertexInputStateCreateInfo vertexInputInfo = {};
-
-    auto bindingDescription = ez::Vertex::getBindingDescription();
-    auto attributeDescriptions = ez::Vertex::getAttributeDescriptions(vertexLayout);
-
     vertexInputInfo.vertexBindingDescriptionCount = 1;
     vertexInputInfo.vertexAttributeDescriptionCount =
         static_cast<uint32_t>(attributeDescriptions.size());
@@ -118,23 +149,16 @@ bool VulkanGraphicsPipeline::CreateGraphicsPipeline(
     inputAssembly.topology = vk::PrimitiveTopology::eTriangleList;
     inputAssembly.primitiveRestartEnable = VK_FALSE;
 
-    vk::Viewport viewport = {};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapchainExtent.width);
-    viewport.height = static_cast<float>(swapchainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-
-    vk::Rect2D scissor = {};
-    scissor.offset = vk::Offset2D{ 0, 0 };
-    scissor.extent = swapchainExtent;
-
+    // set with the command buffer, the pipeline doesn't depend on the swapchain extent
     vk::PipelineViewportStateCreateInfo viewportState = {};
     viewportState.viewportCount = 1;
-    viewportState.pViewports = &viewport;
     viewportState.scissorCount = 1;
-    viewportState.pScissors = &scissor;
+
+    const std::array<vk::DynamicState, 2> dynamicStates = { vk::DynamicState::eViewport,
+                                                            vk::DynamicState::eScissor };
+    vk::PipelineDynamicStateCreateInfo dynamicState = {};
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(dynamicStates.size());
+    dynamicState.pDynamicStates = dynamicStates.data();
 
     vk::PipelineRasterizationStateCreateInfo rasterizer = {};
     rasterizer.depthClampEnable = VK_FALSE;
@@ -172,24 +196,6 @@ bool VulkanGraphicsPipeline::CreateGraphicsPipeline(
     depthStencilState.depthTestEnable = true;
     depthStencilState.depthCompareOp = depthCompareOp;
 
-    static_assert(Mesh::PushConstantsBlockSize <= 128);
-    vk::PushConstantRange pushConstantRange(
-        vk::ShaderStageFlagBits::eVertex, 0, Mesh::PushConstantsBlockSize);
-
-    vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
-        vk::PipelineLayoutCreateFlags{},
-        static_cast<uint32_t>(descriptorSetLayouts.size()),
-        descriptorSetLayouts.data(),
-        1,
-        &pushConstantRange);
-
-    if (logicalDevice.createPipelineLayout(&pipelineLayoutInfo, nullptr, &pipelineLayout) !=
-        vk::Result::eSuccess)
-    {
-        EZLOG("Failed to create pipeline layout!");
-        return false;
-    }
-
     vk::GraphicsPipelineCreateInfo pipelineInfo = {};
     pipelineInfo.stageCount = 2;
     pipelineInfo.pStages = shaderStages;
@@ -200,12 +206,14 @@ bool VulkanGraphicsPipeline::CreateGraphicsPipeline(
     pipelineInfo.pMultisampleState = &multisampling;
     pipelineInfo.pColorBlendState = &colorBlending;
     pipelineInfo.pDepthStencilState = &depthStencilState;
-    pipelineInfo.layout = pipelineLayout;
+    pipelineInfo.pDynamicState = &dynamicState;
+    pipelineInfo.layout = layout.pipelineLayout;
     pipelineInfo.renderPass = renderPass;
     pipelineInfo.subpass = 0;
 
     if (logicalDevice.createGraphicsPipelines(
-            nullptr, 1, &pipelineInfo, nullptr, &graphicsPipeline) != vk::Result::eSuccess)
+            pipelineCache, 1, &pipelineInfo, nullptr, &graphicsPipeline) !=
+        vk::Result::eSuccess)
     {
         EZLOG("Failed to create graphics pipeline!");
         return false;
@@ -4,10 +4,13 @@
 #include <vector>
 
 #include "render/highlevel/primitive.hpp"
+#include "render/vulkan/vulkan_layout_cache.hpp"
 #include "render/vulkan_include.hpp"
 
 namespace ez
 {
+// Viewport and scissor are dynamic state, set them after binding. Pipelines don't depend on the
+// swapchain extent and survive window resizes.
 class VulkanGraphicsPipeline
 {
    public:
@@ -15,32 +18,52 @@ class VulkanGraphicsPipeline
     ~VulkanGraphicsPipeline();
 
     vk::Pipeline GetPipeline() const { return graphicsPipeline; }
-    vk::PipelineLayout GetPipelineLayout() const { return pipelineLayout; }
+    vk::PipelineLayout GetPipelineLayout() const { return layout.pipelineLayout; }
+    // null if the pipeline has no such set
+    vk::DescriptorSetLayout GetDescriptorSetLayout(uint32_t set) const
+    {
+        return set < layout.descriptorSetLayouts.size() ? layout.descriptorSetLayouts[set]
+                                                         : vk::DescriptorSetLayout{};
+    }
+    // the optimizer removes resources the shaders don't use, they are not in the layout then
+    bool HasDescriptorBinding(uint32_t set, uint32_t binding) const
+    {
+        return layout.shaderInterface.HasBinding(set, binding);
+    }
+    bool HasPushConstants(vk::ShaderStageFlags stage) const
+    {
+        return layout.shaderInterface.HasPushConstants(stage);
+    }
+
+    // exchanges the Vulkan objects, everyone holding this pipeline gets the other one's
+    void Swap(VulkanGraphicsPipeline& other);
 
     static std::shared_ptr<VulkanGraphicsPipeline> CreateVulkanGraphicsPipeline(
         vk::Device logicalDevice,
-        vk::Extent2D swapchainExtent,
+        vk::PipelineCache pipelineCache,
         vk::RenderPass renderPass,
-        const std::vector<vk::DescriptorSetLayout>& descriptorSetLayout,
+        const PipelineLayoutInfo& layout,
         VertexLayout vertexLayout,
         vk::CompareOp depthCompareOp,
-        const std::string& vertexShaderName,
-        const std::string& fragmentShaderName);
+        ShaderPermutation permutation,
+        const std::vector<uint32_t>& vertexShaderCode,
+        const std::vector<uint32_t>& fragmentShaderCode);
 
    private:
-    VulkanGraphicsPipeline(vk::Device aLogicalDevice);
+    VulkanGraphicsPipeline(vk::Device aLogicalDevice, const PipelineLayoutInfo& aLayout);
 
     vk::ShaderModule CreateShaderModule(const std::vector<uint32_t>& code);
-    bool CreateGraphicsPipeline(vk::Extent2D swapchainExtent,
+    bool CreateGraphicsPipeline(vk::PipelineCache pipelineCache,
                                 vk::RenderPass renderPass,
-                                const std::vector<vk::DescriptorSetLayout>& descriptorSetLayout,
                                 VertexLayout vertexLayout,
                                 vk::CompareOp depthCompareOp,
-                                const std::string& vertexShaderName,
-                                const std::string& fragmentShaderName);
+                                ShaderPermutation permutation,
+                                const std::vector<uint32_t>& vertShaderCode,
+                                const std::vector<uint32_t>& fragShaderCode);
 
     vk::Device logicalDevice;
-    vk::PipelineLayout pipelineLayout;
+    // owned by VulkanLayoutCache
+    PipelineLayoutInfo layout;
     vk::Pipeline graphicsPipeline;
 };
 
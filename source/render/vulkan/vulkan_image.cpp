@@ -1,5 +1,7 @@
 #include "vulkan_image.hpp"
 
+#include <algorithm>
+
 #include "core/log_assert.hpp"
 #include "render/vulkan/vulkan_buffer.hpp"
 #include "render/vulkan/vulkan_command_buffer.hpp"
@@ -14,7 +16,8 @@ ResultValue<vk::Image> CreateImage2D(vk::Device logicalDevice,
                                      uint32_t height,
                                      uint32_t layersCount,
                                      vk::ImageCreateFlags imageCreateFlags,
-                                     vk::SampleCountFlagBits samplesCount)
+                                     vk::SampleCountFlagBits samplesCount,
+                                     const std::vector<uint32_t>& sharingQueueFamilies)
 {
     vk::Image image;
 
@@ -27,7 +30,14 @@ ResultValue<vk::Image> CreateImage2D(vk::Device logicalDevice,
     imageCreateInfo.setSamples(samplesCount);
     imageCreateInfo.setTiling(vk::ImageTiling::eOptimal);
     imageCreateInfo.setUsage(usage);
-    imageCreateInfo.setSharingMode(vk::SharingMode::eExclusive);
+    if (sharingQueueFamilies.size() > 1)
+    {
+        imageCreateInfo.setSharingMode(vk::SharingMode::eConcurrent);
+        imageCreateInfo.setQueueFamilyIndexCount(
+            static_cast<uint32_t>(sharingQueueFamilies.size()));
+        imageCreateInfo.setPQueueFamilyIndices(sharingQueueFamilies.data());
+    }
+    else { imageCreateInfo.setSharingMode(vk::SharingMode::eExclusive); }
     imageCreateInfo.setInitialLayout(vk::ImageLayout::eUndefined);
     imageCreateInfo.setExtent(vk::Extent3D(width, height, 1));
 
@@ -49,7 +59,9 @@ ResultValue<ImageWithMemory> CreateImage2DWithMemory(vk::Device logicalDevice,
                                                      uint32_t height,
                                                      uint32_t layersCount,
                                                      vk::ImageCreateFlags imageCreateFlags,
-                                                     vk::SampleCountFlagBits samplesCount)
+                                                     vk::SampleCountFlagBits samplesCount,
+                                                     const std::vector<uint32_t>&
+                                                         sharingQueueFamilies)
 {
     ResultValue<vk::Image> imageRV = CreateImage2D(logicalDevice,
                                                    format,
@@ -59,7 +71,8 @@ ResultValue<ImageWithMemory> CreateImage2DWithMemory(vk::Device logicalDevice,
                                                    height,
                                                    layersCount,
                                                    imageCreateFlags,
-                                                   samplesCount);
+                                                   samplesCount,
+                                                   sharingQueueFamilies);
     if (imageRV.result != GraphicsResult::Ok) { return imageRV.result; }
     vk::Image image = imageRV.value;
     vk::DeviceMemory imageMemory;
@@ -113,12 +126,13 @@ bool GenerateMipsForImage(vk::Device logicalDevice,
                           vk::Image image,
                           uint32_t width,
                           uint32_t height,
+                          uint32_t layersCount,
                           uint32_t mipLevels)
 {
     vk::ImageSubresourceRange subresourceRange = {};
     subresourceRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
     subresourceRange.setLevelCount(1);
-    subresourceRange.setLayerCount(1);
+    subresourceRange.setLayerCount(layersCount);
 
     VulkanOneTimeCommandBuffer blitOneTimeCB =
         VulkanOneTimeCommandBuffer::Start(logicalDevice, graphicsCommandPool);
@@ -128,23 +142,26 @@ bool GenerateMipsForImage(vk::Device logicalDevice,
         vk::ImageBlit imageBlit{};
 
         imageBlit.srcSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
-        imageBlit.srcSubresource.setLayerCount(1);
+        imageBlit.srcSubresource.setLayerCount(layersCount);
         imageBlit.srcSubresource.setMipLevel(i - 1);
-        imageBlit.setSrcOffsets(
-            { vk::Offset3D{},
-              vk::Offset3D(int32_t(width >> (i - 1)), int32_t(height >> (i - 1)), 1) });
+        imageBlit.setSrcOffsets({ vk::Offset3D{},
+                                  vk::Offset3D(int32_t(std::max(width >> (i - 1), 1u)),
+                                               int32_t(std::max(height >> (i - 1), 1u)),
+                                               1) });
 
         imageBlit.dstSubresource.setAspectMask(vk::ImageAspectFlagBits::eColor);
-        imageBlit.dstSubresource.setLayerCount(1);
+        imageBlit.dstSubresource.setLayerCount(layersCount);
         imageBlit.dstSubresource.setMipLevel(i);
-        imageBlit.setDstOffsets(
-            { vk::Offset3D{}, vk::Offset3D(int32_t(width >> i), int32_t(height >> i), 1) });
+        imageBlit.setDstOffsets({ vk::Offset3D{},
+                                  vk::Offset3D(int32_t(std::max(width >> i, 1u)),
+                                               int32_t(std::max(height >> i, 1u)),
+                                               1) });
 
         vk::ImageSubresourceRange mipSubRange = {};
         mipSubRange.setAspectMask(vk::ImageAspectFlagBits::eColor);
         mipSubRange.setBaseMipLevel(i);
         mipSubRange.setLevelCount(1);
-        mipSubRange.setLayerCount(1);
+        mipSubRange.setLayerCount(layersCount);
 
         SubmitChangeImageLayout(blitOneTimeCB.GetCommandBuffer(),
                                 vk::PipelineStageFlagBits::eTransfer,
@@ -178,14 +195,15 @@ bool GenerateMipsForImage(vk::Device logicalDevice,
     subresourceRange.setLevelCount(mipLevels);
 
     SubmitChangeImageLayout(blitOneTimeCB.GetCommandBuffer(),
-                            vk::PipelineStageFlagBits::eAllCommands,
-                            vk::PipelineStageFlagBits::eAllCommands,
+                            vk::PipelineStageFlagBits::eTransfer,
+                            vk::PipelineStageFlagBits::eFragmentShader |
+                                vk::PipelineStageFlagBits::eComputeShader,
                             image,
                             subresourceRange,
                             vk::ImageLayout::eTransferSrcOptimal,
                             vk::ImageLayout::eShaderReadOnlyOptimal,
                             vk::AccessFlagBits::eTransferWrite,
-                            vk::AccessFlagBits::eTransferRead);
+                            vk::AccessFlagBits::eShaderRead);
 
     blitOneTimeCB.EndSubmitAndWait(graphicsQueue);
 
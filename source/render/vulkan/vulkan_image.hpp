@@ -1,4 +1,7 @@
 #pragma once
+
+#include <vector>
+
 #include "render/graphics_result.hpp"
 #include "render/vulkan_include.hpp"
 
@@ -20,7 +23,8 @@ ResultValue<vk::Image> CreateImage2D(vk::Device logicalDevice,
                                      uint32_t height,
                                      uint32_t layersCount,
                                      vk::ImageCreateFlags imageCreateFlags,
-                                     vk::SampleCountFlagBits samplesCount);
+                                     vk::SampleCountFlagBits samplesCount,
+                                     const std::vector<uint32_t>& sharingQueueFamilies = {});
 
 ResultValue<ImageWithMemory> CreateImage2DWithMemory(vk::Device logicalDevice,
                                                      vk::PhysicalDevice physicalDevice,
@@ -31,7 +35,9 @@ ResultValue<ImageWithMemory> CreateImage2DWithMemory(vk::Device logicalDevice,
                                                      uint32_t height,
                                                      uint32_t layersCount,
                                                      vk::ImageCreateFlags imageCreateFlags,
-                                                     vk::SampleCountFlagBits samplesCount);
+                                                     vk::SampleCountFlagBits samplesCount,
+                                                     const std::vector<uint32_t>&
+                                                         sharingQueueFamilies = {});
 
 ResultValue<vk::ImageView> CreateImageView(vk::ImageViewType imageViewType,
                                            vk::Device logicalDevice,
@@ -41,12 +47,15 @@ ResultValue<vk::ImageView> CreateImageView(vk::ImageViewType imageViewType,
                                            uint32_t layersCount,
                                            uint32_t mipLevelsCount);
 
+// blits mips of all layers one after another, mip 0 must be in eTransferSrcOptimal;
+// see MipGenerator for formats that can't be blitted
 bool GenerateMipsForImage(vk::Device logicalDevice,
                           vk::Queue graphicsQueue,
                           vk::CommandPool graphicsCommandPool,
                           vk::Image image,
                           uint32_t width,
                           uint32_t height,
+                          uint32_t layersCount,
                           uint32_t mipLevels);
 
 void SubmitChangeImageLayout(vk::CommandBuffer cb,
@@ -0,0 +1,149 @@
+#include "vulkan_layout_cache.hpp"
+
+#include <algorithm>
+
+#include "core/log_assert.hpp"
+#include "render/graphics_result.hpp"
+
+namespace ez
+{
+using SpirVReflection::DescriptorBinding;
+using SpirVReflection::ShaderInterface;
+
+VulkanLayoutCache::~VulkanLayoutCache()
+{
+    for (const auto& [key, pipelineLayout] : pipelineLayouts)
+    {
+        logicalDevice.destroyPipelineLayout(pipelineLayout);
+    }
+    for (const auto& [key, descriptorSetLayout] : descriptorSetLayouts)
+    {
+        logicalDevice.destroyDescriptorSetLayout(descriptorSetLayout);
+    }
+}
+
+std::optional<PipelineLayoutInfo> VulkanLayoutCache::GetPipelineLayout(
+    const ShaderInterface& shaderInterface,
+    const std::vector<vk::DescriptorSetLayout>& explicitLayouts)
+{
+    uint32_t setsCount = static_cast<uint32_t>(explicitLayouts.size());
+    for (const DescriptorBinding& binding : shaderInterface.bindings)
+    {
+        setsCount = std::max(setsCount, binding.set + 1);
+    }
+
+    PipelineLayoutInfo result;
+    result.shaderInterface = shaderInterface;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (uint32_t set = 0; set < setsCount; ++set)
+    {
+        if (set < explicitLayouts.size() && explicitLayouts[set])
+        {
+            result.descriptorSetLayouts.push_back(explicitLayouts[set]);
+            continue;
+        }
+
+        const std::vector<DescriptorBinding> bindings = shaderInterface.GetSetBindings(set);
+        for (const DescriptorBinding& binding : bindings)
+        {
+            if (binding.count == 0)
+            {
+                EZLOG("Runtime array at set", set, "binding", binding.binding,
+                      "needs an explicit layout");
+                return {};
+            }
+        }
+        const vk::DescriptorSetLayout descriptorSetLayout = GetDescriptorSetLayout(bindings);
+        if (!descriptorSetLayout) { return {}; }
+        result.descriptorSetLayouts.push_back(descriptorSetLayout);
+    }
+
+    result.pipelineLayout =
+        GetPipelineLayout(result.descriptorSetLayouts, shaderInterface.pushConstantRanges);
+    if (!result.pipelineLayout) { return {}; }
+    return result;
+}
+
+uint32_t VulkanLayoutCache::GetDescriptorSetLayoutsCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<uint32_t>(descriptorSetLayouts.size());
+}
+
+uint32_t VulkanLayoutCache::GetPipelineLayoutsCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return static_cast<uint32_t>(pipelineLayouts.size());
+}
+
+vk::DescriptorSetLayout VulkanLayoutCache::GetDescriptorSetLayout(
+    const std::vector<DescriptorBinding>& bindings)
+{
+    std::vector<uint64_t> key;
+    for (const DescriptorBinding& binding : bindings)
+    {
+        key.push_back((static_cast<uint64_t>(binding.binding) << 32) |
+                      static_cast<uint32_t>(binding.type));
+        key.push_back((static_cast<uint64_t>(binding.count) << 32) |
+                      static_cast<uint32_t>(binding.stages));
+    }
+    const auto it = descriptorSetLayouts.find(key);
+    if (it != descriptorSetLayouts.end()) { return it->second; }
+
+    std::vector<vk::DescriptorSetLayoutBinding> setLayoutBindings;
+    for (const DescriptorBinding& binding : bindings)
+    {
+        setLayoutBindings.emplace_back(
+            binding.binding, binding.type, binding.count, binding.stages, nullptr);
+    }
+    vk::DescriptorSetLayoutCreateInfo descriptorSetLayoutCI{};
+    descriptorSetLayoutCI.pBindings = setLayoutBindings.data();
+    descriptorSetLayoutCI.bindingCount = static_cast<uint32_t>(setLayoutBindings.size());
+
+    vk::DescriptorSetLayout descriptorSetLayout;
+    const vk::Result result = logicalDevice.createDescriptorSetLayout(
+        &descriptorSetLayoutCI, nullptr, &descriptorSetLayout);
+    CheckVkResult(result);
+    if (result != vk::Result::eSuccess) { return {}; }
+
+    descriptorSetLayouts.emplace(std::move(key), descriptorSetLayout);
+    return descriptorSetLayout;
+}
+
+vk::PipelineLayout VulkanLayoutCache::GetPipelineLayout(
+    const std::vector<vk::DescriptorSetLayout>& setLayouts,
+    const std::vector<vk::PushConstantRange>& pushConstantRanges)
+{
+    // sets count first, so that sets and ranges can't be confused
+    std::vector<uint64_t> key = { setLayouts.size() };
+    for (vk::DescriptorSetLayout setLayout : setLayouts)
+    {
+        const VkDescriptorSetLayout handle = setLayout;
+        key.push_back(reinterpret_cast<uint64_t>(handle));
+    }
+    for (const vk::PushConstantRange& range : pushConstantRanges)
+    {
+        key.push_back(static_cast<uint32_t>(range.stageFlags));
+        key.push_back((static_cast<uint64_t>(range.offset) << 32) | range.size);
+    }
+    const auto it = pipelineLayouts.find(key);
+    if (it != pipelineLayouts.end()) { return it->second; }
+
+    vk::PipelineLayoutCreateInfo pipelineLayoutInfo(
+        vk::PipelineLayoutCreateFlags{},
+        static_cast<uint32_t>(setLayouts.size()),
+        setLayouts.data(),
+        static_cast<uint32_t>(pushConstantRanges.size()),
+        pushConstantRanges.data());
+
+    vk::PipelineLayout pipelineLayout;
+    const vk::Result result =
+        logicalDevice.createPipelineLayout(&pipelineLayoutInfo, nullptr, &pipelineLayout);
+    CheckVkResult(result);
+    if (result != vk::Result::eSuccess) { return {}; }
+
+    pipelineLayouts.emplace(std::move(key), pipelineLayout);
+    return pipelineLayout;
+}
+}  // namespace ez
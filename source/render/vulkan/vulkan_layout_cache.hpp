@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "render/vulkan/spirv_reflection.hpp"
+#include "render/vulkan_include.hpp"
+
+namespace ez
+{
+// Layouts of one pipeline, owned by VulkanLayoutCache
+struct PipelineLayoutInfo final
+{
+    vk::PipelineLayout pipelineLayout;
+    // by set index
+    std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+    SpirVReflection::ShaderInterface shaderInterface;
+};
+
+// Descriptor set layouts and pipeline layouts built from reflected shader interfaces. Equal
+// layouts are created once, so pipelines with compatible interfaces get the same handles and
+// can share descriptor sets. Layouts stay alive until the cache is destroyed.
+// Thread safe, pipelines are created on worker threads.
+class VulkanLayoutCache
+{
+   public:
+    VulkanLayoutCache(vk::Device aLogicalDevice) : logicalDevice(aLogicalDevice) {}
+    VulkanLayoutCache(const VulkanLayoutCache&) = delete;
+    ~VulkanLayoutCache();
+
+    // Non-null explicitLayouts[set] is used instead of the reflected bindings of that set, for
+    // layouts with flags reflection can't know about, e.g. bindless arrays. Sets the shader
+    // doesn't use get empty layouts. Nothing if a set can't be derived.
+    std::optional<PipelineLayoutInfo> GetPipelineLayout(
+        const SpirVReflection::ShaderInterface& shaderInterface,
+        const std::vector<vk::DescriptorSetLayout>& explicitLayouts);
+
+    uint32_t GetDescriptorSetLayoutsCount() const;
+    uint32_t GetPipelineLayoutsCount() const;
+
+   private:
+    // both expect the mutex to be locked
+    vk::DescriptorSetLayout GetDescriptorSetLayout(
+        const std::vector<SpirVReflection::DescriptorBinding>& bindings);
+    vk::PipelineLayout GetPipelineLayout(
+        const std::vector<vk::DescriptorSetLayout>& setLayouts,
+        const std::vector<vk::PushConstantRange>& pushConstantRanges);
+
+    vk::Device logicalDevice;
+
+    mutable std::mutex mutex;
+    // keyed by the words of their create infos
+    std::map<std::vector<uint64_t>, vk::DescriptorSetLayout> descriptorSetLayouts;
+    std::map<std::vector<uint64_t>, vk::PipelineLayout> pipelineLayouts;
+};
+}  // namespace ez
@@ -1,35 +1,353 @@
 #include "vulkan_pipeline_manager.hpp"
 
+#include <chrono>
+#include <exception>
+#include <functional>
+#include <initializer_list>
+#include <unordered_set>
+
+#include "core/file_utils.hpp"
+#include "core/hash_combine.hpp"
 #include "core/log_assert.hpp"
+#include "render/config.hpp"
+#include "render/vulkan/spirv_reflection.hpp"
+#include "render/vulkan/vulkan_shader_compiler.hpp"
 
 namespace ez
 {
-VulkanPipelineManager::VulkanPipelineManager(vk::Device aLogicalDevice)
+namespace
+{
+using Clock = std::chrono::steady_clock;
+using SpirVReflection::ShaderInterface;
+
+uint64_t GetElapsedUs(Clock::time_point start)
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count());
+}
+
+// a failed pipeline is created again on the next request, e.g. after its shader is fixed
+template <typename Pipeline>
+bool IsFailed(const std::shared_future<std::shared_ptr<Pipeline>>& pipeline)
+{
+    return pipeline.wait_for(std::chrono::seconds(0)) == std::future_status::ready &&
+           pipeline.get() == nullptr;
+}
+
+template <typename Pipeline>
+bool IsPending(const std::shared_future<std::shared_ptr<Pipeline>>& pipeline)
+{
+    return pipeline.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+}
+
+// swaps the new state into the pipelines that were handed out, the reloads that are not done
+// yet stay pending; the rebuilt objects take the old state with them when erased
+template <typename PendingReloads>
+uint32_t ApplyPendingReloads(PendingReloads& reloads)
+{
+    uint32_t appliedCount = 0;
+    for (auto it = reloads.begin(); it != reloads.end();)
+    {
+        if (it->rebuilt.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            ++it;
+            continue;
+        }
+
+        // layouts are cached by their contents, a different handle means a different interface
+        const auto& rebuilt = it->rebuilt.get();
+        if (!rebuilt) { EZLOG("Failed to reload pipeline, the previous one is kept"); }
+        else if (rebuilt->GetPipelineLayout() != it->pipeline->GetPipelineLayout())
+        {
+            EZLOG("Shader interface changed, restart to reload the pipeline");
+        }
+        else
+        {
+            it->pipeline->Swap(*rebuilt);
+            ++appliedCount;
+        }
+        it = reloads.erase(it);
+    }
+    return appliedCount;
+}
+
+template <typename PendingReloads, typename Pipeline, typename Future>
+void AddPendingReload(PendingReloads& reloads,
+                      const std::shared_ptr<Pipeline>& pipeline,
+                      Future rebuilt)
+{
+    // a newer rebuild replaces one that is still running, so an older one never wins
+    for (auto& reload : reloads)
+    {
+        if (reload.pipeline == pipeline)
+        {
+            reload.rebuilt = std::move(rebuilt);
+            return;
+        }
+    }
+    reloads.push_back({ pipeline, std::move(rebuilt) });
+}
+
+std::optional<ShaderInterface> ReflectStages(
+    std::initializer_list<const std::vector<uint32_t>*> stagesCode)
+{
+    std::vector<ShaderInterface> stageInterfaces;
+    for (const std::vector<uint32_t>* code : stagesCode)
+    {
+        std::optional<ShaderInterface> stageInterface = SpirVReflection::Reflect(*code);
+        if (!stageInterface) { return {}; }
+        stageInterfaces.push_back(std::move(*stageInterface));
+    }
+    return SpirVReflection::Merge(stageInterfaces);
+}
+
+// the whole host struct is pushed, so the range covers it even if the block is smaller
+bool SetComputePushConstantsSize(ShaderInterface& shaderInterface, uint32_t pushConstantsSize)
+{
+    std::vector<vk::PushConstantRange>& ranges = shaderInterface.pushConstantRanges;
+    if (!ranges.empty() && ranges.front().offset + ranges.front().size > pushConstantsSize)
+    {
+        return false;
+    }
+
+    ranges.clear();
+    if (pushConstantsSize > 0)
+    {
+        ranges.emplace_back(vk::ShaderStageFlagBits::eCompute, 0, pushConstantsSize);
+    }
+    return true;
+}
+
+void HashLayouts(size_t& seed, const std::vector<vk::DescriptorSetLayout>& layouts)
+{
+    for (vk::DescriptorSetLayout layout : layouts)
+    {
+        HashCombine(seed, static_cast<VkDescriptorSetLayout>(layout));
+    }
+}
+}  // namespace
+
+bool VulkanPipelineManager::GraphicsPipelineKey::operator==(
+    const GraphicsPipelineKey& other) const
+{
+    return renderPass == other.renderPass && samples == other.samples &&
+           descriptorSetLayouts == other.descriptorSetLayouts &&
+           vertexLayout == other.vertexLayout && depthCompareOp == other.depthCompareOp &&
+           permutation == other.permutation && vertexShaderName == other.vertexShaderName &&
+           fragmentShaderName == other.fragmentShaderName;
+}
+
+bool VulkanPipelineManager::ComputePipelineKey::operator==(
+    const ComputePipelineKey& other) const
+{
+    return pushConstantsSize == other.pushConstantsSize &&
+           computeShaderName == other.computeShaderName;
+}
+
+size_t VulkanPipelineManager::PipelineKeyHash::operator()(const GraphicsPipelineKey& key) const
+{
+    size_t seed = 0;
+    HashCombine(seed, static_cast<VkRenderPass>(key.renderPass));
+    HashCombine(seed, static_cast<uint32_t>(key.samples));
+    HashLayouts(seed, key.descriptorSetLayouts);
+    HashCombine(seed, key.vertexLayout);
+    HashCombine(seed, static_cast<uint32_t>(key.depthCompareOp));
+    HashCombine(seed, key.permutation);
+    HashCombine(seed, key.vertexShaderName);
+    HashCombine(seed, key.fragmentShaderName);
+    return seed;
+}
+
+size_t VulkanPipelineManager::PipelineKeyHash::operator()(const ComputePipelineKey& key) const
+{
+    size_t seed = 0;
+    HashCombine(seed, key.pushConstantsSize);
+    HashCombine(seed, key.computeShaderName);
+    return seed;
+}
+
+VulkanPipelineManager::VulkanPipelineManager(vk::Device aLogicalDevice,
+                                             vk::PipelineCache aPipelineCache)
     : logicalDevice(aLogicalDevice)
+    , pipelineCache(aPipelineCache)
+    , layoutCache(aLogicalDevice)
 {
 }
 
 VulkanPipelineManager::~VulkanPipelineManager() {}
 
+// Shader tasks never wait on anything and are queued before the pipeline tasks that wait for
+// them. Workers take tasks in order, so a pipeline task only ever waits for shaders that are
+// already being compiled by other workers, which can't deadlock the pool.
+VulkanPipelineManager::ShaderFuture VulkanPipelineManager::CompileShaderAsync(
+    const std::string& shaderName)
+{
+    return workers
+        .Enqueue([this, shaderName]() {
+            const Clock::time_point compileStart = Clock::now();
+            std::vector<uint32_t> code;
+            try
+            {
+                code = SpirVShaderCompiler::CompileFromGLSL(shaderName);
+            }
+            catch (const std::exception& e)
+            {
+                EZLOG("Failed to compile shader", shaderName, e.what());
+            }
+            shadersCompilationUs += GetElapsedUs(compileStart);
+            shaderModulesBytes += code.size() * sizeof(uint32_t);
+            return code;
+        })
+        .share();
+}
+
+VulkanPipelineManager::GraphicsPipelineFuture VulkanPipelineManager::CreateGraphicsPipelineTask(
+    const GraphicsPipelineKey& key,
+    const ShaderFuture& vertexShader,
+    const ShaderFuture& fragmentShader)
+{
+    return workers
+        .Enqueue([this, key, vertexShader, fragmentShader]()
+                     -> std::shared_ptr<VulkanGraphicsPipeline> {
+            const std::vector<uint32_t>& vertexShaderCode = vertexShader.get();
+            const std::vector<uint32_t>& fragmentShaderCode = fragmentShader.get();
+            if (vertexShaderCode.empty() || fragmentShaderCode.empty()) { return {}; }
+
+            const std::optional<ShaderInterface> shaderInterface =
+                ReflectStages({ &vertexShaderCode, &fragmentShaderCode });
+            if (!shaderInterface)
+            {
+                EZLOG("Failed to reflect", key.vertexShaderName, key.fragmentShaderName);
+                return {};
+            }
+
+            const Clock::time_point creationStart = Clock::now();
+            const std::optional<PipelineLayoutInfo> layout =
+                layoutCache.GetPipelineLayout(*shaderInterface, key.descriptorSetLayouts);
+            if (!layout) { return {}; }
+            auto vulkanGraphicsPipeline =
+                VulkanGraphicsPipeline::CreateVulkanGraphicsPipeline(logicalDevice,
+                                                                     pipelineCache,
+                                                                     key.renderPass,
+                                                                     *layout,
+                                                                     key.vertexLayout,
+                                                                     key.depthCompareOp,
+                                                                     key.permutation,
+                                                                     vertexShaderCode,
+                                                                     fragmentShaderCode);
+            pipelinesCreationUs += GetElapsedUs(creationStart);
+            return vulkanGraphicsPipeline;
+        })
+        .share();
+}
+
+VulkanPipelineManager::ComputePipelineFuture VulkanPipelineManager::CreateComputePipelineTask(
+    const ComputePipelineKey& key,
+    const ShaderFuture& computeShader)
+{
+    return workers
+        .Enqueue([this, key, computeShader]() -> std::shared_ptr<VulkanComputePipeline> {
+            const std::vector<uint32_t>& computeShaderCode = computeShader.get();
+            if (computeShaderCode.empty()) { return {}; }
+
+            std::optional<ShaderInterface> shaderInterface =
+                ReflectStages({ &computeShaderCode });
+            if (!shaderInterface)
+            {
+                EZLOG("Failed to reflect", key.computeShaderName);
+                return {};
+            }
+            if (!SetComputePushConstantsSize(*shaderInterface, key.pushConstantsSize))
+            {
+                EZLOG("Push constants of", key.computeShaderName, "don't fit the host struct");
+                return {};
+            }
+
+            const Clock::time_point creationStart = Clock::now();
+            const std::optional<PipelineLayoutInfo> layout =
+                layoutCache.GetPipelineLayout(*shaderInterface, {});
+            if (!layout) { return {}; }
+            auto vulkanComputePipeline = VulkanComputePipeline::CreateVulkanComputePipeline(
+                logicalDevice, pipelineCache, *layout, computeShaderCode);
+            pipelinesCreationUs += GetElapsedUs(creationStart);
+            return vulkanComputePipeline;
+        })
+        .share();
+}
+
+VulkanPipelineManager::GraphicsPipelineFuture
+VulkanPipelineManager::CreateGraphicsPipelineAsync(
+    vk::RenderPass renderPass,
+    const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts,
+    VertexLayout vertexLayout,
+    vk::CompareOp depthCompareOp,
+    ShaderPermutation permutation,
+    const std::string& vertexShaderName,
+    const std::string& fragmentShaderName)
+{
+    // sample count is read from Config when the pipeline is created, so it is part of the state
+    GraphicsPipelineKey key{ renderPass,
+                             Config::msaa8xEnabled ? vk::SampleCountFlagBits::e8
+                                                   : vk::SampleCountFlagBits::e1,
+                             descriptorSetLayouts,
+                             vertexLayout,
+                             depthCompareOp,
+                             permutation,
+                             vertexShaderName,
+                             fragmentShaderName };
+    const auto it = graphicsPipelines.find(key);
+    if (it != graphicsPipelines.end() && !IsFailed(it->second))
+    {
+        ++reusedPipelinesCount;
+        return it->second;
+    }
+
+    const GraphicsPipelineFuture pipeline =
+        CreateGraphicsPipelineTask(key,
+                                   CompileShaderAsync(vertexShaderName),
+                                   CompileShaderAsync(fragmentShaderName));
+    graphicsPipelines.insert_or_assign(std::move(key), pipeline);
+    return pipeline;
+}
+
+VulkanPipelineManager::ComputePipelineFuture
+VulkanPipelineManager::CreateComputePipelineAsync(uint32_t pushConstantsSize,
+                                                  const std::string& computeShaderName)
+{
+    EZASSERT((pushConstantsSize <= 128), "Push constants are larger than Vulkan guarantees");
+    ComputePipelineKey key{ pushConstantsSize, computeShaderName };
+    const auto it = computePipelines.find(key);
+    if (it != computePipelines.end() && !IsFailed(it->second))
+    {
+        ++reusedPipelinesCount;
+        return it->second;
+    }
+
+    const ComputePipelineFuture pipeline =
+        CreateComputePipelineTask(key, CompileShaderAsync(computeShaderName));
+    computePipelines.insert_or_assign(std::move(key), pipeline);
+    return pipeline;
+}
+
 ResultValue<std::shared_ptr<VulkanGraphicsPipeline>>
 VulkanPipelineManager::CreateGraphicsPipeline(
-    vk::Extent2D swapchainExtent,
     vk::RenderPass renderPass,
     const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts,
     VertexLayout vertexLayout,
     vk::CompareOp depthCompareOp,
+    ShaderPermutation permutation,
     const std::string& vertexShaderName,
     const std::string& fragmentShaderName)
 {
-    auto vulkanGraphicsPipeline =
-        VulkanGraphicsPipeline::CreateVulkanGraphicsPipeline(logicalDevice,
-                                                             swapchainExtent,
-                                                             renderPass,
-                                                             descriptorSetLayouts,
-                                                             vertexLayout,
-                                                             depthCompareOp,
-                                                             vertexShaderName,
-                                                             fragmentShaderName);
+    std::shared_ptr<VulkanGraphicsPipeline> vulkanGraphicsPipeline =
+        CreateGraphicsPipelineAsync(renderPass,
+                                    descriptorSetLayouts,
+                                    vertexLayout,
+                                    depthCompareOp,
+                                    permutation,
+                                    vertexShaderName,
+                                    fragmentShaderName)
+            .get();
     if (vulkanGraphicsPipeline)
     {
         return { GraphicsResult::Ok, std::move(vulkanGraphicsPipeline) };
@@ -38,4 +356,129 @@ VulkanPipelineManager::CreateGraphicsPipeline(
     EZASSERT(false, "Failed to create VulkanGraphicsPipeline");
     return GraphicsResult::Error;
 }
+
+ResultValue<std::shared_ptr<VulkanComputePipeline>>
+VulkanPipelineManager::CreateComputePipeline(uint32_t pushConstantsSize,
+                                             const std::string& computeShaderName)
+{
+    std::shared_ptr<VulkanComputePipeline> vulkanComputePipeline =
+        CreateComputePipelineAsync(pushConstantsSize, computeShaderName).get();
+    if (vulkanComputePipeline)
+    {
+        return { GraphicsResult::Ok, std::move(vulkanComputePipeline) };
+    }
+
+    EZASSERT(false, "Failed to create VulkanComputePipeline");
+    return GraphicsResult::Error;
+}
+
+std::vector<std::string> VulkanPipelineManager::GetShaderSourceFiles() const
+{
+    std::unordered_set<std::string> shaderNames;
+    for (const auto& [key, pipeline] : graphicsPipelines)
+    {
+        shaderNames.insert(key.vertexShaderName);
+        shaderNames.insert(key.fragmentShaderName);
+    }
+    for (const auto& [key, pipeline] : computePipelines)
+    {
+        shaderNames.insert(key.computeShaderName);
+    }
+
+    std::vector<std::string> sourceFiles;
+    for (const std::string& shaderName : shaderNames)
+    {
+        const std::vector<std::string> files = SpirVShaderCompiler::GetSourceFiles(shaderName);
+        sourceFiles.insert(sourceFiles.end(), files.begin(), files.end());
+    }
+    return sourceFiles;
+}
+
+uint32_t VulkanPipelineManager::ReloadPipelines(const std::vector<std::string>& changedFiles)
+{
+    std::unordered_set<std::string> changed;
+    for (const std::string& file : changedFiles)
+    {
+        changed.insert(FileUtils::GetCanonicalPath(file));
+    }
+
+    // every shader is compiled once even if several pipelines use it
+    std::unordered_map<std::string, bool> shadersAffected;
+    std::unordered_map<std::string, ShaderFuture> shaders;
+    const auto isAffected = [&changed, &shadersAffected](const std::string& shaderName) {
+        const auto it = shadersAffected.find(shaderName);
+        if (it != shadersAffected.end()) { return it->second; }
+
+        bool affected = false;
+        for (const std::string& file : SpirVShaderCompiler::GetSourceFiles(shaderName))
+        {
+            affected |= changed.count(FileUtils::GetCanonicalPath(file)) != 0;
+        }
+        shadersAffected.emplace(shaderName, affected);
+        return affected;
+    };
+    // unchanged stages of an affected pipeline are found in SpirVCache without glslang
+    const auto compileShader = [this, &shaders](const std::string& shaderName) {
+        const auto it = shaders.find(shaderName);
+        if (it != shaders.end()) { return it->second; }
+        return shaders.emplace(shaderName, CompileShaderAsync(shaderName)).first->second;
+    };
+
+    // pipelines still being created or failed have nobody to swap into, a failed one is
+    // created again on the next request anyway
+    uint32_t reloadsCount = 0;
+    for (const auto& [key, pipeline] : graphicsPipelines)
+    {
+        if (IsPending(pipeline) || IsFailed(pipeline) ||
+            !(isAffected(key.vertexShaderName) || isAffected(key.fragmentShaderName)))
+        {
+            continue;
+        }
+        AddPendingReload(graphicsReloads,
+                         pipeline.get(),
+                         CreateGraphicsPipelineTask(key,
+                                                    compileShader(key.vertexShaderName),
+                                                    compileShader(key.fragmentShaderName)));
+        ++reloadsCount;
+    }
+    for (const auto& [key, pipeline] : computePipelines)
+    {
+        if (IsPending(pipeline) || IsFailed(pipeline) || !isAffected(key.computeShaderName))
+        {
+            continue;
+        }
+        AddPendingReload(computeReloads,
+                         pipeline.get(),
+                         CreateComputePipelineTask(key, compileShader(key.computeShaderName)));
+        ++reloadsCount;
+    }
+    return reloadsCount;
+}
+
+void VulkanPipelineManager::ReleaseGraphicsPipelines(vk::RenderPass renderPass)
+{
+    // rebuilds don't tell their render pass, they are rare enough to wait for all of them
+    for (const PendingReload<VulkanGraphicsPipeline>& reload : graphicsReloads)
+    {
+        reload.rebuilt.wait();
+    }
+    for (auto it = graphicsPipelines.begin(); it != graphicsPipelines.end();)
+    {
+        if (it->first.renderPass != renderPass)
+        {
+            ++it;
+            continue;
+        }
+        it->second.wait();
+        it = graphicsPipelines.erase(it);
+    }
+}
+
+uint32_t VulkanPipelineManager::ApplyReloadedPipelines()
+{
+    const uint32_t appliedCount =
+        ApplyPendingReloads(graphicsReloads) + ApplyPendingReloads(computeReloads);
+    reloadedPipelinesCount += appliedCount;
+    return appliedCount;
+}
 }  // namespace ez
@@ -1,31 +1,176 @@
 #pragma once
 
+#include <atomic>
+#include <future>
 #include <memory>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
+#include "core/thread_pool.hpp"
 #include "render/graphics_result.hpp"
 #include "render/highlevel/primitive.hpp"
+#include "render/vulkan/vulkan_compute_pipeline.hpp"
 #include "render/vulkan/vulkan_graphics_pipeline.hpp"
+#include "render/vulkan/vulkan_layout_cache.hpp"
 
 namespace ez
 {
+// Creates pipelines and keeps them by their full creation state, requests with the same state
+// get the same shared pipeline. Pipelines live at least as long as the manager.
+// Descriptor set and pipeline layouts are reflected from the SPIR-V of the stages and shared
+// between pipelines with the same interface, see VulkanLayoutCache.
+// Shader stages are compiled and pipelines are created on worker threads, the Async methods
+// return right away. The manager itself must be used from one thread.
 class VulkanPipelineManager
 {
    public:
-    VulkanPipelineManager(vk::Device aLogicalDevice);
+    // resolves to null if the pipeline could not be created
+    using GraphicsPipelineFuture = std::shared_future<std::shared_ptr<VulkanGraphicsPipeline>>;
+    using ComputePipelineFuture = std::shared_future<std::shared_ptr<VulkanComputePipeline>>;
+
+    VulkanPipelineManager(vk::Device aLogicalDevice, vk::PipelineCache aPipelineCache);
     ~VulkanPipelineManager();
 
+    // a non-null descriptorSetLayouts[set] is used instead of the reflected layout of that set
+    GraphicsPipelineFuture CreateGraphicsPipelineAsync(
+        vk::RenderPass renderPass,
+        const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts,
+        VertexLayout vertexLayout,
+        vk::CompareOp depthCompareOp,
+        ShaderPermutation permutation,
+        const std::string& vertexShaderName,
+        const std::string& fragmentShaderName);
+
+    // pushConstantsSize is the size of the pushed host struct, the push constant block of the
+    // shader must fit into it
+    ComputePipelineFuture CreateComputePipelineAsync(uint32_t pushConstantsSize,
+                                                     const std::string& computeShaderName);
+
+    // same as the Async methods, but wait for the pipeline
     ResultValue<std::shared_ptr<VulkanGraphicsPipeline>> CreateGraphicsPipeline(
-        vk::Extent2D swapchainExtent,
         vk::RenderPass renderPass,
         const std::vector<vk::DescriptorSetLayout>& descriptorSetLayouts,
         VertexLayout vertexLayout,
         vk::CompareOp depthCompareOp,
+        ShaderPermutation permutation,
         const std::string& vertexShaderName,
         const std::string& fragmentShaderName);
 
+    ResultValue<std::shared_ptr<VulkanComputePipeline>> CreateComputePipeline(
+        uint32_t pushConstantsSize, const std::string& computeShaderName);
+
+    uint32_t GetGraphicsPipelinesCount() const
+    {
+        return static_cast<uint32_t>(graphicsPipelines.size());
+    }
+    uint32_t GetComputePipelinesCount() const
+    {
+        return static_cast<uint32_t>(computePipelines.size());
+    }
+    // requests served by an already created pipeline
+    uint32_t GetReusedPipelinesCount() const { return reusedPipelinesCount; }
+    // time spent in glslang or the shader cache, summed over worker threads
+    double GetShadersCompilationMs() const { return shadersCompilationUs / 1000.0; }
+    // SPIR-V size of all compiled shader stages, shared ones are counted once per compilation
+    uint64_t GetShaderModulesBytes() const { return shaderModulesBytes; }
+    // time the driver spent creating pipelines that were not reused, summed over worker threads
+    double GetPipelinesCreationMs() const { return pipelinesCreationUs / 1000.0; }
+    uint32_t GetDescriptorSetLayoutsCount() const
+    {
+        return layoutCache.GetDescriptorSetLayoutsCount();
+    }
+    uint32_t GetPipelineLayoutsCount() const { return layoutCache.GetPipelineLayoutsCount(); }
+
+    // shader files of all pipelines with their includes, as read by the last compilation
+    std::vector<std::string> GetShaderSourceFiles() const;
+
+    // Rebuilds the pipelines whose shaders read any of changedFiles on workers, returns how
+    // many. The pipelines handed out before keep working until ApplyReloadedPipelines.
+    uint32_t ReloadPipelines(const std::vector<std::string>& changedFiles);
+    // Swaps the rebuilt pipelines that are ready into the ones handed out before, so their
+    // holders draw with the new shaders without asking again. A pipeline that failed to rebuild
+    // or got a different layout is kept, descriptor sets of its holders would not fit the new
+    // one. Old pipelines are destroyed here, they must not be in use by the GPU.
+    uint32_t ApplyReloadedPipelines();
+
+    // Forgets the graphics pipelines created for renderPass, waits for the ones still being
+    // created or rebuilt first. Call it before destroying renderPass, a later one may get the
+    // same handle. Holders keep using their pipelines until they drop them.
+    void ReleaseGraphicsPipelines(vk::RenderPass renderPass);
+
+    uint32_t GetPendingReloadsCount() const
+    {
+        return static_cast<uint32_t>(graphicsReloads.size() + computeReloads.size());
+    }
+    uint32_t GetReloadedPipelinesCount() const { return reloadedPipelinesCount; }
+
    private:
+    struct GraphicsPipelineKey final
+    {
+        vk::RenderPass renderPass;
+        vk::SampleCountFlagBits samples = vk::SampleCountFlagBits::e1;
+        // explicit ones only, null for the reflected sets
+        std::vector<vk::DescriptorSetLayout> descriptorSetLayouts;
+        VertexLayout vertexLayout = 0;
+        vk::CompareOp depthCompareOp = vk::CompareOp::eLess;
+        // specialization of the same shader modules, see eShaderFeature
+        ShaderPermutation permutation = sfNone;
+        std::string vertexShaderName;
+        std::string fragmentShaderName;
+
+        bool operator==(const GraphicsPipelineKey& other) const;
+    };
+
+    struct ComputePipelineKey final
+    {
+        uint32_t pushConstantsSize = 0;
+        std::string computeShaderName;
+
+        bool operator==(const ComputePipelineKey& other) const;
+    };
+
+    struct PipelineKeyHash final
+    {
+        size_t operator()(const GraphicsPipelineKey& key) const;
+        size_t operator()(const ComputePipelineKey& key) const;
+    };
+
+    template <typename Pipeline>
+    struct PendingReload final
+    {
+        // handed out before, gets the state of rebuilt
+        std::shared_ptr<Pipeline> pipeline;
+        std::shared_future<std::shared_ptr<Pipeline>> rebuilt;
+    };
+
+    using ShaderFuture = std::shared_future<std::vector<uint32_t>>;
+    ShaderFuture CompileShaderAsync(const std::string& shaderName);
+    GraphicsPipelineFuture CreateGraphicsPipelineTask(const GraphicsPipelineKey& key,
+                                                      const ShaderFuture& vertexShader,
+                                                      const ShaderFuture& fragmentShader);
+    ComputePipelineFuture CreateComputePipelineTask(const ComputePipelineKey& key,
+                                                    const ShaderFuture& computeShader);
+
     vk::Device logicalDevice;
+    // owned by VulkanDevice
+    vk::PipelineCache pipelineCache;
+    VulkanLayoutCache layoutCache;
+
+    std::unordered_map<GraphicsPipelineKey, GraphicsPipelineFuture, PipelineKeyHash>
+        graphicsPipelines;
+    std::unordered_map<ComputePipelineKey, ComputePipelineFuture, PipelineKeyHash>
+        computePipelines;
+    uint32_t reusedPipelinesCount = 0;
+
+    std::vector<PendingReload<VulkanGraphicsPipeline>> graphicsReloads;
+    std::vector<PendingReload<VulkanComputePipeline>> computeReloads;
+    uint32_t reloadedPipelinesCount = 0;
+    std::atomic<uint64_t> shadersCompilationUs = 0;
+    std::atomic<uint64_t> shaderModulesBytes = 0;
+    std::atomic<uint64_t> pipelinesCreationUs = 0;
+
+    // last member, so that it finishes queued tasks before anything they use is destroyed
+    ThreadPool workers{ ThreadPool::GetDefaultThreadsCount() };
 };
 }  // namespace ez
@@ -0,0 +1,60 @@
+#include "vulkan_sampler_cache.hpp"
+
+#include "core/hash_combine.hpp"
+#include "core/log_assert.hpp"
+#include "render/graphics_result.hpp"
+
+namespace ez
+{
+size_t VulkanSamplerCache::TextureSamplerHash::operator()(
+    const TextureSampler& textureSampler) const
+{
+    size_t seed = 0;
+    HashCombine(seed, static_cast<uint32_t>(textureSampler.magFilter));
+    HashCombine(seed, static_cast<uint32_t>(textureSampler.minFilter));
+    HashCombine(seed, static_cast<uint32_t>(textureSampler.addressModeU));
+    HashCombine(seed, static_cast<uint32_t>(textureSampler.addressModeV));
+    HashCombine(seed, static_cast<uint32_t>(textureSampler.addressModeW));
+    HashCombine(seed, static_cast<uint32_t>(textureSampler.mipmapMode));
+    HashCombine(seed, textureSampler.maxAnisotropy);
+    HashCombine(seed, textureSampler.minLod);
+    HashCombine(seed, textureSampler.maxLod);
+    return seed;
+}
+
+VulkanSamplerCache::~VulkanSamplerCache()
+{
+    for (const auto& [textureSampler, sampler] : samplers)
+    {
+        logicalDevice.destroySampler(sampler);
+    }
+}
+
+vk::Sampler VulkanSamplerCache::GetSampler(const TextureSampler& textureSampler)
+{
+    const auto it = samplers.find(textureSampler);
+    if (it != samplers.end()) { return it->second; }
+
+    vk::SamplerCreateInfo samplerInfo{};
+    samplerInfo.setMagFilter(textureSampler.magFilter);
+    samplerInfo.setMinFilter(textureSampler.minFilter);
+    samplerInfo.setMipmapMode(textureSampler.mipmapMode);
+    samplerInfo.setAddressModeU(textureSampler.addressModeU);
+    samplerInfo.setAddressModeV(textureSampler.addressModeV);
+    samplerInfo.setAddressModeW(textureSampler.addressModeW);
+    samplerInfo.setCompareOp(vk::CompareOp::eNever);
+    samplerInfo.setBorderColor(vk::BorderColor::eFloatOpaqueWhite);
+    samplerInfo.setMinLod(textureSampler.minLod);
+    samplerInfo.setMaxLod(textureSampler.maxLod);
+    samplerInfo.setMaxAnisotropy(textureSampler.maxAnisotropy);
+    samplerInfo.setAnisotropyEnable(textureSampler.maxAnisotropy > 1.0f ? VK_TRUE : VK_FALSE);
+
+    vk::Sampler sampler;
+    const vk::Result result = logicalDevice.createSampler(&samplerInfo, nullptr, &sampler);
+    CheckVkResult(result);
+    if (result != vk::Result::eSuccess) { return {}; }
+
+    samplers.emplace(textureSampler, sampler);
+    return sampler;
+}
+}  // namespace ez
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <unordered_map>
+
+#include "render/highlevel/texture_sampler.hpp"
+#include "render/vulkan_include.hpp"
+
+namespace ez
+{
+// One vk::Sampler per distinct TextureSampler state, shared by all textures that use it.
+// Samplers stay alive until the cache is destroyed.
+class VulkanSamplerCache
+{
+   public:
+    VulkanSamplerCache(vk::Device aLogicalDevice) : logicalDevice(aLogicalDevice) {}
+    VulkanSamplerCache(const VulkanSamplerCache&) = delete;
+    ~VulkanSamplerCache();
+
+    vk::Sampler GetSampler(const TextureSampler& textureSampler);
+
+    uint32_t GetSamplersCount() const { return static_cast<uint32_t>(samplers.size()); }
+
+   private:
+    struct TextureSamplerHash final
+    {
+        size_t operator()(const TextureSampler& textureSampler) const;
+    };
+
+    vk::Device logicalDevice;
+    std::unordered_map<TextureSampler, vk::Sampler, TextureSamplerHash> samplers;
+};
+}  // namespace ez
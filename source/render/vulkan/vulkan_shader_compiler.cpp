@@ -3,18 +3,46 @@
 #include <SPIRV/GlslangToSpv.h>
 #include <StandAlone/DirStackFileIncluder.h>
 #include <glslang/Public/ShaderLang.h>
+#ifdef EZ_SPIRV_OPT
+#include <spirv-tools/optimizer.hpp>
+#endif
 
 #include <fstream>
+#include <mutex>
+#include <optional>
+#include <sstream>
+#include <unordered_map>
 
 #include "core/file_utils.hpp"
 #include "core/log_assert.hpp"
 #include "render/config.hpp"
+#include "render/vulkan/spirv_cache.hpp"
+
+#ifdef EZ_EMBED_SHADERS
+#include "embedded_shaders.hpp"
+#endif
 
 namespace ez::SpirVShaderCompiler
 {
 namespace SDetails
 {
-static bool glslangInitialized = false;
+static std::once_flag glslangInitialized;
+
+static std::mutex sourceFilesMutex;
+static std::unordered_map<std::string, std::vector<std::string>> sourceFiles;
+
+static void RecordSourceFiles(const std::string& filename,
+                              const std::vector<SpirVCache::SourceFile>& sources)
+{
+    std::vector<std::string> paths;
+    for (const SpirVCache::SourceFile& source : sources)
+    {
+        paths.push_back(source.path);
+    }
+
+    std::lock_guard<std::mutex> lock(sourceFilesMutex);
+    sourceFiles[filename] = std::move(paths);
+}
 
 static std::string GetFilePath(const std::string& str)
 {
@@ -23,6 +51,22 @@ static std::string GetFilePath(const std::string& str)
     // size_t FileName = str.substr(found+1);
 }
 
+#ifdef EZ_EMBED_SHADERS
+// shaders are embedded by file name, the directory they are loaded from doesn't matter
+static std::optional<std::vector<uint32_t>> FindEmbeddedShader(const std::string& filename)
+{
+    const std::string name = filename.substr(filename.find_last_of("/\\") + 1);
+    for (const EmbeddedShaders::Shader& shader : EmbeddedShaders::Shaders)
+    {
+        if (name == shader.name)
+        {
+            return std::vector<uint32_t>(shader.code, shader.code + shader.size);
+        }
+    }
+    return {};
+}
+#endif
+
 static std::string GetSuffix(const std::string& name)
 {
     const size_t pos = name.rfind('.');
@@ -62,6 +106,94 @@ static EShLanguage GetShaderStage(const std::string& stage)
 constexpr int ClientInputSemanticsVersion = 100;
 constexpr glslang::EShTargetClientVersion VulkanClientVersion = glslang::EShTargetVulkan_1_1;
 constexpr glslang::EShTargetLanguageVersion TargetVersion = glslang::EShTargetSpv_1_3;
+constexpr int DefaultVersion = 100;
+constexpr EShMessages Messages = static_cast<EShMessages>(EShMsgSpvRules | EShMsgVulkanRules);
+
+#ifdef EZ_SPIRV_OPT
+constexpr bool SpirVOptimizerEnabled = true;
+#else
+constexpr bool SpirVOptimizerEnabled = false;
+#endif
+
+// everything besides the preprocessed source that affects the compiled SPIR-V
+static uint64_t GetOptionsHash()
+{
+    std::ostringstream options;
+    options << SpirVCache::Version << " " << ClientInputSemanticsVersion << " "
+            << VulkanClientVersion << " " << TargetVersion << " " << DefaultVersion << " "
+            << Messages << " " << static_cast<int>(Config::ShaderOptimizationLevel) << " "
+            << Config::ShaderStripDebugInfo << " " << SpirVOptimizerEnabled;
+    return FileUtils::Hash(options.str());
+}
+
+#ifdef EZ_SPIRV_OPT
+// glslang runs SPIRV-Tools on GLSL only for optimizeSize, so the passes are registered here
+static void OptimizeSpirV(const std::string& filename, std::vector<uint32_t>& spirV)
+{
+    using Config::ShaderOptimization;
+    spvtools::Optimizer optimizer(SPV_ENV_VULKAN_1_1);
+    optimizer.SetMessageConsumer(
+        [&filename](spv_message_level_t level, const char*, const spv_position_t&,
+                    const char* message)
+        {
+            if (level <= SPV_MSG_WARNING) { EZLOG("SPIR-V optimizer:", filename, message); }
+        });
+    if (Config::ShaderStripDebugInfo)
+    {
+        optimizer.RegisterPass(spvtools::CreateStripDebugInfoPass());
+    }
+    if (Config::ShaderOptimizationLevel == ShaderOptimization::ePerformance)
+    {
+        optimizer.RegisterPerformancePasses();
+    }
+    else if (Config::ShaderOptimizationLevel == ShaderOptimization::eSize)
+    {
+        optimizer.RegisterSizePasses();
+    }
+
+    std::vector<uint32_t> optimized;
+    if (!optimizer.Run(spirV.data(), spirV.size(), &optimized))
+    {
+        EZLOG("SPIR-V optimization failed, using the unoptimized shader:", filename);
+        return;
+    }
+    spirV = std::move(optimized);
+}
+#endif
+
+// remembers the files glslang included, with the hash of what was read
+class RecordingIncluder final : public DirStackFileIncluder
+{
+   public:
+    IncludeResult* includeLocal(const char* headerName,
+                                const char* includerName,
+                                size_t inclusionDepth) override
+    {
+        return Record(
+            DirStackFileIncluder::includeLocal(headerName, includerName, inclusionDepth));
+    }
+
+    IncludeResult* includeSystem(const char* headerName,
+                                 const char* includerName,
+                                 size_t inclusionDepth) override
+    {
+        return Record(
+            DirStackFileIncluder::includeSystem(headerName, includerName, inclusionDepth));
+    }
+
+    std::vector<SpirVCache::SourceFile> includedFiles;
+
+   private:
+    IncludeResult* Record(IncludeResult* result)
+    {
+        if (result != nullptr)
+        {
+            const uint64_t hash = FileUtils::Hash(result->headerData, result->headerLength);
+            includedFiles.push_back({ result->headerName, hash });
+        }
+        return result;
+    }
+};
 
 const TBuiltInResource DefaultTBuiltInResource = { .maxLights = 32,
                                                    .maxClipPlanes = 6,
@@ -171,27 +303,38 @@ const TBuiltInResource DefaultTBuiltInResource = { .maxLights = 32,
                                                    } };
 }  // namespace SDetails
 
-// todo: file loading codes. std::vector<char> InputGLSL = FileUtils::ReadFile(filename);
-
-// todo: Save compiled .spv to FS and load if shader hash didn't
-// change) glslang::OutputSpvBin(SpirV, (GetSuffix(filename) +
-// std::string(".spv")).c_str());
-
 const std::vector<uint32_t> CompileFromGLSL(const std::string& filename)
 {
     using namespace SDetails;
 
-    if (!glslangInitialized)
+#ifdef EZ_EMBED_SHADERS
+    if (UsesEmbeddedShaders())
+    {
+        if (auto embeddedSpirV = FindEmbeddedShader(filename))
+        {
+            return std::move(*embeddedSpirV);
+        }
+        EZLOG("Shader is not embedded, compiling it:", filename);
+    }
+#endif
+
+    static const uint64_t OptionsHash = GetOptionsHash();
+    std::vector<SpirVCache::SourceFile> CachedSources;
+    if (auto cachedSpirV = SpirVCache::FindBySources(filename, OptionsHash, &CachedSources))
     {
-        glslang::InitializeProcess();
-        glslangInitialized = true;
+        RecordSourceFiles(filename, CachedSources);
+        return std::move(*cachedSpirV);
     }
 
-    std::ifstream file(filename);
+    // the rest of glslang is safe to use from several threads once the process is initialized
+    std::call_once(glslangInitialized, []() { glslang::InitializeProcess(); });
+
+    std::ifstream file(filename, std::ios::binary);
 
     if (!file.is_open())
     {
         std::cout << "Failed to load shader: " << filename << std::endl;
+        RecordSourceFiles(filename, { { filename, 0 } });
         throw std::runtime_error("failed to open file: " + filename);
     }
 
@@ -213,60 +356,100 @@ const std::vector<uint32_t> CompileFromGLSL(const std::string& filename)
 
     TBuiltInResource Resources;
     Resources = DefaultTBuiltInResource;
-    EShMessages messages = (EShMessages)(EShMsgSpvRules | EShMsgVulkanRules);
-
-    const int DefaultVersion = 100;
 
-    DirStackFileIncluder Includer;
+    RecordingIncluder Includer;
 
     std::string Path = GetFilePath(filename);
     Includer.pushExternalLocalDirectory(Path);
 
     std::string PreprocessedGLSL;
 
+    bool compiled = true;
     if (!Shader.preprocess(&Resources,
                            DefaultVersion,
                            ENoProfile,
                            false,
                            false,
-                           messages,
+                           Messages,
                            &PreprocessedGLSL,
                            Includer))
     {
         EZLOG("GLSL Preprocessing Failed for: ", filename);
         EZLOG(Shader.getInfoLog());
         EZLOG(Shader.getInfoDebugLog());
+        compiled = false;
     }
 
     if (Config::dumpGlslSources) { EZLOG(PreprocessedGLSL); }
 
+    // the same source may be reached from another file or after an edit that changed nothing
+    const uint64_t PreprocessedHash = FileUtils::Hash(PreprocessedGLSL, OptionsHash);
+    std::vector<SpirVCache::SourceFile> Sources = { { filename, FileUtils::Hash(InputGLSL) } };
+    Sources.insert(Sources.end(), Includer.includedFiles.begin(), Includer.includedFiles.end());
+    RecordSourceFiles(filename, Sources);
+    if (compiled)
+    {
+        if (auto cachedSpirV = SpirVCache::FindByPreprocessed(PreprocessedHash))
+        {
+            SpirVCache::Store(filename, OptionsHash, Sources, PreprocessedHash, *cachedSpirV);
+            return std::move(*cachedSpirV);
+        }
+    }
+
     const char* PreprocessedCStr = PreprocessedGLSL.c_str();
     Shader.setStrings(&PreprocessedCStr, 1);
 
-    if (!Shader.parse(&Resources, 100, false, messages))
+    if (!Shader.parse(&Resources, DefaultVersion, false, Messages))
     {
         EZLOG("GLSL Parsing Failed for: ", filename);
         EZLOG(Shader.getInfoLog());
         EZLOG(Shader.getInfoDebugLog());
+        compiled = false;
     }
 
     glslang::TProgram Program;
     Program.addShader(&Shader);
 
-    if (!Program.link(messages))
+    if (!Program.link(Messages))
     {
         EZLOG("GLSL Linking Failed for:", filename);
         EZLOG(Shader.getInfoLog());
         EZLOG(Shader.getInfoDebugLog());
+        compiled = false;
     }
 
     std::vector<uint32_t> SpirV;
     spv::SpvBuildLogger logger;
     glslang::SpvOptions spvOptions;
+    spvOptions.disableOptimizer = true;
     glslang::GlslangToSpv(*Program.getIntermediate(ShaderType), SpirV, &logger, &spvOptions);
 
     if (logger.getAllMessages().length() > 0) { EZLOG(logger.getAllMessages()); }
 
+#ifdef EZ_SPIRV_OPT
+    if (compiled && !SpirV.empty()) { OptimizeSpirV(filename, SpirV); }
+#endif
+
+    if (compiled && !SpirV.empty())
+    {
+        SpirVCache::Store(filename, OptionsHash, Sources, PreprocessedHash, SpirV);
+    }
     return SpirV;
 }
+
+bool UsesEmbeddedShaders()
+{
+#ifdef EZ_EMBED_SHADERS
+    return !Config::ForceRuntimeShaderCompilation;
+#else
+    return false;
+#endif
+}
+
+std::vector<std::string> GetSourceFiles(const std::string& filename)
+{
+    std::lock_guard<std::mutex> lock(SDetails::sourceFilesMutex);
+    const auto it = SDetails::sourceFiles.find(filename);
+    return it != SDetails::sourceFiles.end() ? it->second : std::vector<std::string>{};
+}
 }  // namespace ez::SpirVShaderCompiler
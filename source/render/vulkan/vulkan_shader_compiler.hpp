@@ -8,6 +8,15 @@ namespace ez::SpirVShaderCompiler
 // https://forestsharp.com/glslang-cpp/
 // https://github.com/ForestCSharp/VkCppRenderer/blob/master/Src/Renderer/GLSL/ShaderCompiler.hpp
 
+// may be called from several threads at once; returns the SPIR-V embedded at build time
+// without compiling anything if there is one, see UsesEmbeddedShaders
 const std::vector<uint32_t> CompileFromGLSL(const std::string& filename);
 
+// true if the binary has shaders compiled at build time and runtime compilation isn't forced
+bool UsesEmbeddedShaders();
+
+// files the last compilation of filename read, filename first and then its includes;
+// recorded for failed compilations too, empty if filename was never compiled
+std::vector<std::string> GetSourceFiles(const std::string& filename);
+
 }  // namespace ez::SpirVShaderCompiler
@@ -0,0 +1,21 @@
+#ifndef CUBEMAP_COMMON_GLSL
+#define CUBEMAP_COMMON_GLSL
+
+const float PI = 3.14159265359;
+
+// face orientation as in the Vulkan spec cube map face selection table
+vec3 GetCubemapDirection(uint face, vec2 uv)
+{
+    const vec2 p = uv * 2.0 - 1.0;
+    switch (face)
+    {
+        case 0: return vec3(1.0, -p.y, -p.x);
+        case 1: return vec3(-1.0, -p.y, p.x);
+        case 2: return vec3(p.x, 1.0, p.y);
+        case 3: return vec3(p.x, -1.0, -p.y);
+        case 4: return vec3(p.x, -p.y, 1.0);
+        default: return vec3(-p.x, -p.y, -1.0);
+    }
+}
+
+#endif
@@ -0,0 +1,14 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+layout(location = 0) in vec3 worldPosition;
+
+layout(location = 0) out vec4 outColor;
+
+void main() {
+    // faceted gray, shape is readable without normals in the vertex layout
+    const vec3 normal = normalize(cross(dFdx(worldPosition), dFdy(worldPosition)));
+    const vec3 lightDirection = normalize(vec3(0.3, 1.0, 0.5));
+    const float lighting = 0.35 + 0.45 * abs(dot(normal, lightDirection));
+    outColor = vec4(vec3(lighting), 1.0);
+}
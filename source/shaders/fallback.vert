@@ -0,0 +1,29 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+
+// drawn instead of material pipelines that are still being created, reads positions only so it
+// fits every vertex layout
+
+layout(location = 0) in vec3 inPosition;
+
+layout(location = 0) out vec3 worldPosition;
+
+layout(set = 0, binding = 0) uniform GlobalUniformBufferObject {
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    mat4 viewProjectionMatrix;
+} globalUniforms;
+
+layout(push_constant) uniform PushConstantsObject {
+  mat4 modelMatrix;
+} pushConstants;
+
+out gl_PerVertex {
+    vec4 gl_Position;
+};
+
+void main() {
+    const vec4 position = pushConstants.modelMatrix * vec4(inPosition, 1.0);
+    gl_Position = globalUniforms.viewProjectionMatrix * position;
+    worldPosition = position.xyz;
+}
@@ -0,0 +1,38 @@
+#ifndef IBL_COMMON_GLSL
+#define IBL_COMMON_GLSL
+
+#include "cubemap_common.glsl"
+
+vec2 Hammersley(uint i, uint count)
+{
+    uint bits = i;
+    bits = (bits << 16u) | (bits >> 16u);
+    bits = ((bits & 0x55555555u) << 1u) | ((bits & 0xAAAAAAAAu) >> 1u);
+    bits = ((bits & 0x33333333u) << 2u) | ((bits & 0xCCCCCCCCu) >> 2u);
+    bits = ((bits & 0x0F0F0F0Fu) << 4u) | ((bits & 0xF0F0F0F0u) >> 4u);
+    bits = ((bits & 0x00FF00FFu) << 8u) | ((bits & 0xFF00FF00u) >> 8u);
+    return vec2(float(i) / float(count), float(bits) * 2.3283064365386963e-10);
+}
+
+// GGX half vector around n, alpha = roughness^2
+vec3 ImportanceSampleGGX(vec2 xi, vec3 n, float alpha)
+{
+    const float phi = 2.0 * PI * xi.x;
+    const float cosTheta = sqrt((1.0 - xi.y) / (1.0 + (alpha * alpha - 1.0) * xi.y));
+    const float sinTheta = sqrt(1.0 - cosTheta * cosTheta);
+    const vec3 h = vec3(sinTheta * cos(phi), sinTheta * sin(phi), cosTheta);
+
+    const vec3 up = abs(n.z) < 0.999 ? vec3(0.0, 0.0, 1.0) : vec3(1.0, 0.0, 0.0);
+    const vec3 tangentX = normalize(cross(up, n));
+    const vec3 tangentY = cross(n, tangentX);
+    return tangentX * h.x + tangentY * h.y + n * h.z;
+}
+
+float DistributionGGX(float nDotH, float alpha)
+{
+    const float alpha2 = alpha * alpha;
+    const float denom = nDotH * nDotH * (alpha2 - 1.0) + 1.0;
+    return alpha2 / (PI * denom * denom);
+}
+
+#endif
@@ -0,0 +1,10 @@
+#ifndef MATERIAL_FEATURES_GLSL
+#define MATERIAL_FEATURES_GLSL
+
+// eShaderFeature, constant_id is the bit index of the feature in the pipeline permutation
+layout(constant_id = 0) const bool AlphaMaskEnabled = false;
+layout(constant_id = 1) const bool EmissiveMapEnabled = false;
+layout(constant_id = 2) const bool BaseColorUv1 = false;
+layout(constant_id = 3) const bool EmissiveUv1 = false;
+
+#endif
@@ -1,7 +1,11 @@
 #version 450
 #extension GL_ARB_separate_shader_objects : enable
+#extension GL_GOOGLE_include_directive : require
+
+#include "material_features.glsl"
 
 layout(location = 0) in vec2 uv;
+layout(location = 1) in vec2 uv1;
 
 layout(location = 0) out vec4 outColor;
 
@@ -12,5 +16,5 @@ layout(set = 1, binding = 3) uniform sampler2D occlusionSampler;
 layout(set = 1, binding = 4) uniform sampler2D emissionSampler;
 
 void main() {
-    outColor = texture(baseColorSampler, uv);
+    outColor = texture(baseColorSampler, BaseColorUv1 ? uv1 : uv);
 }
@@ -0,0 +1,56 @@
+#version 450
+#extension GL_ARB_separate_shader_objects : enable
+#extension GL_EXT_nonuniform_qualifier : require
+#extension GL_GOOGLE_include_directive : require
+
+#include "material_features.glsl"
+
+layout(location = 0) in vec2 uv;
+layout(location = 1) in vec2 uv1;
+
+layout(location = 0) out vec4 outColor;
+
+// BindlessMaterials::MaterialEntry
+struct Material {
+    vec4 baseColorFactor;
+    vec3 emissiveFactor;
+    float alphaCutoff;
+    float metallicFactor;
+    float roughnessFactor;
+    uint blendMode;
+    uint texCoordSets;
+
+    uint baseColor;
+    uint metallicRoughness;
+    uint normal;
+    uint occlusion;
+    uint emission;
+};
+
+layout(set = 1, binding = 0, std430) readonly buffer MaterialTable {
+    Material materials[];
+} materialTable;
+layout(set = 1, binding = 1) uniform sampler2D textures[];
+
+// follows the vertex stage model matrix, see Mesh::MaterialIndexPushConstantOffset
+layout(push_constant) uniform PushConstantsObject {
+    layout(offset = 64) uint materialIndex;
+} pushConstants;
+
+void main() {
+    const Material material = materialTable.materials[pushConstants.materialIndex];
+
+    // the pipeline is specialized for the material features, disabled paths are compiled out
+    vec4 baseColor = texture(textures[nonuniformEXT(material.baseColor)], BaseColorUv1 ? uv1 : uv);
+    baseColor *= material.baseColorFactor;
+    if (AlphaMaskEnabled && baseColor.a < material.alphaCutoff) {
+        discard;
+    }
+
+    vec3 emission = material.emissiveFactor;
+    if (EmissiveMapEnabled) {
+        emission *= texture(textures[nonuniformEXT(material.emission)], EmissiveUv1 ? uv1 : uv).rgb;
+    }
+
+    outColor = vec4(baseColor.rgb + emission, baseColor.a);
+}
@@ -0,0 +1,190 @@
+#ifndef SPD_DOWNSAMPLE_GLSL
+#define SPD_DOWNSAMPLE_GLSL
+
+// Single pass mip chain downsampler in the spirit of AMD FidelityFX SPD.
+// Every workgroup reduces a 64x64 tile of mip 0 to mips 1-6 in shared memory, the last
+// workgroup to finish a layer reduces mip 6 of all tiles down to 1x1. One dispatch covers
+// all mips of all layers. The including shader defines MIP_FORMAT, the storage image format.
+
+layout(local_size_x = 256, local_size_y = 1, local_size_z = 1) in;
+
+layout(set = 0, binding = 0) uniform sampler2DArray mip0;
+// mip 6 of all tiles, read back by the last workgroup of each layer
+layout(set = 0, binding = 1, std430) coherent buffer MidMipBuffer { vec4 midMip[]; };
+// finished workgroups per layer, zeroed before the dispatch
+layout(set = 0, binding = 2, std430) coherent buffer CountersBuffer { uint counters[]; };
+layout(set = 0, binding = 3, MIP_FORMAT) uniform writeonly image2DArray mip1;
+layout(set = 0, binding = 4, MIP_FORMAT) uniform writeonly image2DArray mip2;
+layout(set = 0, binding = 5, MIP_FORMAT) uniform writeonly image2DArray mip3;
+layout(set = 0, binding = 6, MIP_FORMAT) uniform writeonly image2DArray mip4;
+layout(set = 0, binding = 7, MIP_FORMAT) uniform writeonly image2DArray mip5;
+layout(set = 0, binding = 8, MIP_FORMAT) uniform writeonly image2DArray mip6;
+layout(set = 0, binding = 9, MIP_FORMAT) uniform writeonly image2DArray mip7;
+layout(set = 0, binding = 10, MIP_FORMAT) uniform writeonly image2DArray mip8;
+layout(set = 0, binding = 11, MIP_FORMAT) uniform writeonly image2DArray mip9;
+layout(set = 0, binding = 12, MIP_FORMAT) uniform writeonly image2DArray mip10;
+layout(set = 0, binding = 13, MIP_FORMAT) uniform writeonly image2DArray mip11;
+layout(set = 0, binding = 14, MIP_FORMAT) uniform writeonly image2DArray mip12;
+
+layout(push_constant) uniform PushConstants {
+    uvec2 size;
+    uint mipLevels;
+    uint workGroupsPerLayer;
+} pushConstants;
+
+const uint MidMip = 6;
+const uint MidMipMaxSize = 64;
+const uint TileSize = 32;
+
+// one mip of the tile as half floats, 8 KB
+shared uint tileRG[TileSize][TileSize];
+shared uint tileBA[TileSize][TileSize];
+shared bool isLastWorkGroup;
+
+uvec2 GetMipSize(uint mip) { return max(pushConstants.size >> mip, uvec2(1)); }
+
+void StoreMip(uint mip, uvec2 coord, uint layer, vec4 value)
+{
+    const ivec3 p = ivec3(coord, layer);
+    // separate bindings instead of an array, no dynamic indexing of storage images needed
+    switch (int(mip))
+    {
+        case 1: imageStore(mip1, p, value); break;
+        case 2: imageStore(mip2, p, value); break;
+        case 3: imageStore(mip3, p, value); break;
+        case 4: imageStore(mip4, p, value); break;
+        case 5: imageStore(mip5, p, value); break;
+        case 6: imageStore(mip6, p, value); break;
+        case 7: imageStore(mip7, p, value); break;
+        case 8: imageStore(mip8, p, value); break;
+        case 9: imageStore(mip9, p, value); break;
+        case 10: imageStore(mip10, p, value); break;
+        case 11: imageStore(mip11, p, value); break;
+        default: imageStore(mip12, p, value); break;
+    }
+}
+
+void StoreMipIfInside(uint mip, uvec2 coord, uint layer, vec4 value)
+{
+    if (all(lessThan(coord, GetMipSize(mip)))) { StoreMip(mip, coord, layer, value); }
+}
+
+void StoreTile(uvec2 p, vec4 value)
+{
+    tileRG[p.y][p.x] = packHalf2x16(value.rg);
+    tileBA[p.y][p.x] = packHalf2x16(value.ba);
+}
+
+vec4 LoadTile(uvec2 p)
+{
+    return vec4(unpackHalf2x16(tileRG[p.y][p.x]), unpackHalf2x16(tileBA[p.y][p.x]));
+}
+
+// 2x2 source texels of dst, clamped so 1 texel wide mips don't read past their edge
+ivec2 GetSourceTexel(uvec2 dst, ivec2 offset, uint srcMip)
+{
+    return min(ivec2(dst * 2) + offset, ivec2(GetMipSize(srcMip)) - 1);
+}
+
+// mip 1 straight from mip 0, a bilinear fetch between 4 texels averages them
+void DownsampleMip0(uvec2 tileId, uint layer)
+{
+    const vec2 invSize = 1.0 / vec2(pushConstants.size);
+    for (uint i = gl_LocalInvocationIndex; i < TileSize * TileSize; i += 256)
+    {
+        const uvec2 p = uvec2(i % TileSize, i / TileSize);
+        const uvec2 dst = tileId * TileSize + p;
+        const vec4 value = textureLod(mip0, vec3(vec2(dst * 2 + 1) * invSize, layer), 0.0);
+        StoreMipIfInside(1, dst, layer, value);
+        StoreTile(p, value);
+    }
+    barrier();
+}
+
+// mip from mip - 1 held in shared memory, dstSize x dstSize texels starting at dstOrigin
+void DownsampleTile(uint mip, uvec2 dstOrigin, uint dstSize, uint layer)
+{
+    const uint i = gl_LocalInvocationIndex;
+    const bool active = i < dstSize * dstSize;
+    const uvec2 p = uvec2(i % dstSize, i / dstSize);
+    const ivec2 srcOrigin = ivec2(dstOrigin * 2);
+
+    vec4 value = vec4(0.0);
+    if (active)
+    {
+        const uvec2 dst = dstOrigin + p;
+        for (int y = 0; y < 2; ++y)
+        {
+            for (int x = 0; x < 2; ++x)
+            {
+                const ivec2 src = GetSourceTexel(dst, ivec2(x, y), mip - 1) - srcOrigin;
+                value += LoadTile(uvec2(clamp(src, ivec2(0), ivec2(dstSize * 2 - 1))));
+            }
+        }
+        value *= 0.25;
+        StoreMipIfInside(mip, dst, layer, value);
+    }
+    // the tile is read and written in place
+    barrier();
+    if (active) { StoreTile(p, value); }
+    barrier();
+}
+
+// mip 7 from mip 6 of all tiles, done by the last workgroup of the layer
+void DownsampleMidMip(uint layer)
+{
+    const uint layerOffset = layer * MidMipMaxSize * MidMipMaxSize;
+    for (uint i = gl_LocalInvocationIndex; i < TileSize * TileSize; i += 256)
+    {
+        const uvec2 dst = uvec2(i % TileSize, i / TileSize);
+        vec4 value = vec4(0.0);
+        for (int y = 0; y < 2; ++y)
+        {
+            for (int x = 0; x < 2; ++x)
+            {
+                const ivec2 src = GetSourceTexel(dst, ivec2(x, y), MidMip);
+                value += midMip[layerOffset + uint(src.y) * MidMipMaxSize + uint(src.x)];
+            }
+        }
+        value *= 0.25;
+        StoreMipIfInside(MidMip + 1, dst, layer, value);
+        StoreTile(dst, value);
+    }
+    barrier();
+}
+
+void main()
+{
+    const uvec2 tileId = gl_WorkGroupID.xy;
+    const uint layer = gl_WorkGroupID.z;
+    const uint lastMip = pushConstants.mipLevels - 1;
+
+    DownsampleMip0(tileId, layer);
+    for (uint mip = 2; mip <= min(lastMip, MidMip); ++mip)
+    {
+        const uint dstSize = TileSize >> (mip - 1);
+        DownsampleTile(mip, tileId * dstSize, dstSize, layer);
+    }
+
+    if (lastMip <= MidMip) { return; }
+
+    if (gl_LocalInvocationIndex == 0)
+    {
+        const uint layerOffset = layer * MidMipMaxSize * MidMipMaxSize;
+        midMip[layerOffset + tileId.y * MidMipMaxSize + tileId.x] = LoadTile(uvec2(0));
+        memoryBarrierBuffer();
+        isLastWorkGroup =
+            atomicAdd(counters[layer], 1u) == pushConstants.workGroupsPerLayer - 1;
+    }
+    barrier();
+    if (!isLastWorkGroup) { return; }
+    memoryBarrierBuffer();
+
+    DownsampleMidMip(layer);
+    for (uint mip = MidMip + 2; mip <= lastMip; ++mip)
+    {
+        DownsampleTile(mip, uvec2(0), TileSize >> (mip - MidMip - 1), layer);
+    }
+}
+
+#endif
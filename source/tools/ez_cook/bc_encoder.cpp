@@ -0,0 +1,294 @@
+#include "bc_encoder.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define EZ_COOK_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace ez::Cook
+{
+namespace
+{
+constexpr uint32_t BlockDim = 4;
+constexpr uint32_t BlockPixelsCount = BlockDim * BlockDim;
+
+// 16 pixels of a block in SoA layout, so that index fitting can run 4 pixels per instruction
+struct BlockPixels
+{
+    alignas(16) float r[BlockPixelsCount];
+    alignas(16) float g[BlockPixelsCount];
+    alignas(16) float b[BlockPixelsCount];
+    alignas(16) float a[BlockPixelsCount];
+};
+
+void FetchBlock(const uint8_t* rgba,
+                uint32_t width,
+                uint32_t height,
+                uint32_t blockX,
+                uint32_t blockY,
+                BlockPixels& block)
+{
+    for (uint32_t y = 0; y < BlockDim; ++y)
+    {
+        const uint32_t srcY = std::min(blockY * BlockDim + y, height - 1);
+        for (uint32_t x = 0; x < BlockDim; ++x)
+        {
+            const uint32_t srcX = std::min(blockX * BlockDim + x, width - 1);
+            const uint8_t* texel = rgba + (static_cast<size_t>(srcY) * width + srcX) * 4;
+            const uint32_t i = y * BlockDim + x;
+            block.r[i] = texel[0];
+            block.g[i] = texel[1];
+            block.b[i] = texel[2];
+            block.a[i] = texel[3];
+        }
+    }
+}
+
+uint16_t PackRgb565(const float color[3])
+{
+    const auto quantize = [](float value, uint32_t maxValue) {
+        const float clamped = std::clamp(value, 0.0f, 255.0f);
+        return static_cast<uint32_t>(clamped * maxValue / 255.0f + 0.5f);
+    };
+    const uint32_t r = quantize(color[0], 31);
+    const uint32_t g = quantize(color[1], 63);
+    const uint32_t b = quantize(color[2], 31);
+    return static_cast<uint16_t>((r << 11) | (g << 5) | b);
+}
+
+void UnpackRgb565(uint16_t packed, float color[3])
+{
+    const uint32_t r = (packed >> 11) & 31;
+    const uint32_t g = (packed >> 5) & 63;
+    const uint32_t b = packed & 31;
+    color[0] = static_cast<float>((r << 3) | (r >> 2));
+    color[1] = static_cast<float>((g << 2) | (g >> 4));
+    color[2] = static_cast<float>((b << 3) | (b >> 2));
+}
+
+// Principal axis of the block colors, found with a few power iterations over the covariance.
+void FindPrincipalAxis(const BlockPixels& block, float mean[3], float axis[3])
+{
+    mean[0] = mean[1] = mean[2] = 0.0f;
+    for (uint32_t i = 0; i < BlockPixelsCount; ++i)
+    {
+        mean[0] += block.r[i];
+        mean[1] += block.g[i];
+        mean[2] += block.b[i];
+    }
+    for (uint32_t c = 0; c < 3; ++c) { mean[c] /= BlockPixelsCount; }
+
+    float cov[6] = {};  // rr rg rb gg gb bb
+    for (uint32_t i = 0; i < BlockPixelsCount; ++i)
+    {
+        const float r = block.r[i] - mean[0];
+        const float g = block.g[i] - mean[1];
+        const float b = block.b[i] - mean[2];
+        cov[0] += r * r;
+        cov[1] += r * g;
+        cov[2] += r * b;
+        cov[3] += g * g;
+        cov[4] += g * b;
+        cov[5] += b * b;
+    }
+
+    axis[0] = axis[1] = axis[2] = 1.0f;
+    for (uint32_t iteration = 0; iteration < 4; ++iteration)
+    {
+        const float x = cov[0] * axis[0] + cov[1] * axis[1] + cov[2] * axis[2];
+        const float y = cov[1] * axis[0] + cov[3] * axis[1] + cov[4] * axis[2];
+        const float z = cov[2] * axis[0] + cov[4] * axis[1] + cov[5] * axis[2];
+        const float maxComponent = std::max({ std::fabs(x), std::fabs(y), std::fabs(z) });
+        if (maxComponent < 1e-6f) { break; }
+        axis[0] = x / maxComponent;
+        axis[1] = y / maxComponent;
+        axis[2] = z / maxComponent;
+    }
+}
+
+// Projects every pixel onto the endpoints segment and returns 2-bit palette indices. Palette
+// order in BC1 4-color mode is { e0, e1, 2/3 e0 + 1/3 e1, 1/3 e0 + 2/3 e1 }.
+uint32_t FitColorIndices(const BlockPixels& block, const float e0[3], const float e1[3])
+{
+    const float dir[3] = { e1[0] - e0[0], e1[1] - e0[1], e1[2] - e0[2] };
+    const float lengthSq = dir[0] * dir[0] + dir[1] * dir[1] + dir[2] * dir[2];
+    if (lengthSq < 1e-6f) { return 0; }
+    const float scale = 3.0f / lengthSq;
+
+    static constexpr uint32_t LevelToIndex[4] = { 0, 2, 3, 1 };
+    uint32_t levels[BlockPixelsCount];
+
+#ifdef EZ_COOK_SSE2
+    const __m128 dirR = _mm_set1_ps(dir[0] * scale);
+    const __m128 dirG = _mm_set1_ps(dir[1] * scale);
+    const __m128 dirB = _mm_set1_ps(dir[2] * scale);
+    const __m128 e0R = _mm_set1_ps(e0[0]);
+    const __m128 e0G = _mm_set1_ps(e0[1]);
+    const __m128 e0B = _mm_set1_ps(e0[2]);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 three = _mm_set1_ps(3.0f);
+    for (uint32_t i = 0; i < BlockPixelsCount; i += 4)
+    {
+        __m128 t = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.r + i), e0R), dirR);
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.g + i), e0G), dirG));
+        t = _mm_add_ps(t, _mm_mul_ps(_mm_sub_ps(_mm_load_ps(block.b + i), e0B), dirB));
+        t = _mm_min_ps(_mm_max_ps(t, zero), three);
+        // default MXCSR rounding is round-to-nearest
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(levels + i), _mm_cvtps_epi32(t));
+    }
+#else
+    for (uint32_t i = 0; i < BlockPixelsCount; ++i)
+    {
+        float t = (block.r[i] - e0[0]) * dir[0] + (block.g[i] - e0[1]) * dir[1] +
+                  (block.b[i] - e0[2]) * dir[2];
+        t = std::clamp(t * scale, 0.0f, 3.0f);
+        levels[i] = static_cast<uint32_t>(t + 0.5f);
+    }
+#endif
+
+    uint32_t indices = 0;
+    for (uint32_t i = 0; i < BlockPixelsCount; ++i)
+    {
+        indices |= LevelToIndex[levels[i]] << (2 * i);
+    }
+    return indices;
+}
+
+void EncodeColorBlock(const BlockPixels& block, uint8_t* out)
+{
+    float mean[3];
+    float axis[3];
+    FindPrincipalAxis(block, mean, axis);
+
+    float minProjection = std::numeric_limits<float>::max();
+    float maxProjection = std::numeric_limits<float>::lowest();
+    for (uint32_t i = 0; i < BlockPixelsCount; ++i)
+    {
+        const float projection = (block.r[i] - mean[0]) * axis[0] +
+                                 (block.g[i] - mean[1]) * axis[1] +
+                                 (block.b[i] - mean[2]) * axis[2];
+        minProjection = std::min(minProjection, projection);
+        maxProjection = std::max(maxProjection, projection);
+    }
+
+    const float axisLengthSq = axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2];
+    float maxColor[3];
+    float minColor[3];
+    for (uint32_t c = 0; c < 3; ++c)
+    {
+        const float axisUnit = axisLengthSq > 0.0f ? axis[c] / axisLengthSq : 0.0f;
+        maxColor[c] = mean[c] + axisUnit * maxProjection;
+        minColor[c] = mean[c] + axisUnit * minProjection;
+        // inset the endpoints a bit, extremes are represented by the interpolated colors
+        const float inset = (maxColor[c] - minColor[c]) / 16.0f;
+        maxColor[c] -= inset;
+        minColor[c] += inset;
+    }
+
+    uint16_t color0 = PackRgb565(maxColor);
+    uint16_t color1 = PackRgb565(minColor);
+    uint32_t indices = 0;
+    if (color0 != color1)
+    {
+        // color0 > color1 selects the 4-color mode
+        if (color0 < color1) { std::swap(color0, color1); }
+        float e0[3];
+        float e1[3];
+        UnpackRgb565(color0, e0);
+        UnpackRgb565(color1, e1);
+        indices = FitColorIndices(block, e0, e1);
+    }
+
+    std::memcpy(out + 0, &color0, sizeof(color0));
+    std::memcpy(out + 2, &color1, sizeof(color1));
+    std::memcpy(out + 4, &indices, sizeof(indices));
+}
+
+void EncodeAlphaBlock(const BlockPixels& block, uint8_t* out)
+{
+    float minAlpha = 255.0f;
+    float maxAlpha = 0.0f;
+    for (uint32_t i = 0; i < BlockPixelsCount; ++i)
+    {
+        minAlpha = std::min(minAlpha, block.a[i]);
+        maxAlpha = std::max(maxAlpha, block.a[i]);
+    }
+
+    // alpha0 > alpha1 selects the 8-value mode: { a0, a1, 6 interpolated from a0 to a1 }
+    const uint8_t alpha0 = static_cast<uint8_t>(maxAlpha);
+    const uint8_t alpha1 = static_cast<uint8_t>(minAlpha);
+    uint64_t indices = 0;
+    if (alpha0 != alpha1)
+    {
+        const float scale = 7.0f / (maxAlpha - minAlpha);
+        for (uint32_t i = 0; i < BlockPixelsCount; ++i)
+        {
+            const float t = (block.a[i] - minAlpha) * scale;
+            const uint32_t level = static_cast<uint32_t>(t + 0.5f);
+            const uint64_t index = level == 7 ? 0 : (level == 0 ? 1 : 8 - level);
+            indices |= index << (3 * i);
+        }
+    }
+
+    out[0] = alpha0;
+    out[1] = alpha1;
+    for (uint32_t i = 0; i < 6; ++i) { out[2 + i] = static_cast<uint8_t>(indices >> (8 * i)); }
+}
+
+template <typename EncodeBlockFunc>
+std::vector<uint8_t> EncodeBlocks(const uint8_t* rgba,
+                                  uint32_t width,
+                                  uint32_t height,
+                                  uint32_t blockSize,
+                                  EncodeBlockFunc encodeBlock)
+{
+    const uint32_t blocksX = (width + BlockDim - 1) / BlockDim;
+    const uint32_t blocksY = (height + BlockDim - 1) / BlockDim;
+
+    std::vector<uint8_t> result(GetBlockCompressedSize(width, height, blockSize));
+    uint8_t* out = result.data();
+
+    BlockPixels block;
+    for (uint32_t blockY = 0; blockY < blocksY; ++blockY)
+    {
+        for (uint32_t blockX = 0; blockX < blocksX; ++blockX)
+        {
+            FetchBlock(rgba, width, height, blockX, blockY, block);
+            encodeBlock(block, out);
+            out += blockSize;
+        }
+    }
+    return result;
+}
+}  // namespace
+
+size_t GetBlockCompressedSize(uint32_t width, uint32_t height, uint32_t blockSize)
+{
+    const size_t blocksX = (width + BlockDim - 1) / BlockDim;
+    const size_t blocksY = (height + BlockDim - 1) / BlockDim;
+    return blocksX * blocksY * blockSize;
+}
+
+std::vector<uint8_t> EncodeBC1(const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    const auto encodeBlock = [](const BlockPixels& block, uint8_t* out) {
+        EncodeColorBlock(block, out);
+    };
+    return EncodeBlocks(rgba, width, height, BC1BlockSize, encodeBlock);
+}
+
+std::vector<uint8_t> EncodeBC3(const uint8_t* rgba, uint32_t width, uint32_t height)
+{
+    const auto encodeBlock = [](const BlockPixels& block, uint8_t* out) {
+        EncodeAlphaBlock(block, out);
+        EncodeColorBlock(block, out + BC1BlockSize);
+    };
+    return EncodeBlocks(rgba, width, height, BC3BlockSize, encodeBlock);
+}
+
+}  // namespace ez::Cook
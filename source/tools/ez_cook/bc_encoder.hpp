@@ -0,0 +1,19 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace ez::Cook
+{
+constexpr uint32_t BC1BlockSize = 8;
+constexpr uint32_t BC3BlockSize = 16;
+
+size_t GetBlockCompressedSize(uint32_t width, uint32_t height, uint32_t blockSize);
+
+// Both encoders take tightly packed RGBA8 pixels. Partial edge blocks are padded by clamping
+// to the last row/column, which is what the sampler sees anyway.
+std::vector<uint8_t> EncodeBC1(const uint8_t* rgba, uint32_t width, uint32_t height);
+std::vector<uint8_t> EncodeBC3(const uint8_t* rgba, uint32_t width, uint32_t height);
+
+}  // namespace ez::Cook
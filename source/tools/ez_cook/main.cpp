@@ -0,0 +1,297 @@
+// ez_cook: offline texture cooker. Walks the assets directory, builds full mip chains for
+// every image referenced by glTF files (plus standalone ldr images), block-compresses them and
+// writes <image>.ezt next to the source, which Texture then uploads without any runtime work.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <optional>
+#include <string>
+#include <vector>
+
+#define TINYGLTF_IMPLEMENTATION
+#define TINYGLTF_USE_CPP14
+#define STB_IMAGE_IMPLEMENTATION
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <tinygltf/tiny_gltf.h>
+
+#include "core/cooked_texture.hpp"
+#include "core/thread_pool.hpp"
+#include "tools/ez_cook/bc_encoder.hpp"
+#include "tools/ez_cook/mip_chain.hpp"
+
+namespace fs = std::filesystem;
+
+namespace
+{
+using ez::Cook::ColorSpace;
+
+struct Options final
+{
+    fs::path assetsDir{ "../assets" };
+    bool force = false;
+    uint32_t threadsCount = ez::ThreadPool::GetDefaultThreadsCount();
+};
+
+enum class CookStatus : uint8_t
+{
+    eCooked = 0,
+    eUpToDate = 1,
+    eFailed = 2,
+};
+
+bool IsLdrImageExtension(std::string extension)
+{
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == ".png" || extension == ".jpg" || extension == ".jpeg" ||
+           extension == ".tga" || extension == ".bmp";
+}
+
+// images are only classified here, decoding is done later by the cook jobs
+bool SkipImageDecoding(tinygltf::Image*,
+                       const int,
+                       std::string*,
+                       std::string*,
+                       int,
+                       int,
+                       const unsigned char*,
+                       int,
+                       void*)
+{
+    return true;
+}
+
+// normal maps are renormalized, color is averaged in linear space, data is averaged as is
+int GetColorSpacePriority(ColorSpace colorSpace)
+{
+    switch (colorSpace)
+    {
+        case ColorSpace::eNormal: return 2;
+        case ColorSpace::eSrgb: return 1;
+        case ColorSpace::eLinear: return 0;
+    }
+    return 0;
+}
+
+void CollectGltfImages(const fs::path& gltfPath, std::map<fs::path, ColorSpace>& images)
+{
+    tinygltf::Model gltfModel;
+    tinygltf::TinyGLTF loader;
+    loader.SetImageLoader(SkipImageDecoding, nullptr);
+    std::string err;
+    std::string warn;
+
+    const bool isBinary = gltfPath.extension() == ".glb";
+    const bool loaded =
+        isBinary ? loader.LoadBinaryFromFile(&gltfModel, &err, &warn, gltfPath.string())
+                 : loader.LoadASCIIFromFile(&gltfModel, &err, &warn, gltfPath.string());
+    if (!loaded)
+    {
+        std::cerr << "failed to parse " << gltfPath << ": " << err << std::endl;
+        return;
+    }
+
+    // nothing for embedded images (data uris, buffer views), there is no file to put the cache
+    // next to
+    const auto getImagePath = [&](int textureIndex) -> std::optional<fs::path> {
+        if (textureIndex < 0 || textureIndex >= static_cast<int>(gltfModel.textures.size()))
+        {
+            return {};
+        }
+        const int imageIndex = gltfModel.textures[textureIndex].source;
+        if (imageIndex < 0 || imageIndex >= static_cast<int>(gltfModel.images.size()))
+        {
+            return {};
+        }
+
+        const std::string& uri = gltfModel.images[imageIndex].uri;
+        if (uri.empty() || uri.rfind("data:", 0) == 0) { return {}; }
+        return (gltfPath.parent_path() / uri).lexically_normal();
+    };
+
+    const auto addTexture = [&](int textureIndex, ColorSpace colorSpace) {
+        const std::optional<fs::path> imagePath = getImagePath(textureIndex);
+        if (!imagePath) { return; }
+        const auto [it, inserted] = images.emplace(*imagePath, colorSpace);
+        // the same image used as e.g. base color and mask: keep the stricter interpretation
+        if (!inserted && GetColorSpacePriority(colorSpace) > GetColorSpacePriority(it->second))
+        {
+            it->second = colorSpace;
+        }
+    };
+
+    for (const tinygltf::Material& material : gltfModel.materials)
+    {
+        const tinygltf::PbrMetallicRoughness& pbr = material.pbrMetallicRoughness;
+        addTexture(pbr.baseColorTexture.index, ColorSpace::eSrgb);
+        addTexture(material.emissiveTexture.index, ColorSpace::eSrgb);
+        addTexture(pbr.metallicRoughnessTexture.index, ColorSpace::eLinear);
+        addTexture(material.occlusionTexture.index, ColorSpace::eLinear);
+        addTexture(material.normalTexture.index, ColorSpace::eNormal);
+    }
+    // textures no material refers to are still cooked, as plain data
+    for (size_t i = 0; i < gltfModel.textures.size(); ++i)
+    {
+        const std::optional<fs::path> imagePath = getImagePath(static_cast<int>(i));
+        if (imagePath) { images.emplace(*imagePath, ColorSpace::eLinear); }
+    }
+}
+
+std::map<fs::path, ColorSpace> CollectImages(const fs::path& assetsDir)
+{
+    std::map<fs::path, ColorSpace> images;
+    std::vector<fs::path> standaloneImages;
+
+    for (const fs::directory_entry& entry : fs::recursive_directory_iterator(assetsDir))
+    {
+        if (!entry.is_regular_file()) { continue; }
+        const fs::path& path = entry.path();
+        if (path.extension() == ".gltf" || path.extension() == ".glb")
+        {
+            CollectGltfImages(path, images);
+        }
+        else if (IsLdrImageExtension(path.extension().string()))
+        {
+            standaloneImages.push_back(path.lexically_normal());
+        }
+    }
+
+    for (const fs::path& path : standaloneImages) { images.emplace(path, ColorSpace::eSrgb); }
+    return images;
+}
+
+CookStatus CookImage(const fs::path& imagePath, ColorSpace colorSpace, bool force)
+{
+    const std::string sourcePath = imagePath.string();
+    if (!force && ez::CookedTexture::IsUpToDate(sourcePath)) { return CookStatus::eUpToDate; }
+
+    const std::optional<ez::CookedTexture::SourceStamp> stamp =
+        ez::CookedTexture::GetSourceStamp(sourcePath);
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    stbi_uc* pixels = stamp.has_value() ? stbi_load(sourcePath.c_str(), &width, &height,
+                                                    &channels, STBI_rgb_alpha)
+                                        : nullptr;
+    if (pixels == nullptr)
+    {
+        std::cerr << "failed to load " << sourcePath << std::endl;
+        return CookStatus::eFailed;
+    }
+
+    const size_t pixelsSize = static_cast<size_t>(width) * height * 4;
+    std::vector<uint8_t> rgba(pixels, pixels + pixelsSize);
+    stbi_image_free(pixels);
+
+    bool isOpaque = true;
+    for (size_t i = 3; i < rgba.size(); i += 4)
+    {
+        if (rgba[i] != 255)
+        {
+            isOpaque = false;
+            break;
+        }
+    }
+
+    const uint32_t mip0Width = static_cast<uint32_t>(width);
+    const uint32_t mip0Height = static_cast<uint32_t>(height);
+    std::vector<ez::Cook::MipImage> mipChain =
+        ez::Cook::BuildMipChain(std::move(rgba), mip0Width, mip0Height, colorSpace);
+
+    ez::CookedTexture::Image cooked;
+    cooked.header.format = isOpaque ? ez::CookedTexture::Format::eBC1RgbUnorm
+                                    : ez::CookedTexture::Format::eBC3Unorm;
+    cooked.header.width = mip0Width;
+    cooked.header.height = mip0Height;
+    cooked.header.mipLevelsCount = static_cast<uint32_t>(mipChain.size());
+    cooked.header.sourceFileSize = stamp->fileSize;
+    cooked.header.sourceWriteTime = stamp->writeTime;
+
+    for (const ez::Cook::MipImage& mip : mipChain)
+    {
+        std::vector<uint8_t> encoded =
+            isOpaque ? ez::Cook::EncodeBC1(mip.rgba.data(), mip.width, mip.height)
+                     : ez::Cook::EncodeBC3(mip.rgba.data(), mip.width, mip.height);
+
+        ez::CookedTexture::MipLevel& mipLevel = cooked.mipLevels.emplace_back();
+        mipLevel.offset = cooked.data.size();
+        mipLevel.size = encoded.size();
+        mipLevel.width = mip.width;
+        mipLevel.height = mip.height;
+        cooked.data.insert(cooked.data.end(), encoded.begin(), encoded.end());
+    }
+
+    if (!ez::CookedTexture::Save(ez::CookedTexture::GetCookedPath(sourcePath), cooked))
+    {
+        return CookStatus::eFailed;
+    }
+    return CookStatus::eCooked;
+}
+
+bool ParseOptions(int argc, char* argv[], Options& options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--force") { options.force = true; }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            options.threadsCount = static_cast<uint32_t>(std::max(std::atoi(argv[++i]), 1));
+        }
+        else if (!arg.empty() && arg[0] != '-') { options.assetsDir = arg; }
+        else
+        {
+            std::cerr << "usage: ez_cook [assets dir] [--force] [--threads N]" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+}  // namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!ParseOptions(argc, argv, options)) { return EXIT_FAILURE; }
+
+    std::error_code ec;
+    if (!fs::is_directory(options.assetsDir, ec))
+    {
+        std::cerr << "assets directory not found: " << options.assetsDir << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    const std::map<fs::path, ColorSpace> images = CollectImages(options.assetsDir);
+
+    std::atomic<uint32_t> cookedCount = 0;
+    std::atomic<uint32_t> upToDateCount = 0;
+    std::atomic<uint32_t> failedCount = 0;
+    {
+        ez::ThreadPool threadPool(options.threadsCount);
+        std::vector<std::future<void>> jobs;
+        jobs.reserve(images.size());
+        for (const auto& [imagePath, colorSpace] : images)
+        {
+            const fs::path path = imagePath;
+            const ColorSpace space = colorSpace;
+            jobs.push_back(threadPool.Enqueue([&, path, space]() {
+                const CookStatus status = CookImage(path, space, options.force);
+                if (status == CookStatus::eCooked)
+                {
+                    std::cout << "cooked " + path.string() + "\n";
+                    ++cookedCount;
+                }
+                else if (status == CookStatus::eUpToDate) { ++upToDateCount; }
+                else { ++failedCount; }
+            }));
+        }
+        for (std::future<void>& job : jobs) { job.get(); }
+    }
+
+    std::cout << "ez_cook: " << cookedCount << " cooked, " << upToDateCount << " up to date, "
+              << failedCount << " failed" << std::endl;
+    return failedCount == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
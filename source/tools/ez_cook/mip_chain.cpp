@@ -0,0 +1,139 @@
+#include "mip_chain.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+
+namespace ez::Cook
+{
+namespace
+{
+const std::array<float, 256>& GetSrgbToLinearTable()
+{
+    static const std::array<float, 256> table = []() {
+        std::array<float, 256> result;
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            const float c = i / 255.0f;
+            result[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        return result;
+    }();
+    return table;
+}
+
+uint8_t LinearToSrgb(float c)
+{
+    c = std::clamp(c, 0.0f, 1.0f);
+    const float s = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return static_cast<uint8_t>(s * 255.0f + 0.5f);
+}
+
+uint8_t ToUnorm8(float c)
+{
+    return static_cast<uint8_t>(std::clamp(c, 0.0f, 1.0f) * 255.0f + 0.5f);
+}
+
+// source texels a destination texel covers along one axis, weighted by the covered part;
+// 2 taps for even sizes, 3 for odd ones so that the last row and column are not dropped
+struct Footprint final
+{
+    uint32_t first = 0;
+    uint32_t count = 0;
+    std::array<float, 3> weights{};
+};
+
+Footprint GetFootprint(uint32_t dstIndex, uint32_t srcSize, uint32_t dstSize)
+{
+    // in units of 1 / dstSize of a source texel, so that the bounds are integers
+    const uint32_t begin = dstIndex * srcSize;
+    const uint32_t end = begin + srcSize;
+
+    Footprint footprint;
+    footprint.first = begin / dstSize;
+    const uint32_t last = std::min((end - 1) / dstSize, footprint.first + 2);
+    for (uint32_t i = footprint.first; i <= last; ++i)
+    {
+        const uint32_t covered =
+            std::min(end, (i + 1) * dstSize) - std::max(begin, i * dstSize);
+        footprint.weights[footprint.count++] = static_cast<float>(covered) / srcSize;
+    }
+    return footprint;
+}
+
+MipImage Downsample(const MipImage& src, ColorSpace colorSpace)
+{
+    const std::array<float, 256>& srgbToLinear = GetSrgbToLinearTable();
+
+    MipImage dst;
+    dst.width = std::max(src.width / 2, 1u);
+    dst.height = std::max(src.height / 2, 1u);
+    dst.rgba.resize(static_cast<size_t>(dst.width) * dst.height * 4);
+
+    for (uint32_t y = 0; y < dst.height; ++y)
+    {
+        const Footprint footprintY = GetFootprint(y, src.height, dst.height);
+        for (uint32_t x = 0; x < dst.width; ++x)
+        {
+            const Footprint footprintX = GetFootprint(x, src.width, dst.width);
+
+            float sum[4] = {};
+            for (uint32_t ty = 0; ty < footprintY.count; ++ty)
+            {
+                const size_t row = static_cast<size_t>(footprintY.first + ty) * src.width;
+                for (uint32_t tx = 0; tx < footprintX.count; ++tx)
+                {
+                    const uint8_t* texel = &src.rgba[(row + footprintX.first + tx) * 4];
+                    const float weight = footprintY.weights[ty] * footprintX.weights[tx];
+                    for (uint32_t c = 0; c < 3; ++c)
+                    {
+                        sum[c] += weight * (colorSpace == ColorSpace::eSrgb
+                                                ? srgbToLinear[texel[c]]
+                                                : texel[c] / 255.0f);
+                    }
+                    sum[3] += weight * (texel[3] / 255.0f);
+                }
+            }
+
+            uint8_t* out = &dst.rgba[(static_cast<size_t>(y) * dst.width + x) * 4];
+            if (colorSpace == ColorSpace::eSrgb)
+            {
+                for (uint32_t c = 0; c < 3; ++c) { out[c] = LinearToSrgb(sum[c]); }
+            }
+            else if (colorSpace == ColorSpace::eNormal)
+            {
+                float n[3];
+                for (uint32_t c = 0; c < 3; ++c) { n[c] = sum[c] * 2.0f - 1.0f; }
+                const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+                if (length > 1e-6f)
+                {
+                    for (float& value : n) { value /= length; }
+                }
+                for (uint32_t c = 0; c < 3; ++c) { out[c] = ToUnorm8(n[c] * 0.5f + 0.5f); }
+            }
+            else
+            {
+                for (uint32_t c = 0; c < 3; ++c) { out[c] = ToUnorm8(sum[c]); }
+            }
+            out[3] = ToUnorm8(sum[3]);
+        }
+    }
+    return dst;
+}
+}  // namespace
+
+std::vector<MipImage> BuildMipChain(std::vector<uint8_t>&& rgba,
+                                    uint32_t width,
+                                    uint32_t height,
+                                    ColorSpace colorSpace)
+{
+    std::vector<MipImage> chain;
+    chain.push_back(MipImage{ width, height, std::move(rgba) });
+    while (chain.back().width > 1 || chain.back().height > 1)
+    {
+        chain.push_back(Downsample(chain.back(), colorSpace));
+    }
+    return chain;
+}
+
+}  // namespace ez::Cook
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+namespace ez::Cook
+{
+enum class ColorSpace : uint8_t
+{
+    eSrgb = 0,
+    eLinear = 1,
+    eNormal = 2,
+};
+
+struct MipImage final
+{
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> rgba;
+};
+
+// Full chain down to 1x1, mip 0 included. Each level is a box filter of the previous one, 2x2
+// and 3 texels wide along odd sides, done in linear space for sRGB images and renormalized for
+// normal maps.
+std::vector<MipImage> BuildMipChain(std::vector<uint8_t>&& rgba,
+                                    uint32_t width,
+                                    uint32_t height,
+                                    ColorSpace colorSpace);
+
+}  // namespace ez::Cook